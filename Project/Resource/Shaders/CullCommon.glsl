@@ -0,0 +1,56 @@
+/****************************************************************************/
+/*!
+\file
+   CullCommon.glsl
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Draw commands, counters and frustum test shared by the cull shaders
+*/
+/****************************************************************************/
+#include "GpuObject.glsl"
+
+// matches VkDrawIndexedIndirectCommand
+struct DrawCommand
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+// the draw counts the indirect draws read, then what was left out,
+// matches VK::GpuCulling::Counters
+struct CullCounts
+{
+    uint earlyDraws;
+    uint lateDraws;
+    uint frustumCulled;
+    uint occluded;
+};
+
+// world space bounds, the same as VK::Bounds::Transformed
+void WorldBounds(GpuObject object, out vec3 center, out vec3 extents, out float radius)
+{
+    mat3 axes = mat3(object.world);
+    center = (object.world * vec4(object.sphere.xyz, 1)).xyz;
+    extents = abs(axes[0]) * object.extents.x + abs(axes[1]) * object.extents.y + abs(axes[2]) * object.extents.z;
+    radius = object.sphere.w * max(length(axes[0]), max(length(axes[1]), length(axes[2])));
+}
+
+// inward facing planes, see VK::Frustum
+bool InFrustum(vec4 planes[6], vec3 center, vec3 extents, float radius)
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        float distance = dot(planes[p].xyz, center) + planes[p].w;
+        float box = dot(abs(planes[p].xyz), extents);
+        if (distance + min(radius, box) < 0)
+            return false;
+    }
+    return true;
+}
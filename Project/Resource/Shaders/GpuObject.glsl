@@ -0,0 +1,24 @@
+/****************************************************************************/
+/*!
+\file
+   GpuObject.glsl
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    One object of the GPU driven scene, matches VK::GpuObject
+*/
+/****************************************************************************/
+
+struct GpuObject
+{
+    mat4 world;
+    vec4 sphere;       // model space center, radius in w
+    vec4 extents;      // model space box half size
+    uint firstIndex;
+    uint indexCount;
+    int vertexOffset;
+    uint pad;
+};
@@ -0,0 +1,42 @@
+/****************************************************************************/
+/*!
+\file
+   Instanced.vert
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Simple.vert for instanced draws, each instance reads its world matrix
+    from the instance buffer
+*/
+/****************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_KHR_vulkan_glsl : enable
+
+layout (location = 0) in vec4 aPosition;
+layout (location = 1) in vec4 aNormal;
+
+layout(set = 0, binding = 0) uniform MatrixBuffer 
+{
+    mat4 world;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout (std430, set = 1, binding = 0) readonly buffer Instances
+{
+    mat4 worlds[];
+};
+
+layout (location = 0) out vec4 normal;
+
+void main()
+{
+    mat4 world = worlds[gl_InstanceIndex];
+
+    normal = normalize(aNormal);    
+    gl_Position = ubo.proj * ubo.view * world * vec4(aPosition.x, -aPosition.y, aPosition.z, 1);
+}
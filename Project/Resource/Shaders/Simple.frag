@@ -13,10 +13,13 @@
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_KHR_vulkan_glsl : enable
 
+// permutations, off compiles the normals away
+layout (constant_id = 0) const bool SHOW_NORMALS = true;
+
 layout (location = 0) in vec4 normal;
 layout (location = 0) out vec4 color;
 
 void main()
 {  
-  color = normal;
+  color = SHOW_NORMALS ? normal : vec4(1.0);
 }
\ No newline at end of file
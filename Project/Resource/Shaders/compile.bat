@@ -1,2 +1,2 @@
-C:/VulkanSDK/1.2.154.1/Bin/glslc.exe Simple.vert -o Simple.vert.spv
-C:/VulkanSDK/1.2.154.1/Bin/glslc.exe Simple.frag -o Simple.frag.spv
\ No newline at end of file
+%VULKAN_SDK%/Bin/glslc.exe Simple.vert -o Simple.vert.spv
+%VULKAN_SDK%/Bin/glslc.exe Simple.frag -o Simple.frag.spv
\ No newline at end of file
@@ -0,0 +1,90 @@
+/****************************************************************************/
+/*!
+\file
+   Benchmark.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Headless repeatable benchmark scenarios with JSON results
+*/
+/****************************************************************************/
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+#pragma once
+
+#include "FrameStats.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace VK
+{
+    struct BenchmarkDesc
+    {
+        // instanced, unique, resize, startup or all
+        std::string scenario = "all";
+
+        // frames each scenario draws, startup ones draw fewer
+        uint32_t frames = 600;
+        int width = 1280;
+        int height = 720;
+        bool gpuCulling = false;
+
+        // compiled shaders live here, startup-cold empties it first
+        std::string cacheDirectory = "BenchmarkCache";
+        std::string outputPath = "benchmark.json";
+    };
+
+    struct BenchmarkResult
+    {
+        std::string name;
+        uint32_t objects = 0;
+        uint32_t frames = 0;
+
+        // startup phases in milliseconds
+        double rendererMs = 0;   // device, targets and pipelines
+        double sceneMs = 0;      // the scene set up
+        double firstFrameMs = 0; // simulated, drawn and finished on the GPU
+        double totalMs = 0;
+
+        FrameStatsReport report;
+        std::string framesPath; // CSV of every frame's times
+
+        // megabytes resident when the scenario ended, and the most the
+        // process ever had resident, negative when unknown
+        double residentMB = -1;
+        double peakResidentMB = -1;
+    };
+
+    // Drives a fresh headless engine per scenario for a fixed number of
+    // frames. The simulation takes fixed steps and the camera circles the
+    // objects once per run, so every run draws the same frames. Pipelines
+    // are built before the first frame so no draws are skipped.
+    class Benchmark
+    {
+    public:
+        // run the scenarios, false if the name matches none
+        bool Run(const BenchmarkDesc& desc);
+
+        const std::vector<BenchmarkResult>& Results() const;
+
+        bool WriteJson(const std::string& path) const;
+
+    private:
+        BenchmarkResult RunScenario(const std::string& name);
+
+        BenchmarkDesc mDesc;
+        std::vector<BenchmarkResult> mResults;
+
+        // what was measured on
+        std::string mDeviceName;
+        std::string mDeviceType;
+        uint32_t mApiVersion = 0;
+        uint32_t mDriverVersion = 0;
+    };
+}
+
+#endif
@@ -17,7 +17,8 @@
 #include "CommandPool.hpp"
 #include "FrameBuffer.hpp"
 #include "RenderPass.hpp"
-#include "PipeLine.hpp"
+#include "Pipeline.hpp"
+#include "ComputePipeline.hpp"
 #include "UBO.hpp"
 #include <vector>
 
@@ -33,11 +34,33 @@ namespace VK
         void Begin(unsigned i);
         void End(unsigned index);
         void EndRT(unsigned i);
+        void BeginRendering(unsigned i, VK::Device& device, const std::vector<VkImageView>& colorViews, VkImageView depthView, VkExtent2D extent);
+        void EndRendering(unsigned i, VK::Device& device);
         void BindPipeline(unsigned index, VK::PipeLine& pipeLine);
         void BindPipelineRT(unsigned i, VK::PipeLine& pipeLine);
         void BindVertexBufferes(unsigned index, std::vector<VkBuffer> buffers, std::vector<VkDeviceSize>);
         void BindDescriptorSet(unsigned i, VK::PipeLine& pipeLine, std::vector<VkDescriptorSet> dSet);
+        void SetViewport(unsigned i, VkExtent2D extent);
         void DrawIndexed(unsigned index, unsigned instanceCount, VkBuffer* Indexbuffers, uint32_t indexCount);
+        void DrawIndexedInstances(unsigned i, uint32_t indexCount, uint32_t instanceCount, uint32_t firstInstance);
+
+        // draws written by the GPU, see GpuCulling
+        void BindIndexBuffer(unsigned i, VkBuffer indexBuffer);
+        void DrawIndexedIndirectCount(unsigned i, VkBuffer draws, VkDeviceSize offset, VkBuffer count, VkDeviceSize countOffset,
+            uint32_t maxDraws, uint32_t stride = sizeof(VkDrawIndexedIndirectCommand));
+
+        // compute, recorded outside a render pass
+        void BindComputePipeline(unsigned i, VK::ComputePipeline& pipeLine);
+        void BindComputeDescriptorSet(unsigned i, VK::ComputePipeline& pipeLine, std::vector<VkDescriptorSet> dSet, unsigned firstSet = 0);
+        void PushConstants(unsigned i, VkPipelineLayout layout, VkShaderStageFlags stages, const void* data, uint32_t size, uint32_t offset = 0);
+        void Dispatch(unsigned i, uint32_t x, uint32_t y = 1, uint32_t z = 1);
+        void DispatchIndirect(unsigned i, VkBuffer buffer, VkDeviceSize offset = 0);
+
+        // synchronization between compute and the rest of the frame
+        void Barrier(unsigned i, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+        void ComputeToGraphicsBarrier(unsigned i);
+        void ComputeToComputeBarrier(unsigned i);
+        void TransitionImage(unsigned i, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 
     private:
 
@@ -0,0 +1,78 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef COMPUTEPIPELINE_H
+#define COMPUTEPIPELINE_H
+#pragma once
+
+#include "Device.hpp"
+#include "Pipeline.hpp"
+#include <string>
+#include <vector>
+
+namespace VK
+{
+    class PipelineCache;
+
+    // Everything a compute pipeline is built from. Two equal descriptions
+    // always give the same VkPipeline out of the pipeline cache.
+    struct ComputePipelineDesc
+    {
+        // GLSL (.comp) or SPIR-V (.spv) file, defines only apply to GLSL
+        std::string computePath;
+        std::vector<ShaderDefine> defines;
+
+        // sorted by id, see PipelineDesc
+        std::vector<SpecializationConstant> specialization;
+
+        // resources, one binding list per descriptor set. Reflected from
+        // the shader when left empty.
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> setLayouts;
+        std::vector<VkPushConstantRange> pushConstants;
+
+        void Specialize(uint32_t id, uint32_t value);
+        void Specialize(uint32_t id, int32_t value);
+        void Specialize(uint32_t id, float value);
+        void Specialize(uint32_t id, bool value);
+
+        uint64_t Hash() const;
+        bool operator==(const ComputePipelineDesc& rhs) const;
+    };
+
+    // A compute pipeline and its layout, both are owned by the pipeline
+    // cache. The set layouts are kept so descriptor sets can be allocated
+    // for the pipeline without building the bindings by hand.
+    class ComputePipeline
+    {
+    public:
+        void Create(VK::Device& device, VK::PipelineCache& cache, const ComputePipelineDesc& desc);
+        void ShutDown(VK::Device& device);
+
+        VkPipeline Get() const;
+        VkPipeline* GetPointerTo();
+
+        VkPipelineLayout Layout() const;
+        VkDescriptorSetLayout SetLayout(unsigned set) const;
+        const std::vector<VkDescriptorSetLayoutBinding>& SetBindings(unsigned set) const;
+        unsigned SetCount() const;
+
+        // from the shader's local_size, to turn a thread count into groups
+        const uint32_t* GroupSize() const;
+        uint32_t GroupCount(uint32_t threads, unsigned axis = 0) const;
+
+    private:
+
+        VkPipeline mPipeline = VK_NULL_HANDLE;
+        VkPipelineLayout mLayout = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSetLayout> mSetLayouts;
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> mSetBindings;
+        uint32_t mGroupSize[3] = { 1, 1, 1 };
+    };
+}
+#endif
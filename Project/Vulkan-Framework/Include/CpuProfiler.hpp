@@ -0,0 +1,83 @@
+/****************************************************************************/
+/*!
+\file
+   CpuProfiler.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Scoped CPU timing with Chrome trace export
+*/
+/****************************************************************************/
+#ifndef CPUPROFILER_HPP
+#define CPUPROFILER_HPP
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// scopes are compiled in for debug builds, or for release builds that
+// define VK_PROFILE
+#if !defined(NDEBUG) || defined(VK_PROFILE)
+#define VK_PROFILING 1
+#endif
+
+#define VK_PROFILE_CONCAT_INNER(a, b) a##b
+#define VK_PROFILE_CONCAT(a, b) VK_PROFILE_CONCAT_INNER(a, b)
+
+// time the rest of the enclosing block, name must be a string literal
+#ifdef VK_PROFILING
+#define VK_PROFILE_SCOPE(name) VK::CpuProfileScope VK_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define VK_PROFILE_SCOPE(name)
+#endif
+
+namespace VK
+{
+    // Each thread appends the scopes it closes to its own buffer, only the
+    // first scope a thread ever records takes a lock. The buffers are kept
+    // for the life of the program, so scopes belong on long lived threads.
+    // Nothing is recorded unless a capture is running. A capture runs
+    // until Stop or for a number of frames, WriteTrace then saves it as
+    // Chrome trace JSON that chrome://tracing and Perfetto open. Captures
+    // should not be started or written while another one is being written.
+    class CpuProfiler
+    {
+    public:
+        // start a capture, dropping the last one. A frame count of 0 runs
+        // until Stop.
+        static void Start(uint32_t frameCount = 0);
+        static void Stop();
+
+        // mark the end of a frame, true when that ends the capture
+        static bool Frame();
+
+        static bool IsCapturing();
+
+        // save the last capture, false if the file can not be written
+        static bool WriteTrace(const std::string& path);
+
+        // nanoseconds on the clock scopes are timed with
+        static uint64_t Now();
+        static void Record(const char* name, uint64_t begin, uint64_t end);
+    };
+
+    // times its lifetime while a capture is running, see VK_PROFILE_SCOPE
+    class CpuProfileScope
+    {
+    public:
+        explicit CpuProfileScope(const char* name);
+        ~CpuProfileScope();
+
+        CpuProfileScope(const CpuProfileScope&) = delete;
+        CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+    private:
+        const char* mName;
+        uint64_t mBegin;
+    };
+}
+
+#endif
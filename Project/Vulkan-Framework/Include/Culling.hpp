@@ -0,0 +1,86 @@
+/****************************************************************************/
+/*!
+\file
+   Culling.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Bounding volumes and frustum culling
+*/
+/****************************************************************************/
+#ifndef CULLING_HPP
+#define CULLING_HPP
+#pragma once
+
+#include "JobPool.hpp"
+#include <glm.hpp>
+#include <vector>
+
+namespace VK
+{
+    // A box and the sphere around it, sharing a center. Culling keeps
+    // whichever of the two is tighter against each plane.
+    struct Bounds
+    {
+        glm::vec3 center = glm::vec3(0);
+        glm::vec3 extents = glm::vec3(0);
+        float radius = 0;
+
+        static Bounds FromPoints(const glm::vec3& min, const glm::vec3& max);
+        Bounds Transformed(const glm::mat4& world) const;
+    };
+
+    // six normalized planes facing inwards, xyz is the normal and w the
+    // distance, a point p is inside a plane when dot(xyz, p) + w >= 0
+    struct Frustum
+    {
+        glm::vec4 planes[6] = {};
+
+        static Frustum FromMatrix(const glm::mat4& viewProj);
+    };
+
+    // World space bounds of every object, one array per component so the
+    // culler can test several objects with one instruction. The arrays are
+    // padded to a whole SIMD width with bounds that never pass.
+    class CullList
+    {
+    public:
+        void Resize(uint32_t count);
+        void Set(uint32_t index, const Bounds& bounds);
+        void Set(uint32_t index, const Bounds& local, const glm::mat4& world);
+
+        uint32_t Size() const;
+
+    private:
+        friend class FrustumCuller;
+
+        uint32_t mCount = 0;
+        std::vector<float> mCenterX;
+        std::vector<float> mCenterY;
+        std::vector<float> mCenterZ;
+        std::vector<float> mExtentX;
+        std::vector<float> mExtentY;
+        std::vector<float> mExtentZ;
+        std::vector<float> mRadius;
+    };
+
+    // Tests a cull list against a frustum across the job pool, and writes
+    // the indices of what is visible in order.
+    class FrustumCuller
+    {
+    public:
+        void Cull(VK::JobPool& jobs, const Frustum& frustum, const CullList& list, std::vector<uint32_t>& visible);
+
+    private:
+        void CullRange(const Frustum& frustum, const CullList& list, uint32_t begin, uint32_t end);
+
+        // each job writes from its own first index, then the runs are packed
+        std::vector<uint32_t> mScratch;
+        std::vector<uint32_t> mChunkCounts;
+    };
+}
+
+#endif
@@ -0,0 +1,81 @@
+/****************************************************************************/
+/*!
+\file
+   DepthPyramid.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Hierarchical depth for occlusion culling
+*/
+/****************************************************************************/
+#ifndef DEPTHPYRAMID_HPP
+#define DEPTHPYRAMID_HPP
+#pragma once
+
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "CommandBuffer.hpp"
+#include "ComputePipeline.hpp"
+#include "DescriptorPool.hpp"
+#include "DescriptorSet.hpp"
+#include "ImageView.hpp"
+#include "Sampler.hpp"
+#include <vector>
+
+namespace VK
+{
+    class PipelineCache;
+
+    // A full mip chain of the farthest depth under each texel, built from a
+    // depth buffer by one dispatch of DepthPyramid.comp. Mip 0 is the
+    // largest power of two that fits in the depth buffer, capped at 4096.
+    // The image stays in VK_IMAGE_LAYOUT_GENERAL.
+    class DepthPyramid
+    {
+    public:
+        void Create(VK::Device& device, VK::PipelineCache& cache, VkImage depth, VkFormat depthFormat, VkExtent2D depthExtent);
+        void ShutDown(VK::Device& device);
+
+        // record the build, the depth must be in SHADER_READ_ONLY_OPTIMAL.
+        // extent is the part of the depth that was rendered to.
+        void Build(VK::CommandBuffer& commandBuffer, unsigned i, VkExtent2D extent);
+
+        // every mip, sampled with texelFetch
+        VkImageView View() const;
+        VkSampler Sampler() const;
+
+        VkExtent2D Extent() const;
+        uint32_t MipCount() const;
+        bool IsActive() const;
+
+    private:
+        // push constants of DepthPyramid.comp
+        struct Params
+        {
+            uint32_t depthSize[2];
+            uint32_t size[2];
+            uint32_t mipCount;
+            uint32_t groupCount;
+        };
+
+        VK::ComputePipeline mPipeline;
+        VK::DescriptorPool mPool;
+        VK::DescriptorSet mSet;
+
+        VkImage mImage = VK_NULL_HANDLE;
+        VkDeviceMemory mMemory = VK_NULL_HANDLE;
+        VK::ImageView mView;
+        std::vector<VK::ImageView> mMipViews;
+        VK::ImageView mDepthView;
+        VK::Sampler mSampler;
+        VK::Buffer mCounter;
+
+        VkExtent2D mExtent = {};
+        uint32_t mMipCount = 0;
+    };
+}
+
+#endif
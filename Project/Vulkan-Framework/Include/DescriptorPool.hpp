@@ -20,6 +20,7 @@ namespace VK
     {
     public:
         void Create(VK::Device& device, unsigned bufferCount, VkDeviceSize bufferSize, unsigned textureCount = 0);
+        void Create(VK::Device& device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, unsigned setCount);
         void ShutDown(VK::Device& device);
 
         VkDescriptorPool Get();
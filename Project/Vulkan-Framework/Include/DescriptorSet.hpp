@@ -15,6 +15,7 @@
 #include "Buffer.hpp"
 #include "DescriptorPool.hpp"
 #include "Image.hpp"
+#include "DescriptorTemplate.hpp"
 
 namespace VK
 {
@@ -23,17 +24,29 @@ namespace VK
     public:
         void Create(VK::Device& device, VK::DescriptorPool& pool, std::vector<VK::Buffer>& buffers,
             unsigned bufferCount, VkDeviceSize bufferSize, VkShaderStageFlags stage, std::vector<VK::Image*>& images, std::vector<VK::Sampler*> samplers);
+        void Create(VK::Device& device, VK::DescriptorPool& pool, VkDescriptorSetLayout layout,
+            const std::vector<VkDescriptorSetLayoutBinding>& bindings, unsigned setCount);
+
+        // fill a whole set, laid out as Template says
+        void Update(VK::Device& device, unsigned set, const VK::DescriptorInfo* data);
 
         void ShutDown(VK::Device& device);
 
         VkDescriptorSetLayout Layout();
         VkDescriptorSetLayout* GetPointerToLayout();
+        const std::vector<VkDescriptorSetLayoutBinding>& Bindings() const;
+        const VK::DescriptorTemplate& Template() const;
         std::vector<VkDescriptorSet>* GetAll();
         VkDescriptorSet Get(unsigned i);
 
     private:
         VkDescriptorSetLayout mLayout = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSetLayoutBinding> mBindings;
         std::vector<VkDescriptorSet> mSets;
+        VK::DescriptorTemplate mTemplate;
+
+        // false when the layout belongs to the pipeline cache
+        bool mOwnsLayout = true;
     };
 }
 #endif
@@ -0,0 +1,59 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef DESCRIPTORTEMPLATE_H
+#define DESCRIPTORTEMPLATE_H
+#pragma once
+
+#include "Device.hpp"
+#include <vector>
+
+namespace VK
+{
+    // One descriptor as a template reads it. A set's descriptors are an
+    // array of these, one slot per array element of every binding.
+    union DescriptorInfo
+    {
+        VkDescriptorBufferInfo buffer;
+        VkDescriptorImageInfo image;
+        VkBufferView texelBuffer;
+        VkAccelerationStructureNV accelerationStructure;
+
+        static DescriptorInfo Buffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+        static DescriptorInfo Image(VkImageView view, VkImageLayout layout, VkSampler sampler = VK_NULL_HANDLE);
+    };
+
+    // A VkDescriptorUpdateTemplate for one set layout. Writes a whole set
+    // from a packed DescriptorInfo array in one call, without building
+    // VkWriteDescriptorSets or having the driver parse them.
+    class DescriptorTemplate
+    {
+    public:
+        void Create(VK::Device& device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayout layout);
+        void ShutDown(VK::Device& device);
+
+        void Update(VK::Device& device, VkDescriptorSet set, const DescriptorInfo* data) const;
+
+        VkDescriptorUpdateTemplate Get() const;
+
+        // size of the DescriptorInfo array and where a binding starts in it
+        uint32_t SlotCount() const;
+        uint32_t Slot(uint32_t binding, uint32_t element = 0) const;
+
+    private:
+        void Build(VK::Device& device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorUpdateTemplateCreateInfo& info);
+
+        VkDescriptorUpdateTemplate mTemplate = VK_NULL_HANDLE;
+
+        // indexed by binding number, ~0 for numbers the layout skips
+        std::vector<uint32_t> mFirstSlot;
+        uint32_t mSlotCount = 0;
+    };
+}
+#endif
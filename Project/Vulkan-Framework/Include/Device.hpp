@@ -14,6 +14,7 @@
 #include <optional>
 #include <vector>
 #include "Instance.hpp"
+#include "DynamicRendering.hpp"
 
 namespace VK
 {
@@ -46,16 +47,17 @@ namespace VK
 
             QueueFamilyIndices mQueueFamilyIndicies;
 
-            const std::vector<const char*> mDeviceExtensions =
-            {
-                VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-            };
+            // filled in Create, presentation extensions are only requested with a surface
+            std::vector<const char*> mDeviceExtensions;
 
             VkPhysicalDeviceMemoryProperties mMemoryProperties = {};
 
             bool IsDeviceSuitable(VkPhysicalDevice device, VK::Surface& surface);
             void FindQueueFamilies(VkPhysicalDevice device, VK::Surface& surface);
             bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+            bool SupportsDynamicRendering() const;
+            bool SupportsDrawIndirectCount() const;
+            bool HasExtension(const char* name) const;
             SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device, VK::Surface& surface);
 
             VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
@@ -63,7 +65,8 @@ namespace VK
 
     public:
 
-        void Create(VK::Instance& instance, VK::Surface& surface, VkQueue& graphicsQueue, VkQueue& presentationQueue);
+        void Create(VK::Instance& instance, VK::Surface& surface, VkQueue& graphicsQueue, VkQueue& presentationQueue, bool dynamicRendering = false,
+            bool drawIndirectCount = false);
         void ShutDown();
 
         VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
@@ -76,11 +79,27 @@ namespace VK
         
         QueueFamilyIndices GetQueueFamilies(VK::Surface& surface);
         uint32_t GraphicsFamily() const;
+        bool IsHeadless() const;
+        bool SupportsPresent(VK::Surface& surface) const;
         uint32_t GetMemoryType(uint32_t typeBits, const VkMemoryPropertyFlags& properties);
 
+        // render passes and framebuffers are skipped when this is on
+        bool DynamicRendering() const;
+        void CmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR& info) const;
+        void CmdEndRendering(VkCommandBuffer commandBuffer) const;
+
+        // indirect draws with a GPU written count, for GPU driven rendering
+        bool DrawIndirectCount() const;
+
     private:
 
         VkDevice mDevice = VK_NULL_HANDLE;
+        bool mHeadless = false;
+        bool mDrawIndirectCount = false;
+
+        // VK_KHR_dynamic_rendering, loaded when it was asked for and found
+        PFN_vkCmdBeginRenderingKHR mBeginRendering = nullptr;
+        PFN_vkCmdEndRenderingKHR mEndRendering = nullptr;
     };
 }
 #endif
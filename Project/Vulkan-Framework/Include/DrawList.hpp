@@ -0,0 +1,64 @@
+/****************************************************************************/
+/*!
+\file
+   DrawList.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Draw ordering by sort key and merging into instanced draws
+*/
+/****************************************************************************/
+#ifndef DRAWLIST_HPP
+#define DRAWLIST_HPP
+#pragma once
+
+#include "FrameQueue.hpp"
+#include "JobPool.hpp"
+#include <vector>
+
+namespace VK
+{
+    // Orders draws by a 64 bit key, from the most significant bits down:
+    // pass (2), pipeline (10), material (16), mesh (16), depth (20). Ids are
+    // wrapped to their width. Opaque draws go front to back so early depth
+    // testing rejects more, transparent ones back to front. The keys are
+    // radix sorted across the job pool, then each run of draws with the same
+    // pass, pipeline, material and mesh becomes one batch.
+    class DrawList
+    {
+    public:
+        // depth is the view space distance of each world matrix's origin
+        // over farPlane
+        void Build(VK::JobPool& jobs, const std::vector<DrawItem>& items, const glm::mat4& view, float farPlane);
+
+        // the item each sorted draw comes from
+        const std::vector<uint32_t>& Order() const;
+        const std::vector<DrawBatch>& Batches() const;
+
+        // depth in [0, 1], clamped
+        static uint64_t MakeKey(const DrawItem& item, float depth);
+
+    private:
+        struct Entry
+        {
+            uint64_t key;
+            uint32_t index;
+        };
+
+        void Sort(VK::JobPool& jobs);
+
+        std::vector<Entry> mEntries;
+        std::vector<Entry> mScratch;
+
+        // 256 buckets per chunk, counts then write offsets
+        std::vector<uint32_t> mHistograms;
+
+        std::vector<uint32_t> mOrder;
+        std::vector<DrawBatch> mBatches;
+    };
+}
+
+#endif
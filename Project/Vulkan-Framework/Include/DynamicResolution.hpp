@@ -0,0 +1,68 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+#pragma once
+
+#include "Device.hpp"
+#include "GpuProfiler.hpp"
+
+namespace VK
+{
+    struct DynamicResolutionDesc
+    {
+        // render size relative to the swap chain, per axis
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+
+        // GPU time per frame the scale is steered towards
+        float budgetMs = 16.0f;
+    };
+
+    // Times every frame on the GPU with a pair of timestamps, or is handed
+    // the times of a GpuProfiler, and picks the size of the sub rectangle of
+    // a max size target the next frames render into. The target itself is
+    // never reallocated.
+    class DynamicResolution
+    {
+    public:
+        void Create(VK::Device& device, VkExtent2D swapChainExtent, uint32_t imageCount, const DynamicResolutionDesc& desc,
+            bool timeFrames = true);
+        void ShutDown(VK::Device& device);
+
+        void BeginFrame(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+        void EndFrame(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+        void Update(VK::Device& device, uint32_t imageIndex);
+        void Update(float gpuTime);
+
+        void SetBudget(float budgetMs);
+
+        bool IsActive() const;
+        VkExtent2D Extent() const;
+        VkExtent2D MaxExtent() const;
+        float Scale() const;
+        float GpuTime() const;
+
+    private:
+        VkExtent2D ScaledExtent(float scale) const;
+
+        VkQueryPool mQueryPool = VK_NULL_HANDLE;
+        std::vector<bool> mSubmitted;
+        DynamicResolutionDesc mDesc;
+
+        VkExtent2D mBaseExtent = {};
+        VkExtent2D mExtent = {};
+        float mScale = 1.0f;
+        float mGpuTime = 0.0f;
+        TimestampClock mClock;
+        bool mActive = false;
+    };
+}
+#endif
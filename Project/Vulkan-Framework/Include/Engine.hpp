@@ -16,6 +16,13 @@
 #pragma once
 
 #include "Renderer.hpp"
+#include "FrameQueue.hpp"
+#include "SceneGraph.hpp"
+#include "JobPool.hpp"
+#include "Culling.hpp"
+#include "DrawList.hpp"
+#include <thread>
+#include <exception>
 
 namespace VK
 {
@@ -23,17 +30,67 @@ namespace VK
     {
     public:
 
-        Engine();
+        Engine(const RendererConfig& config = RendererConfig());
         void Init();
-        void Run();
+        void Run(unsigned frameCount = 0);
         void ShutDown();
 
+        // frame time percentiles and hitches of the recent frames
+        VK::FrameStatsReport FrameReport() const;
+
+        // step the simulation by a fixed time so runs repeat, 0 follows
+        // the clock
+        void SetFixedStep(float dt);
+
+        // circle the camera around the origin once a period, a radius of
+        // 0 keeps the default view
+        void SetCameraOrbit(float radius, float height, float period);
+
+        // add a cube of static objects centered on the origin, unique ones
+        // each get their own mesh id so none are drawn instanced
+        void AddObjects(uint32_t count, float spacing, bool unique);
+
+        VK::Renderer& GetRenderer();
+
     private:
         float UpdateDT();
+        void Simulate(float dt, FramePacket& packet);
+        void RenderThread();
 
         VK::Renderer mRenderer;
         WindowPtr mWindow = nullptr;
 
+        // simulation produces packets, the render thread draws them
+        VK::FrameQueue mFrameQueue;
+        std::thread mRenderThread;
+        std::exception_ptr mRenderError;
+        uint64_t mFrame = 0;
+
+        // test scene
+        VK::JobPool mJobs;
+        VK::SceneGraph mScene;
+        SceneNode mBunny = NoNode;
+        float mAngle = 0;
+
+        // repeatable runs
+        float mFixedStep = 0;
+        float mTime = 0;
+        float mOrbitRadius = 0;
+        float mOrbitHeight = 0;
+        float mOrbitPeriod = 1;
+
+        // nodes that draw a mesh, culled into each packet's draw list
+        std::vector<SceneNode> mDrawNodes;
+        std::vector<uint32_t> mDrawMeshes;
+        std::vector<uint32_t> mDrawOf; // by node, NoDraw if it draws nothing
+        VK::CullList mCullList;
+        VK::FrustumCuller mCuller;
+        std::vector<uint32_t> mVisible;
+
+        // what goes into the packet, before and after sorting
+        std::vector<DrawItem> mItems;
+        VK::DrawList mDrawList;
+
         double pDeltaTime;
         float pFPS;
 
@@ -0,0 +1,101 @@
+/****************************************************************************/
+/*!
+\file
+   FrameQueue.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Hands frame packets from the simulation thread to the render thread
+*/
+/****************************************************************************/
+#ifndef FRAMEQUEUE_HPP
+#define FRAMEQUEUE_HPP
+#pragma once
+
+#include <glm.hpp>
+#include <array>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+namespace VK
+{
+    // passes in the order they are drawn, transparent draws go back to front
+    enum class DrawPass : uint32_t
+    {
+        Opaque,
+        Transparent
+    };
+
+    struct DrawItem
+    {
+        glm::mat4 world = glm::mat4(1);
+        uint32_t mesh = 0;
+        uint32_t material = 0;
+        uint32_t pipeline = 0;
+        DrawPass pass = DrawPass::Opaque;
+    };
+
+    // a run of the packet's draws that differ only in their world matrix,
+    // drawn as one instanced draw
+    struct DrawBatch
+    {
+        DrawPass pass = DrawPass::Opaque;
+        uint32_t pipeline = 0;
+        uint32_t material = 0;
+        uint32_t mesh = 0;
+        uint32_t firstInstance = 0;
+        uint32_t instanceCount = 0;
+
+        bool operator==(const DrawBatch& rhs) const;
+        bool operator!=(const DrawBatch& rhs) const;
+    };
+
+    // everything the render thread needs for one frame, never touched by
+    // the simulation once it has been published
+    struct FramePacket
+    {
+        uint64_t frame = 0;
+        float dt = 0;
+        glm::mat4 view = glm::mat4(1);
+        glm::mat4 proj = glm::mat4(1);
+
+        // sorted, each batch covers a run of them. GPU driven packets are
+        // not sorted, each draw keeps its index from packet to packet and
+        // changed lists those whose world moved since the last packet.
+        std::vector<DrawItem> draws;
+        std::vector<DrawBatch> batches;
+        std::vector<uint32_t> changed;
+    };
+
+    // bounded single producer / single consumer queue of three packets,
+    // the packets are reused so their vectors keep their capacity
+    class FrameQueue
+    {
+    public:
+        FramePacket* BeginWrite();
+        void EndWrite();
+
+        const FramePacket* BeginRead();
+        void EndRead();
+
+        void Close();
+        void Reset();
+
+    private:
+        static const unsigned Capacity = 3;
+
+        std::array<FramePacket, Capacity> mPackets;
+        unsigned mRead = 0;
+        unsigned mCount = 0;
+        bool mClosed = false;
+
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+    };
+}
+
+#endif
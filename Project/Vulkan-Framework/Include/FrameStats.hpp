@@ -0,0 +1,118 @@
+/****************************************************************************/
+/*!
+\file
+   FrameStats.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Frame time distributions, hitches and their export
+*/
+/****************************************************************************/
+#ifndef FRAMESTATS_HPP
+#define FRAMESTATS_HPP
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace VK
+{
+    struct FrameStatsDesc
+    {
+        // frames the percentiles cover
+        uint32_t capacity = 4096;
+
+        // a frame is a hitch when its CPU time is over both hitchFactor
+        // times the recent average and the average plus hitchMinMs
+        float hitchFactor = 2.0f;
+        float hitchMinMs = 4.0f;
+
+        // seconds of frames between exports of the frames and the summary,
+        // 0 never. The path gets .csv and .json added.
+        float exportInterval = 0.0f;
+        std::string exportPath = "FrameStats";
+    };
+
+    // what one frame cost, in milliseconds
+    struct FrameSample
+    {
+        float cpuMs = 0;  // from the start of the last frame to this one
+        float gpuMs = -1; // negative when the GPU was not timed
+        float waitMs = 0; // blocked on fences and the swap chain
+    };
+
+    // one time of a frame over every frame kept, in milliseconds
+    struct FrameTimeSummary
+    {
+        uint32_t count = 0;
+        float mean = 0;
+        float p50 = 0;
+        float p95 = 0;
+        float p99 = 0;
+        float p999 = 0;
+        float max = 0;
+    };
+
+    struct FrameHitch
+    {
+        uint64_t frame = 0;
+        float cpuMs = 0;
+        float averageMs = 0; // what the frames before it took
+    };
+
+    struct FrameStatsReport
+    {
+        uint64_t frames = 0;  // every frame added
+        uint64_t hitches = 0; // every hitch found
+        FrameTimeSummary cpu;
+        FrameTimeSummary gpu;
+        FrameTimeSummary wait;
+        std::vector<FrameHitch> recentHitches; // oldest first
+    };
+
+    // A ring of the last frames' CPU, GPU and wait times. Frames are added
+    // from one thread and may be reported or exported from any other, so
+    // adding a frame never waits on a file. Percentiles are nearest rank
+    // over the frames in the ring.
+    class FrameStats
+    {
+    public:
+        void Create(const FrameStatsDesc& desc);
+
+        // record a frame, marks an export due when the interval has passed
+        void Add(const FrameSample& sample);
+
+        // write the exports if one is due, true if they were written
+        bool ExportIfDue();
+
+        FrameStatsReport Report() const;
+
+        // every frame in the ring, oldest first, as CSV
+        bool WriteCsv(const std::string& path) const;
+        // the report as JSON
+        bool WriteJson(const std::string& path) const;
+
+    private:
+        static FrameTimeSummary Summarize(std::vector<float>& times);
+        std::vector<FrameSample> Snapshot(uint64_t& first) const;
+
+        FrameStatsDesc mDesc;
+        std::vector<FrameSample> mSamples;
+        std::vector<FrameHitch> mHitches;
+        uint64_t mFrames = 0;
+        uint64_t mHitchCount = 0;
+        float mAverageMs = 0;
+        double mSinceExport = 0;
+        std::atomic<bool> mExportDue = false;
+
+        mutable std::mutex mMutex;
+    };
+}
+
+#endif
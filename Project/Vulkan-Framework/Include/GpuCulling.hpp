@@ -0,0 +1,139 @@
+/****************************************************************************/
+/*!
+\file
+   GpuCulling.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Frustum culling and draw generation on the GPU
+*/
+/****************************************************************************/
+#ifndef GPUCULLING_HPP
+#define GPUCULLING_HPP
+#pragma once
+
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "CommandBuffer.hpp"
+#include "ComputePipeline.hpp"
+#include "DescriptorPool.hpp"
+#include "DescriptorSet.hpp"
+#include "Culling.hpp"
+#include "DepthPyramid.hpp"
+#include "GpuScene.hpp"
+#include <vector>
+
+namespace VK
+{
+    class PipelineCache;
+
+    // what the GPU did with an image's last frame
+    struct GpuCullingStats
+    {
+        uint32_t objects = 0;
+        uint32_t frustumCulled = 0;
+        uint32_t occluded = 0;   // behind the depth pyramid, occlusion only
+        uint32_t earlyDraws = 0; // every draw without occlusion
+        uint32_t lateDraws = 0;  // newly visible, occlusion only
+        uint32_t uploaded = 0;   // objects sent by the last Update
+    };
+
+    // Per image draw and count buffers over one GpuScene. Cull uploads the
+    // objects that changed, then records a compute pass that tests every
+    // object against the frustum and appends an indexed indirect draw for
+    // each visible one, Draw draws them with one
+    // vkCmdDrawIndexedIndirectCount. The instance index of each draw is its
+    // object, the vertex shader reads the world matrix through ObjectSet.
+    // Nothing in the recorded commands depends on the object count, so
+    // command buffers do not have to be recorded again as the scene grows.
+    //
+    // Given a depth pyramid the cull runs in two phases. Cull draws what
+    // was visible last frame, the pyramid is built from that depth, then
+    // CullLate tests every object against it, remembers what is visible
+    // for the next frame and DrawLate draws only what just came into view.
+    class GpuCulling
+    {
+    public:
+        void Create(VK::Device& device, VK::PipelineCache& cache, unsigned imageCount, uint32_t capacity,
+            const VK::DepthPyramid* pyramid = nullptr);
+        void ShutDown(VK::Device& device);
+
+        // write the changed objects and the camera an image's next submit
+        // culls with, and collect the stats of its last submit
+        void Update(unsigned image, const glm::mat4& viewProj, const std::vector<GpuObject>& objects,
+            const std::vector<uint32_t>& changed);
+
+        void Cull(VK::CommandBuffer& commandBuffer, unsigned image);
+        void Draw(VK::CommandBuffer& commandBuffer, unsigned image);
+
+        // occlusion only, after the pyramid is built
+        void CullLate(VK::CommandBuffer& commandBuffer, unsigned image);
+        void DrawLate(VK::CommandBuffer& commandBuffer, unsigned image);
+
+        // the set the vertex shader reads the objects from
+        static std::vector<VkDescriptorSetLayoutBinding> ObjectBindings();
+        VkDescriptorSet ObjectSet(unsigned image);
+
+        // as of the last Update
+        const GpuCullingStats& Stats() const;
+
+        uint32_t Capacity() const;
+        bool IsActive() const;
+        bool Occlusion() const;
+
+    private:
+        // std140 uniform, with the dispatch size read by DispatchIndirect
+        // behind it. Cull.comp only reads up to objectCount.
+        struct CullData
+        {
+            glm::vec4 planes[6];
+            uint32_t objectCount;
+            uint32_t capacity;
+            uint32_t mipCount;
+            uint32_t pad0;
+            uint32_t pyramidSize[2];
+            uint32_t pad1[2];
+            glm::mat4 viewProj;
+            uint32_t groups[3];
+        };
+
+        // CullCounts of CullCommon.glsl, the draw counts come first
+        struct Counters
+        {
+            uint32_t earlyDraws;
+            uint32_t lateDraws;
+            uint32_t frustumCulled;
+            uint32_t occluded;
+        };
+
+        VK::ComputePipeline mPipeline;
+        VK::ComputePipeline mLatePipeline;
+        VK::DescriptorPool mCullPool;
+        VK::DescriptorSet mCullSets;
+        VK::DescriptorPool mObjectPool;
+        VK::DescriptorSet mObjectSets;
+
+        // every object, kept between frames
+        VK::GpuScene mScene;
+
+        // one of each for every image, the host visible ones stay mapped
+        std::vector<VK::Buffer> mCullData;
+        std::vector<VK::Buffer> mDraws;
+        std::vector<VK::Buffer> mCounts;
+        std::vector<CullData*> mMappedCullData;
+        std::vector<Counters*> mMappedCounts;
+
+        // shared by every image, each frame's late phase writes it for the
+        // next frame's early phase
+        VK::Buffer mVisibility;
+        const VK::DepthPyramid* mPyramid = nullptr;
+
+        GpuCullingStats mStats;
+        uint32_t mCapacity = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,107 @@
+/****************************************************************************/
+/*!
+\file
+   GpuProfiler.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Named GPU timestamp scopes with rolling times
+*/
+/****************************************************************************/
+#ifndef GPUPROFILER_HPP
+#define GPUPROFILER_HPP
+#pragma once
+
+#include "Device.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace VK
+{
+    // turns the graphics queue's timestamps into milliseconds
+    struct TimestampClock
+    {
+        float period = 0;       // nanoseconds per tick, 0 without timestamps
+        uint64_t mask = ~0ull;  // the bits a timestamp holds
+
+        static TimestampClock FromDevice(VK::Device& device);
+
+        bool IsValid() const;
+        float Milliseconds(uint64_t begin, uint64_t end) const;
+    };
+
+    // times of one scope over the last Window frames, in milliseconds
+    struct GpuScopeStats
+    {
+        std::string name;
+        unsigned depth = 0; // scopes open around it when it was recorded
+        float lastMs = 0;
+        float minMs = 0;
+        float avgMs = 0;
+        float maxMs = 0;
+        uint32_t samples = 0;
+    };
+
+    // One range of timestamp queries per command buffer. Scopes are opened
+    // and closed while recording, nest, and are matched up by name across
+    // command buffers. The results of a command buffer are read in Update
+    // once its fence has been waited on, so reading never stalls, they are
+    // as old as the number of images.
+    class GpuProfiler
+    {
+    public:
+        // frames each scope's min, avg and max cover
+        static constexpr uint32_t Window = 128;
+
+        void Create(VK::Device& device, unsigned imageCount, uint32_t maxScopes = 64);
+        void ShutDown(VK::Device& device);
+
+        // record before the first and after the last scope of an image
+        void BeginFrame(VkCommandBuffer commandBuffer, unsigned image);
+        void EndFrame(VkCommandBuffer commandBuffer, unsigned image);
+
+        // record outside of any render pass, scopes past maxScopes are not
+        // timed
+        void BeginScope(VkCommandBuffer commandBuffer, unsigned image, const std::string& name);
+        void EndScope(VkCommandBuffer commandBuffer, unsigned image);
+
+        // read the image's last submit, call once its fence is done and
+        // before it is recorded again. True if times were read.
+        bool Update(VK::Device& device, unsigned image);
+
+        // every scope seen so far, in the order they were first recorded
+        const std::vector<GpuScopeStats>& Scopes() const;
+        const GpuScopeStats* Find(const std::string& name) const;
+
+        bool IsActive() const;
+
+    private:
+        // a command buffer's queries, record r begins at query 2r of its
+        // range and ends at 2r + 1
+        struct Image
+        {
+            std::vector<uint32_t> records; // scope of each
+            std::vector<uint32_t> open;    // records not yet ended, ~0u if dropped
+            bool submitted = false;
+        };
+
+        uint32_t ScopeIndex(const std::string& name, unsigned depth);
+
+        VkQueryPool mQueryPool = VK_NULL_HANDLE;
+        std::vector<Image> mImages;
+        std::vector<uint64_t> mResults;
+
+        std::vector<GpuScopeStats> mScopes;
+        std::vector<std::vector<float>> mSamples; // ring of Window per scope
+        std::unordered_map<std::string, uint32_t> mScopeOf;
+
+        uint32_t mMaxScopes = 0;
+        TimestampClock mClock;
+    };
+}
+
+#endif
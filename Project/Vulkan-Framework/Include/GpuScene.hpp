@@ -0,0 +1,106 @@
+/****************************************************************************/
+/*!
+\file
+   GpuScene.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Persistent GPU copy of the scene's objects, updated by deltas
+*/
+/****************************************************************************/
+#ifndef GPUSCENE_HPP
+#define GPUSCENE_HPP
+#pragma once
+
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "CommandBuffer.hpp"
+#include "ComputePipeline.hpp"
+#include "DescriptorPool.hpp"
+#include "DescriptorSet.hpp"
+#include "Culling.hpp"
+#include <vector>
+
+namespace VK
+{
+    class PipelineCache;
+
+    // one object of the GPU driven scene, laid out as GpuObject.glsl
+    struct GpuObject
+    {
+        glm::mat4 world = glm::mat4(1);
+        glm::vec4 sphere = glm::vec4(0); // model space center, radius in w
+        glm::vec4 extents = glm::vec4(0); // model space box half size
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        int32_t vertexOffset = 0;
+        uint32_t pad = 0;
+
+        void SetBounds(const Bounds& bounds);
+    };
+
+    // Every object lives in one device local buffer that is kept between
+    // frames. Update writes only the objects that changed into the image's
+    // mapped upload buffer, Upload records a compute pass that scatters
+    // them into place. The dispatch is sized from the upload buffer, so
+    // the recorded commands never change and upload bandwidth follows the
+    // number of changes rather than the size of the scene.
+    class GpuScene
+    {
+    public:
+        void Create(VK::Device& device, VK::PipelineCache& cache, unsigned imageCount, uint32_t capacity);
+        void ShutDown(VK::Device& device);
+
+        // queue the changed objects for the image's next submit, the image
+        // must not be in flight. Everything is sent after Create and when
+        // the number of objects changes.
+        void Update(unsigned image, const std::vector<GpuObject>& objects, const std::vector<uint32_t>& changed);
+
+        // record the scatter outside of any render pass, it waits for the
+        // reads of earlier frames and is visible to compute and vertex
+        // shaders after it
+        void Upload(VK::CommandBuffer& commandBuffer, unsigned image);
+
+        VkBuffer Objects() const;
+        uint32_t Count() const;
+        uint32_t Uploaded() const;
+        bool IsActive() const;
+
+    private:
+        // the head of an upload buffer, the dispatch size comes first
+        struct UploadHeader
+        {
+            uint32_t groups[3];
+            uint32_t count;
+        };
+
+        // Upload of SceneScatter.comp, one changed object
+        struct UploadEntry
+        {
+            uint32_t index;
+            uint32_t pad[3];
+            GpuObject object;
+        };
+
+        VK::ComputePipeline mPipeline;
+        VK::DescriptorPool mPool;
+        VK::DescriptorSet mSets;
+
+        VK::Buffer mObjects;
+        std::vector<VK::Buffer> mUploads;
+        std::vector<UploadHeader*> mMapped;
+
+        // objects waiting for an upload, each listed once
+        std::vector<uint8_t> mDirty;
+        std::vector<uint32_t> mDirtyList;
+
+        uint32_t mCount = 0;
+        uint32_t mCapacity = 0;
+        uint32_t mUploaded = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,59 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef HASH_H
+#define HASH_H
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace VK
+{
+    // FNV-1a, stable between runs so it can key things on disk
+    static const uint64_t HashOffset = 14695981039346656037ull;
+    static const uint64_t HashPrime = 1099511628211ull;
+
+    // mix raw bytes into a hash
+    inline void HashBytes(uint64_t& hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= HashPrime;
+        }
+    }
+
+    // mix a single value into a hash
+    template <typename T>
+    inline void HashValue(uint64_t& hash, const T& value)
+    {
+        HashBytes(hash, &value, sizeof(T));
+    }
+
+    // mix a list of values into a hash, the size goes in first so moving an
+    // element between neighbouring lists changes the hash
+    template <typename T>
+    inline void HashVector(uint64_t& hash, const std::vector<T>& values)
+    {
+        HashValue(hash, uint64_t(values.size()));
+        HashBytes(hash, values.data(), values.size() * sizeof(T));
+    }
+
+    // mix a string into a hash
+    inline void HashString(uint64_t& hash, const std::string& value)
+    {
+        HashValue(hash, uint64_t(value.size()));
+        HashBytes(hash, value.data(), value.size());
+    }
+}
+#endif
@@ -43,5 +43,15 @@ namespace VK
         VkImage mImage = VK_NULL_HANDLE;
         VkDeviceMemory mImageMemory = VK_NULL_HANDLE;
     };
+
+    // the stages and accesses that touch an image while it is in a layout
+    struct LayoutUsage
+    {
+        VkPipelineStageFlags stage;
+        VkAccessFlags access;
+    };
+
+    LayoutUsage GetLayoutUsage(VkImageLayout layout);
+    VkImageAspectFlags GetFormatAspect(VkFormat format);
 }
 #endif
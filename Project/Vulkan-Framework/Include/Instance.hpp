@@ -27,7 +27,7 @@ namespace VK
         Instance() = default;
         ~Instance() = default;
 
-        void Create();
+        void Create(bool headless = false);
         void ShutDown();
         bool UsingValidationLayers() const;
         VkInstance Get() const;
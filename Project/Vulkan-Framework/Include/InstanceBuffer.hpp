@@ -0,0 +1,58 @@
+/****************************************************************************/
+/*!
+\file
+   InstanceBuffer.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Per image world matrices of instanced draws
+*/
+/****************************************************************************/
+#ifndef INSTANCEBUFFER_HPP
+#define INSTANCEBUFFER_HPP
+#pragma once
+
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "DescriptorPool.hpp"
+#include "DescriptorSet.hpp"
+#include <glm.hpp>
+#include <vector>
+
+namespace VK
+{
+    class PipelineCache;
+
+    // One mapped storage buffer of world matrices per image, read by
+    // Instanced.vert through Set with the instance index. A batch's
+    // firstInstance points at its first matrix.
+    class InstanceBuffer
+    {
+    public:
+        void Create(VK::Device& device, VK::PipelineCache& cache, unsigned imageCount, uint32_t capacity);
+        void ShutDown(VK::Device& device);
+
+        // write an image's matrices, the image must not be in flight.
+        // Those past the capacity are left out.
+        void Update(unsigned image, const std::vector<glm::mat4>& worlds);
+
+        static std::vector<VkDescriptorSetLayoutBinding> Bindings();
+        VkDescriptorSet Set(unsigned image);
+
+        uint32_t Capacity() const;
+        bool IsActive() const;
+
+    private:
+        VK::DescriptorPool mPool;
+        VK::DescriptorSet mSets;
+        std::vector<VK::Buffer> mBuffers;
+        std::vector<glm::mat4*> mMapped;
+
+        uint32_t mCapacity = 0;
+    };
+}
+
+#endif
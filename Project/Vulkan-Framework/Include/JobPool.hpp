@@ -0,0 +1,58 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef JOBPOOL_H
+#define JOBPOOL_H
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace VK
+{
+    // Persistent worker threads for data parallel loops. For splits a range
+    // into chunks that the workers and the calling thread pull until none
+    // are left, then returns. One thread calls For at a time.
+    class JobPool
+    {
+    public:
+        typedef std::function<void(uint32_t begin, uint32_t end)> RangeFunc;
+
+        void Create(unsigned workerCount = 0);
+        void ShutDown();
+
+        void For(uint32_t count, uint32_t grain, const RangeFunc& body);
+
+        unsigned WorkerCount() const;
+
+    private:
+        void WorkerLoop();
+        void RunChunks(const RangeFunc& body, uint32_t count, uint32_t grain);
+
+        std::vector<std::thread> mWorkers;
+
+        // the loop being run, only changed while no worker is inside it
+        const RangeFunc* mBody = nullptr;
+        uint32_t mCount = 0;
+        uint32_t mGrain = 1;
+        std::atomic<uint32_t> mNext = 0;
+        uint64_t mGeneration = 0;
+        unsigned mActive = 0;
+        bool mStopping = false;
+
+        std::condition_variable mWake;
+        std::condition_variable mDone;
+        std::mutex mMutex;
+    };
+}
+#endif
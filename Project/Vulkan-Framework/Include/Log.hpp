@@ -22,6 +22,11 @@
 #include <sstream>
 #include <ctime>
 
+// set by the project file, builds without one share a log name
+#ifndef PROJECT_NAME
+#define PROJECT_NAME "Vulkan-Framework"
+#endif
+
 #define CHECK_FILE_OPEN(ofs, fname)             \
 if (!ofs)                                       \
 {                                               \
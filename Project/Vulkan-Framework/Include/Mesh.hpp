@@ -15,6 +15,7 @@
 #include "Device.hpp"
 #include "CommandPool.hpp"
 #include "Buffer.hpp"
+#include "Culling.hpp"
 #include <array>
 
 #pragma warning(push)
@@ -51,6 +52,7 @@ namespace VK
         BindingDesc BindingDescription() const;
         AttributeDesc AttributeDescription() const;
         uint32_t IndexCount() const;
+        const VK::Bounds& LocalBounds() const;
         VK::Buffer* Buffer();
         VK::Buffer* IndexBuffer();
 
@@ -65,6 +67,7 @@ namespace VK
 
         std::vector<Vertex> mVertices;
         std::vector<uint32_t> mIndices;
+        VK::Bounds mBounds;
         VK::Buffer mVBO;
         VK::Buffer mIBO;
     };
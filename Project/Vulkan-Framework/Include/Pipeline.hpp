@@ -12,22 +12,101 @@
 #pragma once
 
 #include "Device.hpp"
-#include "SwapChain.hpp"
-#include "RenderPass.hpp"
-#include "Mesh.hpp"
-#include "UBO.hpp"
+#include "ShaderCompiler.hpp"
 #include <string>
+#include <vector>
 
 namespace VK
 {
+    class PipelineCache;
+
+    // a 32 bit value for a layout(constant_id = id) constant
+    struct SpecializationConstant
+    {
+        uint32_t id = 0;
+        uint32_t value = 0;
+
+        bool operator==(const SpecializationConstant& rhs) const
+        {
+            return id == rhs.id && value == rhs.value;
+        }
+    };
+
+    // helpers shared by the graphics and compute descriptions
+    void SetSpecialization(std::vector<SpecializationConstant>& specialization, uint32_t id, uint32_t value);
+    void HashLayout(uint64_t& hash, const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& setLayouts,
+        const std::vector<VkPushConstantRange>& pushConstants);
+    bool SameLayout(const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& lhsSets, const std::vector<VkPushConstantRange>& lhsPush,
+        const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& rhsSets, const std::vector<VkPushConstantRange>& rhsPush);
+
+    // Everything a graphics pipeline is built from. Two equal descriptions
+    // always give the same VkPipeline out of the pipeline cache.
+    struct PipelineDesc
+    {
+        // GLSL or SPIR-V (.spv) files, defines only apply to GLSL
+        std::string vertexPath;
+        std::string fragmentPath;
+        std::vector<ShaderDefine> defines;
+
+        // permutation toggles, given to every stage and sorted by id. A
+        // stage that does not declare a constant ignores it.
+        std::vector<SpecializationConstant> specialization;
+
+        // vertex layout, reflected from the vertex shader when left empty as
+        // one buffer with the inputs packed in location order
+        std::vector<VkVertexInputBindingDescription> vertexBindings;
+        std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+        VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+        // resources, one binding list per descriptor set, immutable samplers
+        // are not supported. Reflected from all stages when left empty.
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> setLayouts;
+        std::vector<VkPushConstantRange> pushConstants;
+
+        // raster
+        VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+        VkPolygonMode polyMode = VK_POLYGON_MODE_FILL;
+        VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+        // depth
+        bool depthTest = true;
+        bool depthWrite = true;
+        VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+
+        // standard alpha blending on every color attachment
+        bool blend = false;
+
+        // attachments, the render pass is only used to compile and is not
+        // part of the key, any pass with the same formats can use the pipeline.
+        // Without a render pass the pipeline is made for dynamic rendering.
+        std::vector<VkFormat> colorFormats;
+        VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        uint32_t subpass = 0;
+
+        void Specialize(uint32_t id, uint32_t value);
+        void Specialize(uint32_t id, int32_t value);
+        void Specialize(uint32_t id, float value);
+        void Specialize(uint32_t id, bool value);
+
+        uint64_t Hash() const;
+        bool operator==(const PipelineDesc& rhs) const;
+    };
+
+    // A pipeline and its layout, both are owned by the pipeline cache.
+    // An async pipeline stands in with its fallback, or with no pipeline at
+    // all, until the background compile is done.
     class PipeLine
     {
     public:
-        void Create(VK::Device& device, VK::RenderPass& renderPass, VK::SwapChain& swapChain, VK::Mesh mesh,
-            std::vector<VkDescriptorSetLayout> uniformBuffer, std::string vertexPath, std::string fragmentPath, unsigned colorAttachCount,
-            VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT, bool depthTest = true, bool depthWrite = true, VkPolygonMode polyMode = VK_POLYGON_MODE_FILL);
+        void Create(VK::Device& device, VK::PipelineCache& cache, const PipelineDesc& desc);
+        void CreateAsync(VK::Device& device, VK::PipelineCache& cache, const PipelineDesc& desc, const VK::PipeLine* fallback = nullptr);
         void ShutDown(VK::Device& device);
 
+        bool Update(VK::Device& device, VK::PipelineCache& cache);
+        bool IsReady() const;
+
         VkPipeline Get() const;
         VkPipeline* GetPointerTo();
 
@@ -38,7 +117,11 @@ namespace VK
         VkPipeline mPipeline = VK_NULL_HANDLE;
         VkPipelineLayout mLayout = VK_NULL_HANDLE;
 
-        VkShaderModule CreateShaderModule(const std::vector<char>& code, VK::Device device);
+        // kept while the compile is pending
+        PipelineDesc mDesc;
+        const VK::PipeLine* mFallback = nullptr;
+        uint64_t mSeenCompleted = 0;
+        bool mReady = false;
     };
 }
 #endif
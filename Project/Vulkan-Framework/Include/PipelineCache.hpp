@@ -0,0 +1,125 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef PIPELINECACHE_H
+#define PIPELINECACHE_H
+#pragma once
+
+#include "Device.hpp"
+#include "Pipeline.hpp"
+#include "ComputePipeline.hpp"
+#include "ShaderCache.hpp"
+#include <unordered_map>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+namespace VK
+{
+    // Owns every pipeline, pipeline layout and descriptor set layout made
+    // on a device. Each unique description is compiled once, layouts are
+    // shared between all pipelines with the same sets and push constants.
+    // Compiles can be handed to worker threads that share the driver cache.
+    class PipelineCache
+    {
+    public:
+        struct Entry
+        {
+            // both VK_NULL_HANDLE while a background compile is pending
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            VkPipelineLayout layout = VK_NULL_HANDLE;
+        };
+
+        struct CompileRecord
+        {
+            std::string name;
+            float milliseconds = 0.0f;
+            bool async = false;
+        };
+
+        void Create(VK::Device& device, const std::string& shaderCacheDirectory, unsigned workerCount = 0);
+        void ShutDown(VK::Device& device);
+
+        Entry GetPipeline(VK::Device& device, const PipelineDesc& desc);
+        Entry RequestPipeline(VK::Device& device, const PipelineDesc& desc);
+        void CancelRenderPass(VkRenderPass renderPass);
+        Entry GetComputePipeline(VK::Device& device, const ComputePipelineDesc& desc);
+        VkPipelineLayout GetLayout(VK::Device& device, const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& setLayouts,
+            const std::vector<VkPushConstantRange>& pushConstants);
+        VkDescriptorSetLayout GetSetLayout(VK::Device& device, const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+        VK::ShaderCache& Shaders();
+        VkPipelineCache Get() const;
+        size_t PipelineCount() const;
+        size_t LayoutCount() const;
+        size_t PendingCount() const;
+        uint64_t CompletedCount() const;
+        std::vector<CompileRecord> CompileTimes() const;
+
+    private:
+        enum class State
+        {
+            Pending,
+            Ready,
+            Failed
+        };
+
+        struct Slot
+        {
+            Entry entry;
+            State state = State::Pending;
+            std::string error; // why it failed
+        };
+
+        struct DescHash
+        {
+            size_t operator()(const PipelineDesc& desc) const;
+        };
+
+        struct ComputeDescHash
+        {
+            size_t operator()(const ComputePipelineDesc& desc) const;
+        };
+
+        // unlocked versions of the public getters
+        VkPipelineLayout FindLayout(VK::Device& device, const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& setLayouts,
+            const std::vector<VkPushConstantRange>& pushConstants);
+        VkDescriptorSetLayout FindSetLayout(VK::Device& device, const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+        Entry CompileNow(std::unique_lock<std::mutex>& lock, VK::Device& device, const PipelineDesc& desc);
+        void WorkerLoop();
+        void Finish(const PipelineDesc& desc, const Entry& entry, float milliseconds, bool async, const std::string& error = std::string());
+        Entry Compile(VK::Device& device, const PipelineDesc& desc);
+        Entry CompileCompute(VK::Device& device, const ComputePipelineDesc& desc);
+
+        VK::Device* mDevice = nullptr;
+        VkPipelineCache mCache = VK_NULL_HANDLE;
+        VK::ShaderCache mShaders;
+        std::unordered_map<PipelineDesc, Slot, DescHash> mPipelines;
+        std::unordered_map<ComputePipelineDesc, Entry, ComputeDescHash> mComputePipelines;
+        std::map<std::vector<uint32_t>, VkPipelineLayout> mLayouts;
+        std::map<std::vector<uint32_t>, VkDescriptorSetLayout> mSetLayouts;
+        std::vector<CompileRecord> mCompileTimes;
+
+        // background compiles
+        std::vector<std::thread> mWorkers;
+        std::deque<PipelineDesc> mJobs;
+        std::vector<VkRenderPass> mCompiling; // of the compiles workers are running
+        size_t mPending = 0;
+        std::atomic<uint64_t> mCompleted = 0;
+        bool mStopping = false;
+        std::condition_variable mJobReady;
+        std::condition_variable mCompileDone;
+        mutable std::mutex mMutex;
+    };
+}
+#endif
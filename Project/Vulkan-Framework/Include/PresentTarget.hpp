@@ -0,0 +1,165 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef PRESENTTARGET_H
+#define PRESENTTARGET_H
+#pragma once
+
+#include "RendererConfig.hpp"
+#include "Device.hpp"
+#include "Surface.hpp"
+#include "SwapChain.hpp"
+#include "CommandPool.hpp"
+#include "CommandBuffer.hpp"
+#include "Semaphore.hpp"
+#include "Fence.hpp"
+#include "RenderGraph.hpp"
+#include "DynamicResolution.hpp"
+#include "Pipeline.hpp"
+#include "PipelineCache.hpp"
+#include "UBO.hpp"
+#include "Mesh.hpp"
+#include "GpuCulling.hpp"
+#include "InstanceBuffer.hpp"
+#include "FrameQueue.hpp"
+#include <atomic>
+#include <string>
+
+struct GLFWwindow;
+typedef GLFWwindow* WindowPtr;
+
+namespace VK
+{
+    struct MatrixBuffer
+    {
+        glm::mat4 world = {};
+        glm::mat4 view = {};
+        glm::mat4 proj = {};
+    };
+
+    // what every target draws in a frame
+    struct FrameScene
+    {
+        MatrixBuffer matrices;
+
+        // the CPU culled instanced draws and their world matrices, no
+        // batches and the scene pass only clears
+        std::vector<DrawBatch> batches;
+        std::vector<glm::mat4> instances;
+
+        // every object, for targets that cull on the GPU, with the indices
+        // of those that changed since the last frame
+        std::vector<GpuObject> objects;
+        std::vector<uint32_t> changed;
+    };
+
+    struct PresentTargetDesc
+    {
+        // offscreen images instead of a window
+        bool headless = false;
+        int width = 900;
+        int height = 900;
+        std::string title = "Vulkan-Framework";
+    };
+
+    // A window and its swap chain, or a ring of offscreen images, with
+    // everything it takes to draw the scene into it. The device, command
+    // pool and assets belong to the renderer and are shared by all targets.
+    class PresentTarget
+    {
+    public:
+        void OpenWindow(VK::Instance& instance, const PresentTargetDesc& desc);
+        void Create(VK::Device& device, VK::CommandPool& commandPool, VK::PipelineCache& pipelineCache, VK::Mesh& mesh, const RendererConfig& config);
+        void Recreate(VK::Device& device, VK::CommandPool& commandPool, VK::PipelineCache& pipelineCache, VK::Mesh& mesh, const RendererConfig& config);
+        void ShutDown(VK::Instance& instance, VK::Device& device, VK::CommandPool& commandPool);
+
+        void InitSyncObjects(VK::Device& device, unsigned framesInFlight);
+        void ShutdownSyncObjects(VK::Device& device);
+
+        VkResult Acquire(VK::Device& device, size_t frame, VK::Fence& frameFence, FrameScene& scene);
+
+        void SetBudget(float budgetMs);
+        void Resize(int width, int height);
+        bool TakeResized();
+        bool ShouldClose() const;
+
+        WindowPtr Window() const;
+        VK::Surface& GetSurface();
+        VK::SwapChain& GetSwapChain();
+        bool IsHeadless() const;
+        float AspectRatio() const;
+        VkImageLayout ColorFinalLayout() const;
+        const VK::GpuCullingStats& CullingStats() const;
+        const std::vector<VK::GpuScopeStats>& GpuScopes() const;
+        float GpuFrameTime() const;
+        float WaitTime() const;
+
+        // valid after a successful Acquire
+        uint32_t ImageIndex() const;
+        VkImage Image();
+        VkCommandBuffer CommandBuffer() const;
+        VkSemaphore ImageAvailable(size_t frame) const;
+        VkSemaphore RenderFinished(size_t frame) const;
+
+    private:
+        void InitSwapChain(VK::Device& device, const RendererConfig& config);
+        void InitDynamicResolution(VK::Device& device, const RendererConfig& config);
+        void InitRenderGraph(VK::Device& device, VK::Mesh& mesh);
+        void InitPipelines(VK::Device& device, VK::PipelineCache& pipelineCache, VK::Mesh& mesh, const RendererConfig& config);
+        void UpdateCommandBuffers();
+        void RecordCommandBuffer(unsigned i);
+        void ShutdownSwapChain(VK::Device& device, VK::CommandPool& commandPool);
+
+        VkFormat FindDepthFormat(VK::Device& device);
+        VkExtent2D SceneExtent() const;
+
+        WindowPtr mWindow = nullptr;
+        VK::Surface mSurface;
+        VK::SwapChain mSwapChain;
+        bool mHeadless = false;
+        std::atomic<int> mWidth = 900;
+        std::atomic<int> mHeight = 900;
+        std::atomic<bool> mResized = false;
+
+        VK::CommandBuffer mCommandBuffer;
+        VK::RenderGraph mRenderGraph;
+        unsigned mScenePass = 0;
+        unsigned mLateScenePass = 0;
+        VK::RenderGraphResource mDepth = 0;
+        VK::DynamicResolution mDynamicResolution;
+        VK::GpuProfiler mGpuProfiler;
+        std::vector<VkExtent2D> mRecordedExtents;
+        std::vector<VkPipeline> mRecordedPipelines;
+        std::vector<std::vector<DrawBatch>> mRecordedBatches;
+        std::vector<DrawBatch> mBatches;
+
+        VK::UBO mMatrixBuffer;
+        VK::PipelineCache* mPipelineCache = nullptr;
+        VkRenderPass mPipelinePass = VK_NULL_HANDLE; // compiled against, owned by the graph
+        VK::PipeLine mPipeline;
+        VK::InstanceBuffer mInstances;
+
+        // draws come from a compute pass instead of the recorded mesh
+        VK::GpuCulling mGpuCulling;
+        bool mGpuDriven = false;
+
+        // the GPU culling also tests against a pyramid of the early depth
+        VK::DepthPyramid mDepthPyramid;
+        bool mOcclusion = false;
+
+        std::vector<VK::Semaphore> mImageAvailableSemaphores;
+        std::vector<VK::Semaphore> mRenderFinishedSemaphores;
+        std::vector<VK::Fence> mImagesInFlight;
+
+        uint32_t mImageIndex = 0;
+        uint32_t mHeadlessImage = 0;
+        float mWaitMs = 0;
+    };
+}
+#endif
@@ -0,0 +1,100 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef READBACK_H
+#define READBACK_H
+#pragma once
+
+#include "Device.hpp"
+#include "CommandPool.hpp"
+#include "CommandBuffer.hpp"
+#include "Buffer.hpp"
+#include "Fence.hpp"
+#include "Semaphore.hpp"
+#include <functional>
+
+namespace VK
+{
+    enum class ReadbackFormat
+    {
+        Native, // whatever the color image is, tiles are left as is
+        RGB8,
+        RGBA8,
+        BGRA8
+    };
+
+    enum class ReadbackCopy
+    {
+        Linear, // one region, rows are contiguous
+        Tiled   // tileSize x tileSize regions, each tile is contiguous
+    };
+
+    struct ReadbackDesc
+    {
+        unsigned slotCount = 3;
+        ReadbackFormat format = ReadbackFormat::Native;
+        ReadbackCopy copy = ReadbackCopy::Linear;
+        uint32_t tileSize = 64;
+    };
+
+    struct ReadbackFrame
+    {
+        uint64_t frame = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        ReadbackFormat format = ReadbackFormat::Native;
+        uint32_t tileSize = 0; // 0 when the data is linear
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    typedef std::function<void(const ReadbackFrame&)> ReadbackCallback;
+
+    class Readback
+    {
+    public:
+        void Create(VK::Device& device, VK::CommandPool& commandPool, VkExtent2D extent, VkFormat format,
+            const ReadbackDesc& desc, ReadbackCallback callback);
+        void ShutDown(VK::Device& device, VK::CommandPool& commandPool);
+
+        void Capture(VK::Device& device, VkQueue queue, VkImage image, VkImageLayout layout, VkSemaphore signalSemaphore);
+        void Poll(VK::Device& device);
+        void Flush(VK::Device& device);
+
+        bool IsActive() const;
+
+    private:
+        struct Slot
+        {
+            VK::Buffer buffer;
+            VK::Fence fence;
+            uint8_t* mapped = nullptr;
+            uint64_t frame = 0;
+            bool pending = false;
+        };
+
+        void Record(unsigned slot, VkImage image, VkImageLayout layout);
+        void Deliver(VK::Device& device, Slot& slot);
+
+        std::vector<Slot> mSlots;
+        VK::CommandBuffer mCommandBuffers;
+        std::vector<VkBufferImageCopy> mRegions;
+        std::vector<uint8_t> mConverted;
+        ReadbackCallback mCallback;
+        ReadbackDesc mDesc;
+
+        VkExtent2D mExtent = {};
+        VkFormat mFormat = VK_FORMAT_UNDEFINED;
+        VkDeviceSize mSize = 0;
+        bool mCoherent = false;
+        unsigned mNextSlot = 0;
+        uint64_t mFrame = 0;
+    };
+}
+#endif
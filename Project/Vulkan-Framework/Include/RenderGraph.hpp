@@ -0,0 +1,207 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+#pragma once
+
+#include "Device.hpp"
+#include "RenderPass.hpp"
+#include "FrameBuffer.hpp"
+#include "ImageView.hpp"
+#include "Image.hpp"
+#include "GpuProfiler.hpp"
+#include <functional>
+#include <string>
+
+namespace VK
+{
+    typedef uint32_t RenderGraphResource;
+
+    struct RenderGraphImageDesc
+    {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent = { 0, 0 }; // 0 uses the extent passed to Compile
+        VkClearValue clear = {};      // used by the first pass that writes it
+    };
+
+    struct RenderGraphStats
+    {
+        unsigned passes = 0;
+        unsigned culledPasses = 0;
+        unsigned barriers = 0;        // image barriers outside of render passes
+        unsigned transientImages = 0;
+        unsigned memoryBlocks = 0;
+        VkDeviceSize transientBytes = 0; // what the transients would take unaliased
+        VkDeviceSize allocatedBytes = 0;
+    };
+
+    // Passes declare what they read and write, Compile culls the passes nothing
+    // consumes, builds their render passes and framebuffers, works out the
+    // layout transitions and lets transient images with disjoint lifetimes
+    // share memory. Passes run in the order they were added. On a device
+    // with dynamic rendering no render pass or framebuffer is made, passes
+    // render straight into the image views and attachments get barriers.
+    class RenderGraph
+    {
+    public:
+        class PassBuilder
+        {
+        public:
+            void WriteColor(RenderGraphResource resource);
+            void WriteDepth(RenderGraphResource resource);
+            void ReadDepth(RenderGraphResource resource);
+            void ReadTexture(RenderGraphResource resource);
+            void ReadTransfer(RenderGraphResource resource);
+            void WriteTransfer(RenderGraphResource resource);
+            void SideEffect();
+
+        private:
+            friend class RenderGraph;
+            PassBuilder(RenderGraph& graph, unsigned pass);
+            void Use(RenderGraphResource resource, VkImageLayout layout, VkImageUsageFlags usage, bool write, bool attachment);
+
+            RenderGraph& mGraph;
+            unsigned mPass;
+        };
+
+        typedef std::function<void(PassBuilder&)> SetupFunc;
+        typedef std::function<void(VkCommandBuffer, uint32_t)> ExecuteFunc;
+
+        RenderGraphResource CreateImage(const std::string& name, const RenderGraphImageDesc& desc);
+        RenderGraphResource ImportImage(const std::string& name, const std::vector<VkImage>& images, const std::vector<VkImageView>& views,
+            VkFormat format, VkExtent2D extent, VkImageLayout finalLayout, VkClearValue clear = {});
+        unsigned AddPass(const std::string& name, SetupFunc setup, ExecuteFunc execute);
+
+        void Compile(VK::Device& device, VkExtent2D extent);
+        void Execute(VkCommandBuffer commandBuffer, uint32_t imageIndex, VK::GpuProfiler* profiler = nullptr);
+        void ShutDown(VK::Device& device);
+
+        void SetRenderArea(unsigned pass, VkExtent2D extent);
+
+        VK::RenderPass& GetRenderPass(unsigned pass);
+        VkImage GetImage(RenderGraphResource resource, uint32_t imageIndex = 0) const;
+        VkImageView GetView(RenderGraphResource resource, uint32_t imageIndex = 0) const;
+        bool IsCulled(unsigned pass) const;
+        const RenderGraphStats& Stats() const;
+
+    private:
+        struct Access
+        {
+            RenderGraphResource resource;
+            VkImageLayout layout;
+            VkPipelineStageFlags stage;
+            VkAccessFlags access;
+            bool write;
+            bool attachment;
+        };
+
+        struct Resource
+        {
+            std::string name;
+            RenderGraphImageDesc desc;
+            VkImageUsageFlags usage = 0;
+            VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            bool imported = false;
+
+            // one entry per swap chain image when imported, otherwise one
+            std::vector<VkImage> images;
+            std::vector<VkImageView> views;
+
+            // filled by Compile
+            VK::ImageView ownedView;
+            int firstPass = -1;
+            int lastPass = -1;
+            int block = -1;
+            VkMemoryRequirements requirements = {};
+        };
+
+        struct RenderingAttachment
+        {
+            RenderGraphResource resource;
+            VkImageLayout layout;
+            VkAttachmentLoadOp loadOp;
+            VkAttachmentStoreOp storeOp;
+            VkClearValue clear;
+            bool stencil;
+        };
+
+        struct Barrier
+        {
+            RenderGraphResource resource;
+            VkImageMemoryBarrier barrier;
+        };
+
+        struct Pass
+        {
+            std::string name;
+            ExecuteFunc execute;
+            std::vector<Access> accesses;
+            bool sideEffect = false;
+            bool culled = false;
+
+            // filled by Compile
+            VK::RenderPass renderPass;
+            std::vector<VK::FrameBuffer> frameBuffers;
+            std::vector<VkClearValue> clears;
+            std::vector<RenderingAttachment> colorAttachments; // dynamic rendering only
+            std::vector<RenderingAttachment> depthAttachment;  // dynamic rendering only, at most one
+            std::vector<Barrier> barriers;
+            VkPipelineStageFlags srcStage = 0;
+            VkPipelineStageFlags dstStage = 0;
+            VkExtent2D extent = {};
+            VkExtent2D renderArea = {}; // 0 renders the whole extent
+        };
+
+        struct State
+        {
+            VkImageLayout layout;
+            VkPipelineStageFlags stage;
+            VkAccessFlags access;
+            bool written;
+        };
+
+        struct Block
+        {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            uint32_t typeBits = ~0u;
+            std::vector<RenderGraphResource> residents;
+        };
+
+        void CullPasses();
+        void CreateTransients(VK::Device& device, VkExtent2D extent);
+        void AliasTransients(VK::Device& device);
+        void CreatePasses(VK::Device& device, VkExtent2D extent);
+        State StartState(RenderGraphResource resource) const;
+        State EndState(RenderGraphResource resource) const;
+        bool NeedsBarrier(const State& state, const Access& access) const;
+        void AddBarrier(Pass& pass, const State& state, const Access& access);
+        void BeginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, const Pass& pass);
+        void FlushBarriers(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::vector<Barrier>& barriers,
+            VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
+
+        std::vector<Resource> mResources;
+        std::vector<Pass> mPasses;
+        std::vector<Block> mBlocks;
+
+        // post graph transitions of imported images that no render pass did
+        std::vector<Barrier> mFinalBarriers;
+        VkPipelineStageFlags mFinalSrcStage = 0;
+        VkPipelineStageFlags mFinalDstStage = 0;
+
+        std::vector<VkImageMemoryBarrier> mScratch;
+        std::vector<VkRenderingAttachmentInfoKHR> mAttachmentScratch;
+        RenderGraphStats mStats;
+
+        // set by Compile when the device renders without render passes
+        const VK::Device* mDynamicRendering = nullptr;
+    };
+}
+#endif
@@ -15,75 +15,75 @@
 #include "Instance.hpp"
 #include "DebugMessenger.hpp"
 #include "Device.hpp"
-#include "Surface.hpp"
-#include "SwapChain.hpp"
-#include "RenderPass.hpp"
 #include "CommandPool.hpp"
-#include "Pipeline.hpp"
-#include "UBO.hpp"
-#include "CommandBuffer.hpp"
-#include "Semaphore.hpp"
 #include "Fence.hpp"
-#include "Image.hpp"
-#include "CommandBuffer.hpp"
 #include "Mesh.hpp"
-#include <unordered_map>
+#include "PipelineCache.hpp"
+#include "RendererConfig.hpp"
+#include "PresentTarget.hpp"
 #include <vector>
-#include "Sampler.hpp"
-
-struct GLFWwindow;
-typedef GLFWwindow* WindowPtr;
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include "Readback.hpp"
+#include "FrameQueue.hpp"
 
 namespace VK 
 {
-    struct MatrixBuffer
-    {
-        glm::mat4 world = {};
-        glm::mat4 view = {};
-        glm::mat4 proj = {};
-    };
-  
     class Renderer 
     {
 
     public:
 
-        Renderer();
+        Renderer(const RendererConfig& config = RendererConfig());
         ~Renderer();
-        void Draw(float dt);
+        void Draw(const FramePacket& packet);
+        void PollEvents();
         void WaitIdle() const;
+        float AspectRatio() const;
+
+        void SetConfig(const RendererConfig& config);
+        const RendererConfig& Config() const;
+
+        void EnableReadback(const ReadbackDesc& desc, ReadbackCallback callback);
+        void DisableReadback();
 
+        unsigned AddTarget(const PresentTargetDesc& desc);
+        void RemoveTarget(unsigned target);
+        void ResizeTarget(unsigned target, int width, int height);
+        unsigned TargetCount() const;
 
         WindowPtr Window() const;
         VK::Device Device() const;
         VK::CommandPool CommandPool() const;
+        const VK::PipelineCache& PipelineCache() const;
+        const VK::Bounds& MeshBounds(uint32_t mesh) const;
+        bool GpuCulling() const;
+        VK::GpuCullingStats CullingStats() const;
+        std::vector<VK::GpuScopeStats> GpuScopes();
+        VK::FrameStatsReport FrameReport() const;
+        bool WriteFrameCsv(const std::string& path) const;
+        void ResetFrameClock();
+        bool ExportFrameStats();
         VkQueue GraphicsQueue() const;
 
     private:
 
-        /* friends */
-        friend static void FramebufferResizeCallback(WindowPtr window, int width, int height);
-
         /* Functions */
         void InitGLFW();
-        void InitWindow();
         void InitVulkan();
         void InitSyncObjects();
-        void InitRenderPass();
-        void InitDepthResources();
-        void InitPipelines();
-        void InitFramebuffers();
+        void InitReadback();
 
-        void UpdateCommandBuffers();
-        void RecreateSwapChain();
+        void RecreateTarget(PresentTarget& target);
+        void ApplyConfig();
 
         void ShutdownGLFW();
-        void ShutdownWindow();
         void ShutdownVulkan();
-        void ShutdownSwapChain();
+        void ShutdownSyncObjects();
 
         /* helpers */
-        VkFormat FindDepthFormat();
         void DrawFrame(float dt);
 
         /* Variables */
@@ -91,36 +91,59 @@ namespace VK
         VK::Device mDevice;
         VK::DebugMessenger mDebugMessenger;
 
-        VK::Surface mSurface;
-        VK::SwapChain mSwapChain;
-        std::vector<VK::FrameBuffer> mFrameBuffers;
+        // target 0 is the main window, the device was picked for its surface
+        // only changed on the thread that polls events, DrawFrame reads it
+        // under the mutex
+        std::vector<std::unique_ptr<VK::PresentTarget>> mTargets;
+        VK::PresentTarget* mMainTarget = nullptr;
+        mutable std::mutex mTargetMutex;
 
         VK::CommandPool mCommandPool;
-        VK::CommandBuffer mCommandBuffer;
+        VK::PipelineCache mPipelineCache;
 
-        VK::Image mDepthTexture;
-        VK::RenderPass mRenderPass;
+        VK::FrameScene mFrameScene;
 
-        VK::MatrixBuffer mMatrixBufferData;
-        VK::UBO mMatrixBuffer;
-        VK::PipeLine mPipeline;
+        // reads back the main target
+        VK::Readback mReadback;
+        VK::ReadbackDesc mReadbackDesc;
+        VK::ReadbackCallback mReadbackCallback;
+        bool mReadbackEnabled = false;
 
-        std::vector<VK::Semaphore> mImageAvailableSemaphores;
-        std::vector<VK::Semaphore> mRenderFinishedSemaphores;
         std::vector<VK::Fence> mInFlightFences;
-        std::vector<VK::Fence> mImagesInFlight;
+
+        // one submit and one present for every target each frame
+        std::vector<VK::PresentTarget*> mFrameTargets;
+        std::vector<VkSemaphore> mWaitSemaphores;
+        std::vector<VkPipelineStageFlags> mWaitStages;
+        std::vector<VkCommandBuffer> mSubmitBuffers;
+        std::vector<VkSemaphore> mSignalSemaphores;
+        std::vector<VkSwapchainKHR> mPresentSwapChains;
+        std::vector<uint32_t> mPresentImages;
+        std::vector<VK::PresentTarget*> mPresentTargets;
+        std::vector<VkResult> mPresentResults;
 
         VkQueue mGraphicsQueue = 0;
         VkQueue mPresentQueue = 0;
 
-        WindowPtr mWindow = nullptr;
-        int mWindowWidth = 900;
-        int mWindowHeight = 900;
-        const int mMaxFramesInFlight = 2;
+        RendererConfig mConfig;
+        RendererConfig mPendingConfig;
+        unsigned mMaxFramesInFlight = 2;
         size_t mCurrentFrame = 0;
-        bool mFramebufferResized = false;
 
-        /* Test scene */
+        // timed by Draw, the waits by DrawFrame
+        VK::FrameStats mFrameStats;
+        std::chrono::steady_clock::time_point mLastDraw;
+        bool mDrawn = false;
+        float mFrameWaitMs = 0;
+        std::atomic<bool> mConfigChanged = false;
+        std::mutex mConfigMutex;
+
+        // read by the simulation thread while the render thread applies a
+        // config or the main target is resized
+        std::atomic<bool> mGpuCulling = false;
+        std::atomic<float> mAspectRatio = 1.0f;
+
+        /* Test scene, shared by every target */
         VK::Mesh mMesh;  
 
 
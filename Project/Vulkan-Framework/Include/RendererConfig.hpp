@@ -0,0 +1,86 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef RENDERERCONFIG_H
+#define RENDERERCONFIG_H
+#pragma once
+
+#include "DynamicResolution.hpp"
+#include "FrameStats.hpp"
+#include <vector>
+#include <string>
+
+namespace VK
+{
+    struct RendererConfig
+    {
+        // number of frames the CPU may record ahead of the GPU [1, 4]
+        unsigned framesInFlight = 2;
+
+        // present modes in order of preference, FIFO is the fallback
+        std::vector<VkPresentModeKHR> presentModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR };
+
+        // minimum swap chain images, 0 uses the surface minimum + 1
+        // (headless: number of offscreen images, 0 uses framesInFlight + 1)
+        uint32_t minImageCount = 0;
+
+        // render into offscreen images without GLFW, a window or a surface,
+        // fixed at creation like the initial size
+        bool headless = false;
+        int width = 900;
+        int height = 900;
+
+        // compile new pipelines on worker threads, draws are skipped until
+        // they are ready instead of stalling the frame. Used whenever a
+        // target builds its pipelines.
+        bool asyncPipelines = true;
+
+        // compiled GLSL is kept here between runs
+        std::string shaderCacheDirectory = "../Resource/Shaders/Cache";
+
+        // render without render pass and framebuffer objects through
+        // VK_KHR_dynamic_rendering when the GPU has it, fixed at creation
+        bool dynamicRendering = false;
+
+        // cull on the GPU and draw everything with one indirect count draw
+        // when the GPU has drawIndirectCount, fixed at creation. The
+        // capacity is the most objects a frame can hold.
+        bool gpuCulling = false;
+        uint32_t gpuObjectCapacity = 65536;
+
+        // with gpuCulling, also leave out what last frame's depth hides.
+        // The scene is drawn in two phases around a depth pyramid build,
+        // fixed at creation.
+        bool occlusionCulling = false;
+
+        // most instances the CPU culled draws of a frame can hold
+        uint32_t instanceCapacity = 65536;
+
+        // render the scene into a max size target and blit it up to the
+        // swap chain, the rendered area shrinks when the GPU is over budget
+        bool dynamicResolution = false;
+        DynamicResolutionDesc resolution;
+
+        // time the frame and every render graph pass with GPU timestamps,
+        // read back without stalling, fixed at creation
+        bool gpuProfiling = true;
+
+        // capture the first traceFrames frames, startup included, with
+        // CpuProfiler and write them to tracePath as Chrome trace JSON.
+        // Needs a debug build or one with VK_PROFILE defined, 0 captures
+        // nothing.
+        uint32_t traceFrames = 0;
+        std::string tracePath = "trace.json";
+
+        // frame time percentiles, hitches and their export, fixed at
+        // creation
+        FrameStatsDesc frameStats;
+    };
+}
+#endif
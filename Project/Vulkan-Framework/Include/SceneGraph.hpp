@@ -0,0 +1,87 @@
+/****************************************************************************/
+/*!
+\file
+   SceneGraph.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Transform hierarchy, local to world propagation
+*/
+/****************************************************************************/
+#ifndef SCENEGRAPH_HPP
+#define SCENEGRAPH_HPP
+#pragma once
+
+#include "JobPool.hpp"
+#include <glm.hpp>
+#include <vector>
+
+namespace VK
+{
+    // handle to a node, stays the same for the life of the graph
+    typedef uint32_t SceneNode;
+    static const SceneNode NoNode = ~0u;
+
+    // Transforms stored as parallel arrays, sorted by depth so every parent
+    // comes before its children and the children of a node are next to each
+    // other. Update only visits nodes whose local transform changed and
+    // their descendants, one depth level at a time, with each level split
+    // across the job pool.
+    class SceneGraph
+    {
+    public:
+        SceneNode Create(SceneNode parent = NoNode);
+        void SetParent(SceneNode node, SceneNode parent);
+        void SetLocal(SceneNode node, const glm::mat4& local);
+
+        void Update(VK::JobPool& jobs);
+
+        void Reserve(uint32_t count);
+        void Clear();
+
+        SceneNode Parent(SceneNode node) const;
+        const glm::mat4& Local(SceneNode node) const;
+        const glm::mat4& World(SceneNode node) const;
+
+        uint32_t Size() const;
+        uint32_t LevelCount() const;
+
+        // nodes whose world transform the last Update wrote
+        const std::vector<SceneNode>& Changed() const;
+
+    private:
+        void MarkDirty(uint32_t slot);
+        void Rebuild();
+        void Propagate(VK::JobPool& jobs, const std::vector<uint32_t>& slots);
+
+        // by node
+        std::vector<uint32_t> mSlotOf;
+        std::vector<SceneNode> mParentNode;
+
+        // by slot, in depth order once rebuilt
+        std::vector<SceneNode> mNodeOf;
+        std::vector<uint32_t> mParent;
+        std::vector<uint32_t> mLevel;
+        std::vector<uint32_t> mFirstChild;
+        std::vector<uint32_t> mChildCount;
+        std::vector<glm::mat4> mLocal;
+        std::vector<glm::mat4> mWorld;
+        std::vector<uint8_t> mDirty;
+
+        // first slot of each depth level, plus the end
+        std::vector<uint32_t> mLevelStart;
+
+        // slots set since the last update, and the update's work per level
+        std::vector<uint32_t> mDirtyList;
+        std::vector<std::vector<uint32_t>> mLevelWork;
+        std::vector<SceneNode> mChanged;
+
+        // nodes were added or moved, the order is rebuilt on update
+        bool mStructureChanged = false;
+    };
+}
+
+#endif
@@ -0,0 +1,52 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+#pragma once
+
+#include "Device.hpp"
+#include "ShaderCompiler.hpp"
+#include "ShaderReflection.hpp"
+#include <map>
+#include <mutex>
+
+namespace VK
+{
+    // Every shader module made on a device, each file and define set is
+    // loaded or compiled once and the module is shared by all pipelines.
+    // .spv files are loaded as they are, anything else is GLSL.
+    class ShaderCache
+    {
+    public:
+        struct Module
+        {
+            VkShaderModule module = VK_NULL_HANDLE;
+            VK::ShaderReflection reflection;
+        };
+
+        void Create(const std::string& cacheDirectory, const std::vector<std::string>& includeDirectories = {});
+        void ShutDown(VK::Device& device);
+
+        const Module& Get(VK::Device& device, const std::string& path, const std::vector<ShaderDefine>& defines = {});
+        VkShaderModule GetModule(VK::Device& device, const std::string& path, const std::vector<ShaderDefine>& defines = {});
+
+        VK::ShaderCompiler& Compiler();
+        size_t ModuleCount() const;
+
+    private:
+        std::vector<uint32_t> Load(const std::string& path, const std::vector<ShaderDefine>& defines);
+        VkShaderModule CreateShaderModule(VK::Device& device, const std::vector<uint32_t>& code);
+
+        VK::ShaderCompiler mCompiler;
+        std::map<std::string, Module> mModules;
+        mutable std::mutex mMutex;
+    };
+}
+#endif
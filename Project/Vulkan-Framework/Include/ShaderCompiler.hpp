@@ -0,0 +1,66 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef SHADERCOMPILER_H
+#define SHADERCOMPILER_H
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+namespace VK
+{
+    struct ShaderDefine
+    {
+        std::string name;
+        std::string value;
+
+        bool operator==(const ShaderDefine& rhs) const
+        {
+            return name == rhs.name && value == rhs.value;
+        }
+    };
+
+    // Turns GLSL into SPIR-V at runtime. #include "file" is resolved against
+    // the including file, then the include directories, and every file is
+    // included once. Defines go in right after #version. Results are kept
+    // in a disk cache keyed by the expanded source, the defines and the
+    // compiler, so only edited shaders are compiled again.
+    //
+    // Built with VK_SHADERC the shaderc library of the Vulkan SDK does the
+    // work in process, otherwise glslc from $VULKAN_SDK or the PATH is run.
+    class ShaderCompiler
+    {
+    public:
+        void Create(const std::string& cacheDirectory, const std::vector<std::string>& includeDirectories = {});
+
+        std::vector<uint32_t> Compile(const std::string& path, const std::vector<ShaderDefine>& defines = {});
+        std::string Preprocess(const std::string& path, const std::vector<ShaderDefine>& defines = {});
+
+        const std::string& Version() const;
+        size_t CacheHits() const;
+        size_t CacheMisses() const;
+
+    private:
+        void Expand(const std::string& path, std::vector<std::string>& included, std::string& out);
+        std::string FindInclude(const std::string& parent, const std::string& name) const;
+        std::vector<uint32_t> Invoke(const std::string& path, const std::string& source, const std::string& name);
+
+        std::string mCacheDirectory;
+        std::vector<std::string> mIncludeDirectories;
+        std::string mGlslc;
+        std::string mVersion;
+
+        std::atomic<size_t> mHits = 0;
+        std::atomic<size_t> mMisses = 0;
+    };
+}
+#endif
@@ -0,0 +1,67 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+#ifndef SHADERREFLECTION_H
+#define SHADERREFLECTION_H
+#pragma once
+
+#include "Device.hpp"
+#include <vector>
+
+namespace VK
+{
+    struct ReflectedBinding
+    {
+        uint32_t set = 0;
+        VkDescriptorSetLayoutBinding binding = {};
+    };
+
+    struct ReflectedInput
+    {
+        uint32_t location = 0;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+    };
+
+    // What a SPIR-V module uses: descriptors, push constants and, for vertex
+    // shaders, the input locations. Reflections of all stages of a pipeline
+    // are merged into one before layouts are made from them.
+    class ShaderReflection
+    {
+    public:
+        void Create(const std::vector<uint32_t>& code);
+        void Merge(const ShaderReflection& other);
+
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> SetLayouts() const;
+        std::vector<VkPushConstantRange> PushConstants() const;
+        void VertexInput(std::vector<VkVertexInputBindingDescription>& bindings,
+            std::vector<VkVertexInputAttributeDescription>& attributes) const;
+
+        VkShaderStageFlags Stages() const;
+        const std::vector<ReflectedBinding>& Bindings() const;
+        const std::vector<ReflectedInput>& Inputs() const;
+        const std::vector<uint32_t>& SpecializationIds() const;
+        const uint32_t* LocalSize() const;
+
+    private:
+        VkShaderStageFlags mStages = 0;
+        std::vector<ReflectedBinding> mBindings;
+        std::vector<ReflectedInput> mInputs;
+        std::vector<uint32_t> mSpecializationIds;
+
+        // compute workgroup size, 1 1 1 for other stages or when it comes
+        // from specialization constants
+        uint32_t mLocalSize[3] = { 1, 1, 1 };
+
+        // one range over everything any stage pushes
+        VkShaderStageFlags mPushStages = 0;
+        uint32_t mPushOffset = 0;
+        uint32_t mPushSize = 0;
+    };
+}
+#endif
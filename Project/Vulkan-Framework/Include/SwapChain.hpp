@@ -14,6 +14,7 @@
 #include "Instance.hpp"
 #include "Device.hpp"
 #include "ImageView.hpp"
+#include "Image.hpp"
 
 namespace VK
 {
@@ -21,16 +22,21 @@ namespace VK
     {
     public:
 
-        void Create(VK::Surface& surface, VK::Device& device, GLFWwindow* window);
+        void Create(VK::Surface& surface, VK::Device& device, GLFWwindow* window,
+            const std::vector<VkPresentModeKHR>& presentModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR }, uint32_t minImageCount = 0);
+        void CreateHeadless(VK::Device& device, VkExtent2D extent, uint32_t imageCount);
         void ShutDown(VK::Device& device);
 
         VkSwapchainKHR Get() const;
+        bool IsHeadless() const;
         VkSwapchainKHR* GetPointerTo();
 
         std::vector<VkImage>* Images();
         std::vector<VK::ImageView>* ImageViews();
         VkFormat Format() const;
         VkExtent2D Extent() const;
+        VkPresentModeKHR PresentMode() const;
+        VkImageUsageFlags ImageUsage() const;
 
     private:
         VkSwapchainKHR mSwapChain = VK_NULL_HANDLE;
@@ -38,6 +44,11 @@ namespace VK
         std::vector<VkImage> mImages;
         std::vector<VK::ImageView> mImageViews;
         VkFormat mImageFormat;
+        VkPresentModeKHR mPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+        VkImageUsageFlags mImageUsage = 0;
+
+        // headless mode renders into these instead of presentable images
+        std::vector<VK::Image> mOffscreenImages;
 
         struct SwapChainSupportDetails
         {
@@ -48,7 +59,8 @@ namespace VK
 
         SwapChainSupportDetails QuerySwapChainSupport(VK::Surface& surface, VK::Device& device);
         VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-        VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+        VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, const std::vector<VkPresentModeKHR>& preferredPresentModes);
+        uint32_t ChooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities, uint32_t minImageCount);
         VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window);
     };
 }
@@ -29,6 +29,7 @@ namespace VK
 
         VkDescriptorSetLayout Layout();
         VkDescriptorSetLayout* GetPointerToLayout();
+        const std::vector<VkDescriptorSetLayoutBinding>& Bindings() const;
         VkDescriptorPool Pool();
         VkDescriptorPool* GetPointerToPool();
         std::vector<VkDescriptorSet>* Sets();
@@ -19,7 +19,9 @@
 
 // Vulkan & GLFW
 #define GLFW_INCLUDE_VULKAN
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
+#endif
 #include "glfw3.h"
 #include "glfw3native.h"
 
@@ -0,0 +1,402 @@
+/****************************************************************************/
+/*!
+\file
+   Benchmark.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Headless repeatable benchmark scenarios with JSON results
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "Benchmark.hpp"
+#include "Engine.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+struct Scenario
+{
+    const char* name;
+    uint32_t objects;
+    bool unique;  // every object its own batch
+    bool resize;  // resize the target every few frames
+    bool startup; // short, only the startup phases matter
+    bool cold;    // start without compiled shaders
+};
+
+// cold runs first so it finds nothing compiled
+static const Scenario Scenarios[] =
+{
+    { "startup-cold", 1000, false, false, true, true },
+    { "startup-warm", 1000, false, false, true, false },
+    { "instanced", 8000, false, false, false, false },
+    { "unique", 2000, true, false, false, false },
+    { "resize", 1000, false, true, false, false },
+};
+
+// frames the startup scenarios draw
+static const uint32_t StartupFrames = 30;
+
+// seconds every frame advances the simulation
+static const float FixedStep = 1.0f / 60.0f;
+
+// frames between resizes, and the sizes gone through
+static const uint32_t ResizeInterval = 10;
+static const int ResizeSizes[][2] = { { 640, 360 }, { 1920, 1080 }, { 800, 800 }, { 1280, 720 } };
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Milliseconds between two times
+*/
+/****************************************************************************/
+static double Milliseconds(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Megabytes the process has resident right now, negative when unknown
+*/
+/****************************************************************************/
+static double ResidentMB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return -1;
+
+    return double(counters.WorkingSetSize) / (1024.0 * 1024.0);
+#else
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident))
+        return -1;
+
+    return double(resident) * double(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+#endif
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Most megabytes the process ever had resident, negative when unknown
+*/
+/****************************************************************************/
+static double PeakResidentMB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return -1;
+
+    return double(counters.PeakWorkingSetSize) / (1024.0 * 1024.0);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+
+    // kilobytes on Linux
+    return double(usage.ru_maxrss) / 1024.0;
+#endif
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Name of a kind of GPU, cpu for software implementations
+*/
+/****************************************************************************/
+static const char* DeviceTypeName(VkPhysicalDeviceType type)
+{
+    switch (type)
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+    default: return "other";
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write a string as a JSON string
+*/
+/****************************************************************************/
+static void WriteJsonString(std::ofstream& file, const std::string& text)
+{
+    file << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            file << '\\' << c;
+        else if (static_cast<unsigned char>(c) >= 0x20)
+            file << c;
+    }
+    file << '"';
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write a summary as a JSON object
+*/
+/****************************************************************************/
+static void WriteSummary(std::ofstream& file, const VK::FrameTimeSummary& summary)
+{
+    file << "{\"count\":" << summary.count << ",\"mean\":" << summary.mean << ",\"p50\":" << summary.p50
+        << ",\"p95\":" << summary.p95 << ",\"p99\":" << summary.p99 << ",\"p99.9\":" << summary.p999
+        << ",\"max\":" << summary.max << "}";
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Run every scenario the description names, one after another
+
+\param desc
+  Scenario name, frames, size and settings shared by every scenario
+*/
+/****************************************************************************/
+bool VK::Benchmark::Run(const BenchmarkDesc& desc)
+{
+    mDesc = desc;
+    mDesc.frames = std::max(desc.frames, 2u);
+    mResults.clear();
+
+    for (const Scenario& scenario : Scenarios)
+    {
+        std::string name = scenario.name;
+        bool startup = mDesc.scenario == "startup" && scenario.startup;
+        if (mDesc.scenario != "all" && mDesc.scenario != name && !startup)
+            continue;
+
+        mResults.push_back(RunScenario(name));
+
+        const BenchmarkResult& result = mResults.back();
+        std::cout << result.name << ": " << result.frames << " frames, startup " << result.rendererMs
+            << " + " << result.sceneMs << " + " << result.firstFrameMs << " ms, cpu p50 " << result.report.cpu.p50
+            << " p99 " << result.report.cpu.p99 << " ms, gpu p50 " << result.report.gpu.p50 << " ms, peak "
+            << result.peakResidentMB << " MB" << std::endl;
+    }
+
+    if (mResults.empty())
+    {
+        DEBUG::log.Error("Benchmark::Run: no scenario named " + mDesc.scenario + "!");
+        return false;
+    }
+
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the results of the last run, in the order they ran
+*/
+/****************************************************************************/
+const std::vector<VK::BenchmarkResult>& VK::Benchmark::Results() const
+{
+    return mResults;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write the device, the settings and every scenario's summary, each
+  scenario's frames were written as CSV next to it
+
+\param path
+  File to write, replaced if it exists
+*/
+/****************************************************************************/
+bool VK::Benchmark::WriteJson(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file)
+    {
+        DEBUG::log.Error("Benchmark::WriteJson: failed to open " + path + "!");
+        return false;
+    }
+
+    file << "{\"device\":{\"name\":";
+    WriteJsonString(file, mDeviceName);
+    file << ",\"type\":\"" << mDeviceType << "\",\"api\":\"" << VK_VERSION_MAJOR(mApiVersion) << '.'
+        << VK_VERSION_MINOR(mApiVersion) << '.' << VK_VERSION_PATCH(mApiVersion) << "\",\"driver\":"
+        << mDriverVersion << "},\n";
+
+    file << "\"settings\":{\"frames\":" << mDesc.frames << ",\"width\":" << mDesc.width << ",\"height\":"
+        << mDesc.height << ",\"gpuCulling\":" << (mDesc.gpuCulling ? "true" : "false") << ",\"fixedStep\":"
+        << FixedStep << "},\n\"scenarios\":[";
+
+    for (size_t i = 0; i < mResults.size(); ++i)
+    {
+        const BenchmarkResult& result = mResults[i];
+        file << (i ? ",\n" : "\n") << "{\"name\":";
+        WriteJsonString(file, result.name);
+        file << ",\"objects\":" << result.objects << ",\"frames\":" << result.frames << ",\"framesPath\":";
+        WriteJsonString(file, result.framesPath);
+        file << ",\"startup\":{\"rendererMs\":" << result.rendererMs << ",\"sceneMs\":" << result.sceneMs
+            << ",\"firstFrameMs\":" << result.firstFrameMs << "},\"totalMs\":" << result.totalMs
+            << ",\"hitches\":" << result.report.hitches << ",\n \"cpu\":";
+        WriteSummary(file, result.report.cpu);
+        file << ",\n \"gpu\":";
+        WriteSummary(file, result.report.gpu);
+        file << ",\n \"wait\":";
+        WriteSummary(file, result.report.wait);
+        file << ",\n \"residentMB\":" << result.residentMB << ",\"peakResidentMB\":" << result.peakResidentMB << "}";
+    }
+    file << "\n]}\n";
+
+    if (!file)
+    {
+        DEBUG::log.Error("Benchmark::WriteJson: failed to write " + path + "!");
+        return false;
+    }
+
+    DEBUG::log.Info("Benchmark::WriteJson: wrote " + path);
+    return true;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Time one scenario from creating its engine to its last frame
+*/
+/****************************************************************************/
+VK::BenchmarkResult VK::Benchmark::RunScenario(const std::string& name)
+{
+    using Clock = std::chrono::steady_clock;
+
+    const Scenario* scenario = &Scenarios[0];
+    for (const Scenario& candidate : Scenarios)
+    {
+        if (name == candidate.name)
+            scenario = &candidate;
+    }
+
+    BenchmarkResult result;
+    result.name = name;
+    result.objects = scenario->objects;
+    result.frames = scenario->startup ? std::min(mDesc.frames, StartupFrames) : mDesc.frames;
+
+    if (scenario->cold)
+    {
+        std::error_code error;
+        std::filesystem::remove_all(mDesc.cacheDirectory, error);
+    }
+
+    // pipelines are built up front so every frame draws everything
+    VK::RendererConfig config;
+    config.headless = true;
+    config.width = mDesc.width;
+    config.height = mDesc.height;
+    config.asyncPipelines = false;
+    config.gpuCulling = mDesc.gpuCulling;
+    config.shaderCacheDirectory = mDesc.cacheDirectory;
+    config.frameStats.capacity = result.frames;
+
+    Clock::time_point start = Clock::now();
+    VK::Engine engine(config);
+    Clock::time_point created = Clock::now();
+
+    // a cube of objects a few mesh sizes apart, circled once per run
+    engine.Init();
+    float size = std::max(engine.GetRenderer().MeshBounds(0).radius * 2.0f, 0.01f);
+    float spacing = size * 1.5f;
+    uint32_t side = 1;
+    while (side * side * side < scenario->objects)
+    {
+        ++side;
+    }
+    float halfSize = float(side) * spacing * 0.5f;
+
+    engine.AddObjects(scenario->objects, spacing, scenario->unique);
+    engine.SetFixedStep(FixedStep);
+    engine.SetCameraOrbit(halfSize * 3.0f + size, halfSize, FixedStep * float(result.frames));
+    Clock::time_point ready = Clock::now();
+
+    engine.Run(1);
+    Clock::time_point first = Clock::now();
+
+    // the target is resized between runs so it changes on a frame boundary
+    if (scenario->resize)
+    {
+        uint32_t resize = 0;
+        for (uint32_t frame = 1; frame < result.frames; frame += ResizeInterval)
+        {
+            const int* resolution = ResizeSizes[resize++ % (sizeof(ResizeSizes) / sizeof(ResizeSizes[0]))];
+            engine.GetRenderer().ResizeTarget(0, resolution[0], resolution[1]);
+            engine.Run(std::min(ResizeInterval, result.frames - frame));
+        }
+    }
+    else
+    {
+        engine.Run(result.frames - 1);
+    }
+    Clock::time_point end = Clock::now();
+
+    result.rendererMs = Milliseconds(start, created);
+    result.sceneMs = Milliseconds(created, ready);
+    result.firstFrameMs = Milliseconds(ready, first);
+    result.totalMs = Milliseconds(start, end);
+    result.report = engine.FrameReport();
+
+    // the distributions themselves, next to the summary
+    std::filesystem::path frames(mDesc.outputPath);
+    frames.replace_filename(frames.stem().string() + "-" + name + ".csv");
+    if (engine.GetRenderer().WriteFrameCsv(frames.string()))
+        result.framesPath = frames.string();
+    result.residentMB = ResidentMB();
+    result.peakResidentMB = PeakResidentMB();
+
+    if (mDeviceName.empty())
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(engine.GetRenderer().Device().GetPhysicalDevice(), &properties);
+        mDeviceName = properties.deviceName;
+        mDeviceType = DeviceTypeName(properties.deviceType);
+        mApiVersion = properties.apiVersion;
+        mDriverVersion = properties.driverVersion;
+    }
+
+    engine.ShutDown();
+    return result;
+}
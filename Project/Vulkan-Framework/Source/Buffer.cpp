@@ -14,6 +14,7 @@
 #include "VULKANPCH.hpp"
 #include "Buffer.hpp"
 #include "CommandBuffer.hpp"
+#include <cstring>
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
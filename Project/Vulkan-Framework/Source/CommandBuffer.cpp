@@ -13,6 +13,7 @@
 
 #include "VULKANPCH.hpp"
 #include "CommandBuffer.hpp"
+#include "Image.hpp"
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -194,6 +195,61 @@ void VK::CommandBuffer::EndRT(unsigned i)
     }
 }
 
+/****************************************************************************/
+/*!
+\brief
+  Start rendering into image views without a render pass or framebuffer,
+  needs a device with dynamic rendering. The views have to be in
+  COLOR_ATTACHMENT_OPTIMAL and DEPTH_STENCIL_ATTACHMENT_OPTIMAL already.
+
+\param depthView
+  VK_NULL_HANDLE to render without depth
+*/
+/****************************************************************************/
+void VK::CommandBuffer::BeginRendering(unsigned i, VK::Device& device, const std::vector<VkImageView>& colorViews, VkImageView depthView, VkExtent2D extent)
+{
+    std::vector<VkRenderingAttachmentInfoKHR> colorAttachments(colorViews.size());
+    for (size_t j = 0; j < colorViews.size(); ++j)
+    {
+        colorAttachments[j].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        colorAttachments[j].imageView = colorViews[j];
+        colorAttachments[j].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachments[j].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachments[j].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachments[j].clearValue.color = { 0.2f, 0.2f, 0.2f, 1.0f };
+    }
+
+    VkRenderingAttachmentInfoKHR depthAttachment = {};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    depthAttachment.imageView = depthView;
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+    VkRenderingInfoKHR renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.renderArea.offset = { 0, 0 };
+    renderingInfo.renderArea.extent = extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = uint32_t(colorAttachments.size());
+    renderingInfo.pColorAttachments = colorAttachments.data();
+    renderingInfo.pDepthAttachment = depthView != VK_NULL_HANDLE ? &depthAttachment : nullptr;
+
+    device.CmdBeginRendering((*this)[i], renderingInfo);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  stop rendering started with BeginRendering, recording goes on
+*/
+/****************************************************************************/
+void VK::CommandBuffer::EndRendering(unsigned i, VK::Device& device)
+{
+    device.CmdEndRendering((*this)[i]);
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -238,6 +294,30 @@ void VK::CommandBuffer::BindDescriptorSet(unsigned i, VK::PipeLine& pipeLine, st
     vkCmdBindDescriptorSets((*this)[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeLine.Layout(), 0, uint32_t(dSet.size()), dSet.data(), 0, nullptr);
 }
 
+/****************************************************************************/
+/*!
+\brief
+  set the viewport and scissor to the top left corner of the attachments
+*/
+/****************************************************************************/
+void VK::CommandBuffer::SetViewport(unsigned i, VkExtent2D extent)
+{
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = float(extent.width);
+    viewport.height = float(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor = {};
+    scissor.offset = { 0, 0 };
+    scissor.extent = extent;
+
+    vkCmdSetViewport((*this)[i], 0, 1, &viewport);
+    vkCmdSetScissor((*this)[i], 0, 1, &scissor);
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -248,4 +328,174 @@ void VK::CommandBuffer::DrawIndexed(unsigned i, unsigned instanceCount, VkBuffer
 {
     vkCmdBindIndexBuffer((*this)[i], *indexBuffer, 0, VK_INDEX_TYPE_UINT32);
     vkCmdDrawIndexed((*this)[i], indexCount, instanceCount, 0, 0, 0);
-}
\ No newline at end of file
+}
+
+/****************************************************************************/
+/*!
+\brief
+  draw a range of instances with the bound index buffer
+*/
+/****************************************************************************/
+void VK::CommandBuffer::DrawIndexedInstances(unsigned i, uint32_t indexCount, uint32_t instanceCount, uint32_t firstInstance)
+{
+    vkCmdDrawIndexed((*this)[i], indexCount, instanceCount, 0, 0, firstInstance);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  set the index buffer for indexed draws, uint32_t indices
+*/
+/****************************************************************************/
+void VK::CommandBuffer::BindIndexBuffer(unsigned i, VkBuffer indexBuffer)
+{
+    vkCmdBindIndexBuffer((*this)[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  draw the VkDrawIndexedIndirectCommands in a buffer, as many as the
+  uint32_t in the count buffer says up to maxDraws. Needs
+  Device::DrawIndirectCount.
+*/
+/****************************************************************************/
+void VK::CommandBuffer::DrawIndexedIndirectCount(unsigned i, VkBuffer draws, VkDeviceSize offset, VkBuffer count, VkDeviceSize countOffset,
+    uint32_t maxDraws, uint32_t stride)
+{
+    vkCmdDrawIndexedIndirectCount((*this)[i], draws, offset, count, countOffset, maxDraws, stride);
+}
+/****************************************************************************/
+/*!
+\brief
+  set the active compute pipeline
+*/
+/****************************************************************************/
+void VK::CommandBuffer::BindComputePipeline(unsigned i, VK::ComputePipeline& pipeLine)
+{
+    vkCmdBindPipeline((*this)[i], VK_PIPELINE_BIND_POINT_COMPUTE, pipeLine.Get());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  set the descriptor sets compute reads and writes through
+*/
+/****************************************************************************/
+void VK::CommandBuffer::BindComputeDescriptorSet(unsigned i, VK::ComputePipeline& pipeLine, std::vector<VkDescriptorSet> dSet, unsigned firstSet)
+{
+    vkCmdBindDescriptorSets((*this)[i], VK_PIPELINE_BIND_POINT_COMPUTE, pipeLine.Layout(), firstSet, uint32_t(dSet.size()), dSet.data(), 0, nullptr);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  push constants for the next draws or dispatches
+
+\param stages
+  Every stage the layout's range names, not only the ones that read it
+*/
+/****************************************************************************/
+void VK::CommandBuffer::PushConstants(unsigned i, VkPipelineLayout layout, VkShaderStageFlags stages, const void* data, uint32_t size, uint32_t offset)
+{
+    vkCmdPushConstants((*this)[i], layout, stages, offset, size, data);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  run the bound compute pipeline over a grid of workgroups
+*/
+/****************************************************************************/
+void VK::CommandBuffer::Dispatch(unsigned i, uint32_t x, uint32_t y, uint32_t z)
+{
+    vkCmdDispatch((*this)[i], x, y, z);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  run the bound compute pipeline with the group counts read from a buffer,
+  three uint32_t at offset, so earlier GPU work can size the dispatch.
+  The buffer needs VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT.
+*/
+/****************************************************************************/
+void VK::CommandBuffer::DispatchIndirect(unsigned i, VkBuffer buffer, VkDeviceSize offset)
+{
+    vkCmdDispatchIndirect((*this)[i], buffer, offset);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  make writes from one stage visible to reads in another, for all memory
+*/
+/****************************************************************************/
+void VK::CommandBuffer::Barrier(unsigned i, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier((*this)[i], srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Let draws consume what compute wrote: vertices, indices, indirect
+  arguments and anything the shaders read
+*/
+/****************************************************************************/
+void VK::CommandBuffer::ComputeToGraphicsBarrier(unsigned i)
+{
+    Barrier(i, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Let the next dispatch read what the last one wrote, including the group
+  counts of an indirect dispatch
+*/
+/****************************************************************************/
+void VK::CommandBuffer::ComputeToComputeBarrier(unsigned i)
+{
+    Barrier(i, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Move a whole image between layouts inside this command buffer, e.g. to
+  GENERAL before compute writes it as a storage image and to
+  SHADER_READ_ONLY_OPTIMAL before the fragment shader samples it
+*/
+/****************************************************************************/
+void VK::CommandBuffer::TransitionImage(unsigned i, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK::GetFormatAspect(format);
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+    VK::LayoutUsage source = VK::GetLayoutUsage(oldLayout);
+    VK::LayoutUsage destination = VK::GetLayoutUsage(newLayout);
+    barrier.srcAccessMask = source.access;
+    barrier.dstAccessMask = destination.access;
+
+    vkCmdPipelineBarrier((*this)[i], source.stage, destination.stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
@@ -0,0 +1,242 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "ComputePipeline.hpp"
+#include "PipelineCache.hpp"
+#include "Hash.hpp"
+#include <cstring>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Set a specialization constant, replacing an earlier value for the id
+*/
+/****************************************************************************/
+void VK::ComputePipelineDesc::Specialize(uint32_t id, uint32_t value)
+{
+    SetSpecialization(specialization, id, value);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set an int specialization constant
+*/
+/****************************************************************************/
+void VK::ComputePipelineDesc::Specialize(uint32_t id, int32_t value)
+{
+    Specialize(id, static_cast<uint32_t>(value));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set a float specialization constant
+*/
+/****************************************************************************/
+void VK::ComputePipelineDesc::Specialize(uint32_t id, float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    Specialize(id, bits);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set a bool specialization constant, bools are 32 bit in SPIR-V
+*/
+/****************************************************************************/
+void VK::ComputePipelineDesc::Specialize(uint32_t id, bool value)
+{
+    Specialize(id, uint32_t(value ? VK_TRUE : VK_FALSE));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Hash everything that changes the compiled pipeline
+*/
+/****************************************************************************/
+uint64_t VK::ComputePipelineDesc::Hash() const
+{
+    uint64_t hash = HashOffset;
+
+    HashString(hash, computePath);
+    HashValue(hash, uint64_t(defines.size()));
+    for (const ShaderDefine& define : defines)
+    {
+        HashString(hash, define.name);
+        HashString(hash, define.value);
+    }
+
+    HashVector(hash, specialization);
+    HashLayout(hash, setLayouts, pushConstants);
+
+    return hash;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compare everything that goes into the hash
+*/
+/****************************************************************************/
+bool VK::ComputePipelineDesc::operator==(const ComputePipelineDesc& rhs) const
+{
+    return computePath == rhs.computePath && defines == rhs.defines && specialization == rhs.specialization &&
+        SameLayout(setLayouts, pushConstants, rhs.setLayouts, rhs.pushConstants);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the pipeline for a description, it is only compiled the first time
+  the cache sees the description. Compute pipelines are small, so this
+  always compiles on the calling thread.
+*/
+/****************************************************************************/
+void VK::ComputePipeline::Create(VK::Device& device, VK::PipelineCache& cache, const ComputePipelineDesc& desc)
+{
+    VK::PipelineCache::Entry entry = cache.GetComputePipeline(device, desc);
+    mPipeline = entry.pipeline;
+    mLayout = entry.layout;
+
+    // the cache hands out the same set layouts the pipeline layout uses
+    const VK::ShaderCache::Module& shader = cache.Shaders().Get(device, desc.computePath, desc.defines);
+    mSetBindings = desc.setLayouts.empty() ? shader.reflection.SetLayouts() : desc.setLayouts;
+
+    mSetLayouts.clear();
+    for (uint32_t set = 0; set < mSetBindings.size(); ++set)
+        mSetLayouts.push_back(cache.GetSetLayout(device, mSetBindings[set]));
+
+    std::copy(shader.reflection.LocalSize(), shader.reflection.LocalSize() + 3, mGroupSize);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, the cache keeps the pipeline alive for the next user
+*/
+/****************************************************************************/
+void VK::ComputePipeline::ShutDown(VK::Device&)
+{
+    mPipeline = VK_NULL_HANDLE;
+    mLayout = VK_NULL_HANDLE;
+    mSetLayouts.clear();
+    mSetBindings.clear();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the pipeline
+*/
+/****************************************************************************/
+VkPipeline VK::ComputePipeline::Get() const
+{
+    return mPipeline;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get a pointer to the pipeline
+*/
+/****************************************************************************/
+VkPipeline* VK::ComputePipeline::GetPointerTo()
+{
+    return &mPipeline;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the pipeline layout
+*/
+/****************************************************************************/
+VkPipelineLayout VK::ComputePipeline::Layout() const
+{
+    return mLayout;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the layout of one descriptor set, to allocate sets with
+*/
+/****************************************************************************/
+VkDescriptorSetLayout VK::ComputePipeline::SetLayout(unsigned set) const
+{
+    return mSetLayouts[set];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the bindings of one descriptor set, to size a pool with
+*/
+/****************************************************************************/
+const std::vector<VkDescriptorSetLayoutBinding>& VK::ComputePipeline::SetBindings(unsigned set) const
+{
+    return mSetBindings[set];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of descriptor sets the pipeline takes
+*/
+/****************************************************************************/
+unsigned VK::ComputePipeline::SetCount() const
+{
+    return unsigned(mSetLayouts.size());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the workgroup size as x, y, z
+*/
+/****************************************************************************/
+const uint32_t* VK::ComputePipeline::GroupSize() const
+{
+    return mGroupSize;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Number of workgroups along an axis that cover a number of threads
+
+\param axis
+  0 for x, 1 for y, 2 for z
+*/
+/****************************************************************************/
+uint32_t VK::ComputePipeline::GroupCount(uint32_t threads, unsigned axis) const
+{
+    return (threads + mGroupSize[axis] - 1) / mGroupSize[axis];
+}
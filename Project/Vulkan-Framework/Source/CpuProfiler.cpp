@@ -0,0 +1,293 @@
+/****************************************************************************/
+/*!
+\file
+   CpuProfiler.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Scoped CPU timing with Chrome trace export
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "CpuProfiler.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// most scopes a thread records in one capture, later ones are dropped
+static const uint32_t EventCapacity = 1u << 15;
+
+struct ProfileEvent
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// written only by its thread, the count publishes the events before it
+struct ThreadEvents
+{
+    std::unique_ptr<ProfileEvent[]> events;
+    std::atomic<uint32_t> count = 0;
+    std::atomic<uint64_t> capture = 0; // the capture the events belong to
+    uint32_t thread = 0;
+};
+
+// every thread that ever recorded, never freed so threads may exit
+static std::mutex gThreadsMutex;
+static std::vector<std::unique_ptr<ThreadEvents>> gThreads;
+static thread_local ThreadEvents* tEvents = nullptr;
+
+static std::atomic<bool> gCapturing = false;
+static std::atomic<uint64_t> gCapture = 0;
+static std::atomic<uint32_t> gFramesLeft = 0;
+static std::atomic<uint64_t> gCaptureStart = 0;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  The calling thread's buffer, made on first use
+*/
+/****************************************************************************/
+static ThreadEvents& LocalEvents()
+{
+    if (!tEvents)
+    {
+        std::unique_ptr<ThreadEvents> events = std::make_unique<ThreadEvents>();
+        events->events.reset(new ProfileEvent[EventCapacity]);
+
+        std::lock_guard<std::mutex> lock(gThreadsMutex);
+        events->thread = uint32_t(gThreads.size());
+        tEvents = events.get();
+        gThreads.push_back(std::move(events));
+    }
+    return *tEvents;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write a string as a JSON string
+*/
+/****************************************************************************/
+static void WriteJsonString(std::ofstream& file, const char* text)
+{
+    file << '"';
+    for (const char* c = text; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            file << '\\' << *c;
+        else if (static_cast<unsigned char>(*c) >= 0x20)
+            file << *c;
+    }
+    file << '"';
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Start recording scopes on every thread
+
+\param frameCount
+  Frames the capture lasts, counted by Frame. 0 lasts until Stop.
+*/
+/****************************************************************************/
+void VK::CpuProfiler::Start(uint32_t frameCount)
+{
+    gCaptureStart.store(Now(), std::memory_order_relaxed);
+    gFramesLeft.store(frameCount, std::memory_order_relaxed);
+    gCapture.fetch_add(1, std::memory_order_release);
+    gCapturing.store(true, std::memory_order_release);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Stop recording, scopes open right now are left out
+*/
+/****************************************************************************/
+void VK::CpuProfiler::Stop()
+{
+    gCapturing.store(false, std::memory_order_release);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Count a frame of the capture, call from one thread
+
+\return
+  True if the capture just ran out of frames and stopped
+*/
+/****************************************************************************/
+bool VK::CpuProfiler::Frame()
+{
+    if (!IsCapturing() || gFramesLeft.load(std::memory_order_relaxed) == 0)
+        return false;
+
+    if (gFramesLeft.fetch_sub(1, std::memory_order_relaxed) != 1)
+        return false;
+
+    Stop();
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Is a capture running
+*/
+/****************************************************************************/
+bool VK::CpuProfiler::IsCapturing()
+{
+    return gCapturing.load(std::memory_order_relaxed);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Save the last capture as Chrome trace JSON, one complete event per
+  scope with times in microseconds from the start of the capture
+
+\param path
+  File to write, replaced if it exists
+*/
+/****************************************************************************/
+bool VK::CpuProfiler::WriteTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file)
+    {
+        DEBUG::log.Error("CpuProfiler::WriteTrace: failed to open " + path + "!");
+        return false;
+    }
+
+    uint64_t capture = gCapture.load(std::memory_order_acquire);
+    uint64_t start = gCaptureStart.load(std::memory_order_relaxed);
+    file.setf(std::ios::fixed);
+    file.precision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    std::lock_guard<std::mutex> lock(gThreadsMutex);
+    for (const std::unique_ptr<ThreadEvents>& thread : gThreads)
+    {
+        if (thread->capture.load(std::memory_order_acquire) != capture)
+            continue;
+
+        uint32_t count = thread->count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const ProfileEvent& event = thread->events[i];
+            if (event.begin < start)
+                continue;
+
+            file << (first ? "\n" : ",\n") << "{\"name\":";
+            WriteJsonString(file, event.name);
+            file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread->thread
+                << ",\"ts\":" << double(event.begin - start) / 1000.0
+                << ",\"dur\":" << double(event.end - event.begin) / 1000.0 << "}";
+            first = false;
+        }
+    }
+
+    file << "\n]}\n";
+    if (!file)
+    {
+        DEBUG::log.Error("CpuProfiler::WriteTrace: failed to write " + path + "!");
+        return false;
+    }
+
+    DEBUG::log.Info("CpuProfiler::WriteTrace: wrote " + path);
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the time on a steady clock in nanoseconds
+*/
+/****************************************************************************/
+uint64_t VK::CpuProfiler::Now()
+{
+    using Clock = std::chrono::steady_clock;
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Append a closed scope to the calling thread's buffer, dropped when no
+  capture is running or the buffer is full
+
+\param name
+  Must outlive the capture, a string literal
+*/
+/****************************************************************************/
+void VK::CpuProfiler::Record(const char* name, uint64_t begin, uint64_t end)
+{
+    if (!IsCapturing())
+        return;
+
+    // the first scope of a capture drops what the thread kept from the last
+    ThreadEvents& events = LocalEvents();
+    uint64_t capture = gCapture.load(std::memory_order_acquire);
+    if (events.capture.load(std::memory_order_relaxed) != capture)
+    {
+        events.count.store(0, std::memory_order_relaxed);
+        events.capture.store(capture, std::memory_order_release);
+    }
+
+    uint32_t count = events.count.load(std::memory_order_relaxed);
+    if (count >= EventCapacity)
+        return;
+
+    events.events[count] = { name, begin, end };
+    events.count.store(count + 1, std::memory_order_release);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Start timing, nothing is read from the clock without a capture
+*/
+/****************************************************************************/
+VK::CpuProfileScope::CpuProfileScope(const char* name) :
+    mName(name),
+    mBegin(CpuProfiler::IsCapturing() ? CpuProfiler::Now() : 0) {}
+
+/****************************************************************************/
+/*!
+\brief
+  Record the scope if a capture ran when it opened
+*/
+/****************************************************************************/
+VK::CpuProfileScope::~CpuProfileScope()
+{
+    if (mBegin != 0)
+    {
+        CpuProfiler::Record(mName, mBegin, CpuProfiler::Now());
+    }
+}
@@ -0,0 +1,347 @@
+/****************************************************************************/
+/*!
+\file
+   Culling.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Bounding volumes and frustum culling
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "Culling.hpp"
+#include <limits>
+
+// widest instruction set the build allows, MSVC sets __AVX__ with /arch:AVX
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULL_SSE
+#endif
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// objects tested at once, the lists are padded to the widest of these
+#if defined(CULL_AVX)
+static const uint32_t CullWidth = 8;
+#elif defined(CULL_SSE)
+static const uint32_t CullWidth = 4;
+#else
+static const uint32_t CullWidth = 1;
+#endif
+static const uint32_t PadWidth = 8;
+
+// objects per job, a multiple of PadWidth
+static const uint32_t CullGrain = 4096;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Round a count up to the padding width
+*/
+/****************************************************************************/
+static uint32_t PaddedSize(uint32_t count)
+{
+    return (count + PadWidth - 1) / PadWidth * PadWidth;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  A plane normalized so its distances are in world units
+*/
+/****************************************************************************/
+static glm::vec4 NormalizePlane(const glm::vec4& plane)
+{
+    return plane / glm::length(glm::vec3(plane));
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Bounds of an axis aligned box
+*/
+/****************************************************************************/
+VK::Bounds VK::Bounds::FromPoints(const glm::vec3& min, const glm::vec3& max)
+{
+    Bounds bounds;
+    bounds.center = (min + max) * 0.5f;
+    bounds.extents = (max - min) * 0.5f;
+    bounds.radius = glm::length(bounds.extents);
+    return bounds;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bounds of the transformed volume. The box grows to fit the rotated box
+  and the sphere scales by the largest axis scale.
+*/
+/****************************************************************************/
+VK::Bounds VK::Bounds::Transformed(const glm::mat4& world) const
+{
+    Bounds bounds;
+    bounds.center = glm::vec3(world * glm::vec4(center, 1));
+
+    for (int row = 0; row < 3; ++row)
+    {
+        bounds.extents[row] = std::abs(world[0][row]) * extents.x + std::abs(world[1][row]) * extents.y +
+            std::abs(world[2][row]) * extents.z;
+    }
+
+    float scale = std::max({ glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2])) });
+    bounds.radius = radius * scale;
+    return bounds;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Pull the planes out of a view projection matrix (Gribb and Hartmann).
+  The near plane assumes a -1 to 1 depth range, with 0 to 1 it sits
+  behind the real near plane, which only keeps a little more.
+*/
+/****************************************************************************/
+VK::Frustum VK::Frustum::FromMatrix(const glm::mat4& viewProj)
+{
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; ++i)
+        row[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+
+    Frustum frustum;
+    frustum.planes[0] = NormalizePlane(row[3] + row[0]); // left
+    frustum.planes[1] = NormalizePlane(row[3] - row[0]); // right
+    frustum.planes[2] = NormalizePlane(row[3] + row[1]); // bottom
+    frustum.planes[3] = NormalizePlane(row[3] - row[1]); // top
+    frustum.planes[4] = NormalizePlane(row[3] + row[2]); // near
+    frustum.planes[5] = NormalizePlane(row[3] - row[2]); // far
+    return frustum;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the number of objects, new and padding entries never pass
+*/
+/****************************************************************************/
+void VK::CullList::Resize(uint32_t count)
+{
+    uint32_t padded = PaddedSize(count);
+
+    mCenterX.resize(padded, 0);
+    mCenterY.resize(padded, 0);
+    mCenterZ.resize(padded, 0);
+    mExtentX.resize(padded, 0);
+    mExtentY.resize(padded, 0);
+    mExtentZ.resize(padded, 0);
+    mRadius.resize(padded, std::numeric_limits<float>::lowest());
+
+    // shrinking leaves old objects in the padding
+    std::fill(mRadius.begin() + count, mRadius.end(), std::numeric_limits<float>::lowest());
+    mCount = count;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set an object's world space bounds
+*/
+/****************************************************************************/
+void VK::CullList::Set(uint32_t index, const Bounds& bounds)
+{
+    assert(index < mCount);
+
+    mCenterX[index] = bounds.center.x;
+    mCenterY[index] = bounds.center.y;
+    mCenterZ[index] = bounds.center.z;
+    mExtentX[index] = bounds.extents.x;
+    mExtentY[index] = bounds.extents.y;
+    mExtentZ[index] = bounds.extents.z;
+    mRadius[index] = bounds.radius;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set an object from its mesh's bounds and its world transform
+*/
+/****************************************************************************/
+void VK::CullList::Set(uint32_t index, const Bounds& local, const glm::mat4& world)
+{
+    Set(index, local.Transformed(world));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of objects
+*/
+/****************************************************************************/
+uint32_t VK::CullList::Size() const
+{
+    return mCount;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Find the objects that touch the frustum
+
+\param visible
+  Filled with the indices of the visible objects, smallest first
+*/
+/****************************************************************************/
+void VK::FrustumCuller::Cull(VK::JobPool& jobs, const Frustum& frustum, const CullList& list, std::vector<uint32_t>& visible)
+{
+    uint32_t padded = PaddedSize(list.Size());
+    mScratch.resize(padded);
+    mChunkCounts.assign((padded + CullGrain - 1) / CullGrain, 0);
+
+    jobs.For(padded, CullGrain, [this, &frustum, &list](uint32_t begin, uint32_t end)
+    {
+        CullRange(frustum, list, begin, end);
+    });
+
+    visible.clear();
+    for (uint32_t chunk = 0; chunk < mChunkCounts.size(); ++chunk)
+    {
+        std::vector<uint32_t>::const_iterator first = mScratch.begin() + chunk * CullGrain;
+        visible.insert(visible.end(), first, first + mChunkCounts[chunk]);
+    }
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Test [begin, end) and write the visible indices from begin. An object
+  is outside when its center is further behind any plane than the smaller
+  of its radius and its box's reach along the plane normal.
+*/
+/****************************************************************************/
+void VK::FrustumCuller::CullRange(const Frustum& frustum, const CullList& list, uint32_t begin, uint32_t end)
+{
+    uint32_t* out = mScratch.data() + begin;
+    uint32_t written = 0;
+
+#if defined(CULL_AVX)
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; ++p)
+    {
+        const glm::vec4& plane = frustum.planes[p];
+        planeX[p] = _mm256_set1_ps(plane.x);
+        planeY[p] = _mm256_set1_ps(plane.y);
+        planeZ[p] = _mm256_set1_ps(plane.z);
+        planeW[p] = _mm256_set1_ps(plane.w);
+        absX[p] = _mm256_set1_ps(std::abs(plane.x));
+        absY[p] = _mm256_set1_ps(std::abs(plane.y));
+        absZ[p] = _mm256_set1_ps(std::abs(plane.z));
+    }
+
+    const __m256 zero = _mm256_setzero_ps();
+    for (uint32_t i = begin; i < end; i += CullWidth)
+    {
+        __m256 cx = _mm256_loadu_ps(&list.mCenterX[i]);
+        __m256 cy = _mm256_loadu_ps(&list.mCenterY[i]);
+        __m256 cz = _mm256_loadu_ps(&list.mCenterZ[i]);
+        __m256 ex = _mm256_loadu_ps(&list.mExtentX[i]);
+        __m256 ey = _mm256_loadu_ps(&list.mExtentY[i]);
+        __m256 ez = _mm256_loadu_ps(&list.mExtentZ[i]);
+        __m256 radius = _mm256_loadu_ps(&list.mRadius[i]);
+
+        __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+        for (int p = 0; p < 6; ++p)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+                _mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeW[p]));
+            __m256 box = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)), _mm256_mul_ps(absZ[p], ez));
+            __m256 reach = _mm256_min_ps(radius, box);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (uint32_t lane = 0; mask != 0; ++lane, mask >>= 1)
+            if (mask & 1)
+                out[written++] = i + lane;
+    }
+#elif defined(CULL_SSE)
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; ++p)
+    {
+        const glm::vec4& plane = frustum.planes[p];
+        planeX[p] = _mm_set1_ps(plane.x);
+        planeY[p] = _mm_set1_ps(plane.y);
+        planeZ[p] = _mm_set1_ps(plane.z);
+        planeW[p] = _mm_set1_ps(plane.w);
+        absX[p] = _mm_set1_ps(std::abs(plane.x));
+        absY[p] = _mm_set1_ps(std::abs(plane.y));
+        absZ[p] = _mm_set1_ps(std::abs(plane.z));
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    for (uint32_t i = begin; i < end; i += CullWidth)
+    {
+        __m128 cx = _mm_loadu_ps(&list.mCenterX[i]);
+        __m128 cy = _mm_loadu_ps(&list.mCenterY[i]);
+        __m128 cz = _mm_loadu_ps(&list.mCenterZ[i]);
+        __m128 ex = _mm_loadu_ps(&list.mExtentX[i]);
+        __m128 ey = _mm_loadu_ps(&list.mExtentY[i]);
+        __m128 ez = _mm_loadu_ps(&list.mExtentZ[i]);
+        __m128 radius = _mm_loadu_ps(&list.mRadius[i]);
+
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+                _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+            __m128 box = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+            __m128 reach = _mm_min_ps(radius, box);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (uint32_t lane = 0; mask != 0; ++lane, mask >>= 1)
+            if (mask & 1)
+                out[written++] = i + lane;
+    }
+#else
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p)
+        {
+            const glm::vec4& plane = frustum.planes[p];
+            float distance = plane.x * list.mCenterX[i] + plane.y * list.mCenterY[i] + plane.z * list.mCenterZ[i] + plane.w;
+            float box = std::abs(plane.x) * list.mExtentX[i] + std::abs(plane.y) * list.mExtentY[i] + std::abs(plane.z) * list.mExtentZ[i];
+            inside = distance + std::min(list.mRadius[i], box) >= 0;
+        }
+
+        if (inside)
+            out[written++] = i;
+    }
+#endif
+
+    mChunkCounts[begin / CullGrain] = written;
+}
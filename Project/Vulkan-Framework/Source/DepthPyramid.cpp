@@ -0,0 +1,321 @@
+/****************************************************************************/
+/*!
+\file
+   DepthPyramid.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Hierarchical depth for occlusion culling
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "DepthPyramid.hpp"
+#include "PipelineCache.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// bindings of DepthPyramid.comp
+static const uint32_t DepthBinding = 0;
+static const uint32_t MipBinding = 1;
+static const uint32_t CounterBinding = 2;
+
+// the size of the shader's mip array, 4096 down to 1
+static const uint32_t MaxMips = 13;
+
+// mip 0 texels one group reduces along each axis
+static const uint32_t TileSize = 32;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  The largest power of two no larger than value, which is at least 1
+*/
+/****************************************************************************/
+static uint32_t FloorPowerOfTwo(uint32_t value)
+{
+    uint32_t power = 1;
+    while (power * 2 <= value)
+        power *= 2;
+    return power;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Make a view of some mips of an image
+*/
+/****************************************************************************/
+static void CreateView(VK::Device& device, VK::ImageView& view, VkImage image, VkFormat format,
+    VkImageAspectFlags aspect, uint32_t baseMip, uint32_t mipCount)
+{
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = aspect;
+    viewInfo.subresourceRange.baseMipLevel = baseMip;
+    viewInfo.subresourceRange.levelCount = mipCount;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    view.Create(device, viewInfo);
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Make the pyramid image, its views and the build pipeline
+
+\param depth
+  The depth image the pyramid is built from, made with
+  VK_IMAGE_USAGE_SAMPLED_BIT. Only its depth aspect is read.
+*/
+/****************************************************************************/
+void VK::DepthPyramid::Create(VK::Device& device, VK::PipelineCache& cache, VkImage depth, VkFormat depthFormat, VkExtent2D depthExtent)
+{
+    const uint32_t maxSize = 1u << (MaxMips - 1);
+    mExtent.width = std::min(FloorPowerOfTwo(std::max(depthExtent.width, 1u)), maxSize);
+    mExtent.height = std::min(FloorPowerOfTwo(std::max(depthExtent.height, 1u)), maxSize);
+
+    mMipCount = 1;
+    while ((std::max(mExtent.width, mExtent.height) >> mMipCount) > 0)
+        ++mMipCount;
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = { mExtent.width, mExtent.height, 1 };
+    imageInfo.mipLevels = mMipCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+    if (vkCreateImage(device.Get(), &imageInfo, nullptr, &mImage) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("DepthPyramid::Create: failed to create the pyramid image!");
+        throw std::runtime_error("failed to create the pyramid image!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device.Get(), mImage, &requirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = device.GetMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device.Get(), &allocInfo, nullptr, &mMemory) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("DepthPyramid::Create: failed to allocate the pyramid memory!");
+        throw std::runtime_error("failed to allocate the pyramid memory!");
+    }
+    vkBindImageMemory(device.Get(), mImage, mMemory, 0);
+
+    CreateView(device, mView, mImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, mMipCount);
+    mMipViews.resize(mMipCount);
+    for (uint32_t mip = 0; mip < mMipCount; ++mip)
+    {
+        CreateView(device, mMipViews[mip], mImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, mip, 1);
+    }
+
+    // a combined depth stencil image can only be sampled one aspect at a time
+    CreateView(device, mDepthView, depth, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1);
+
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = float(mMipCount);
+    mSampler.Create(device, samplerInfo);
+
+    // the shader leaves the counter at 0 when it is done
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = sizeof(uint32_t);
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    mCounter.Create(device, bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    void* data = nullptr;
+    mCounter.Map(device, sizeof(uint32_t), &data);
+    *static_cast<uint32_t*>(data) = 0;
+    mCounter.UnMap(device);
+
+    VK::ComputePipelineDesc desc;
+    desc.computePath = "../Resource/Shaders/DepthPyramid.comp";
+    mPipeline.Create(device, cache, desc);
+
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings = mPipeline.SetBindings(0);
+    mPool.Create(device, bindings, 1);
+    mSet.Create(device, mPool, mPipeline.SetLayout(0), bindings, 1);
+
+    const VK::DescriptorTemplate& setTemplate = mSet.Template();
+    std::vector<VK::DescriptorInfo> descriptors(setTemplate.SlotCount());
+    descriptors[setTemplate.Slot(DepthBinding)] = VK::DescriptorInfo::Image(mDepthView.Get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mSampler.Get());
+    descriptors[setTemplate.Slot(CounterBinding)] = VK::DescriptorInfo::Buffer(mCounter.Get());
+
+    // every element must be valid, the ones past the last mip repeat it
+    for (uint32_t mip = 0; mip < MaxMips; ++mip)
+    {
+        VkImageView view = mMipViews[std::min(mip, mMipCount - 1)].Get();
+        descriptors[setTemplate.Slot(MipBinding, mip)] = VK::DescriptorInfo::Image(view, VK_IMAGE_LAYOUT_GENERAL);
+    }
+    mSet.Update(device, 0, descriptors.data());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, the GPU must be done with the pyramid
+*/
+/****************************************************************************/
+void VK::DepthPyramid::ShutDown(VK::Device& device)
+{
+    if (!IsActive())
+        return;
+
+    mSet.ShutDown(device);
+    mPool.ShutDown(device);
+    mPipeline.ShutDown(device);
+    mCounter.ShutDown(device);
+    mSampler.ShutDown(device);
+    mDepthView.ShutDown(device);
+
+    for (VK::ImageView& view : mMipViews)
+    {
+        view.ShutDown(device);
+    }
+    mMipViews.clear();
+    mView.ShutDown(device);
+
+    vkDestroyImage(device.Get(), mImage, nullptr);
+    vkFreeMemory(device.Get(), mMemory, nullptr);
+    mImage = VK_NULL_HANDLE;
+    mMemory = VK_NULL_HANDLE;
+
+    mExtent = {};
+    mMipCount = 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record the build. The last frame's reads of the pyramid are waited on
+  and its contents dropped, the reads that follow are made to wait.
+*/
+/****************************************************************************/
+void VK::DepthPyramid::Build(VK::CommandBuffer& commandBuffer, unsigned i, VkExtent2D extent)
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = mImage;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mMipCount, 0, 1 };
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer[i], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    Params params = {};
+    params.depthSize[0] = extent.width;
+    params.depthSize[1] = extent.height;
+    params.size[0] = mExtent.width;
+    params.size[1] = mExtent.height;
+    params.mipCount = mMipCount;
+
+    uint32_t groupsX = (mExtent.width + TileSize - 1) / TileSize;
+    uint32_t groupsY = (mExtent.height + TileSize - 1) / TileSize;
+    params.groupCount = groupsX * groupsY;
+
+    commandBuffer.BindComputePipeline(i, mPipeline);
+    commandBuffer.BindComputeDescriptorSet(i, mPipeline, { mSet.Get(0) });
+    commandBuffer.PushConstants(i, mPipeline.Layout(), VK_SHADER_STAGE_COMPUTE_BIT, &params, sizeof(Params));
+    commandBuffer.Dispatch(i, groupsX, groupsY);
+
+    commandBuffer.ComputeToComputeBarrier(i);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the view of every mip
+*/
+/****************************************************************************/
+VkImageView VK::DepthPyramid::View() const
+{
+    return mView.Get();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the nearest, clamped sampler the pyramid is read with
+*/
+/****************************************************************************/
+VkSampler VK::DepthPyramid::Sampler() const
+{
+    return mSampler.Get();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the size of mip 0
+*/
+/****************************************************************************/
+VkExtent2D VK::DepthPyramid::Extent() const
+{
+    return mExtent;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of mips, down to 1x1
+*/
+/****************************************************************************/
+uint32_t VK::DepthPyramid::MipCount() const
+{
+    return mMipCount;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Was the pyramid created
+*/
+/****************************************************************************/
+bool VK::DepthPyramid::IsActive() const
+{
+    return mImage != VK_NULL_HANDLE;
+}
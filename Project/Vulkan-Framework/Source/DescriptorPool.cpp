@@ -66,6 +66,46 @@ void VK::DescriptorPool::Create(VK::Device& device, unsigned bufferCount, VkDevi
     }
 }
 
+/****************************************************************************/
+/*!
+\brief
+  create a pool sized exactly for a number of sets of one layout, like
+  one reflected from a shader
+
+\param bindings
+  The layout the sets are allocated with
+
+\param setCount
+  How many sets the pool has to hold
+*/
+/****************************************************************************/
+void VK::DescriptorPool::Create(VK::Device& device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, unsigned setCount)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (const VkDescriptorSetLayoutBinding& binding : bindings)
+    {
+        auto same = std::find_if(poolSizes.begin(), poolSizes.end(), [&binding](const VkDescriptorPoolSize& size)
+            { return size.type == binding.descriptorType; });
+
+        if (same == poolSizes.end())
+            poolSizes.push_back({ binding.descriptorType, binding.descriptorCount * setCount });
+        else
+            same->descriptorCount += binding.descriptorCount * setCount;
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = uint32_t(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+
+    if (vkCreateDescriptorPool(device.Get(), &poolInfo, nullptr, &mPool) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("DescriptorPool::Create: failed to create descriptor pool!");
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -74,6 +74,7 @@ void VK::DescriptorSet::Create(VK::Device& device, VK::DescriptorPool& pool, std
         DEBUG::log.Error("DescriptorSet::Create: failed to allocate descriptor sets layout!");
         throw std::runtime_error("failed to allocate descriptor sets layout!");
     }
+    mBindings = bindings;
 
     std::vector<VkDescriptorSetLayout> layouts(bufferCount, mLayout);
     VkDescriptorSetAllocateInfo allocInfo = {};
@@ -89,68 +90,72 @@ void VK::DescriptorSet::Create(VK::Device& device, VK::DescriptorPool& pool, std
         throw std::runtime_error("failed to allocate descriptor sets!");
     }
 
-    // for each buffer
-    for (size_t i = 0; i < bufferCount; ++i)
+    // one template for the layout, every set is written from the same packed data
+    mTemplate.Create(device, mBindings, mLayout);
+
+    std::vector<VK::DescriptorInfo> data(mTemplate.SlotCount());
+    for (unsigned j = 0; j < images.size(); ++j)
     {
-        std::vector<VkDescriptorImageInfo> imageInfo = {};
-        imageInfo.resize(images.size());
-        for (unsigned j = 0; j < images.size(); ++j)
-        {
-            imageInfo[j].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-            imageInfo[j].imageView = images[j]->GetView();
-            imageInfo[j].sampler = samplers[j]->Get();
-        }
+        data[mTemplate.Slot(bsize + j)] = VK::DescriptorInfo::Image(images[j]->GetView(), VK_IMAGE_LAYOUT_GENERAL, samplers[j]->Get());
+    }
 
-        std::vector<VkWriteDescriptorSet> descriptorWrites = {};
+    for (size_t i = 0; i < bufferCount; ++i)
+    {
         if (bufferSize > 0)
         {
-            // fill out each buffer and images info
-            VkDescriptorBufferInfo bufferInfo = {};
-            bufferInfo.buffer = buffers[i].Get();
-            bufferInfo.offset = 0;
-            bufferInfo.range = bufferSize;
-
-            descriptorWrites.resize(1 + imageInfo.size());
-            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[0].dstSet = mSets[i];
-            descriptorWrites[0].dstBinding = 0;
-            descriptorWrites[0].dstArrayElement = 0;
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrites[0].descriptorCount = 1;
-            descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-            for (unsigned j = 1; j <= images.size(); ++j)
-            {
-                descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                descriptorWrites[j].dstSet = mSets[i];
-                descriptorWrites[j].dstBinding = j;
-                descriptorWrites[j].dstArrayElement = 0;
-                descriptorWrites[j].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                descriptorWrites[j].descriptorCount = 1;
-                descriptorWrites[j].pImageInfo = &imageInfo[j - 1];
-            }
-        }
-        else
-        {
-            descriptorWrites.resize(imageInfo.size());
-            for (unsigned j = 0; j < images.size(); ++j)
-            {
-                descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                descriptorWrites[j].dstSet = mSets[i];
-                descriptorWrites[j].dstBinding = j;
-                descriptorWrites[j].dstArrayElement = 0;
-                descriptorWrites[j].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                descriptorWrites[j].descriptorCount = 1;
-                descriptorWrites[j].pImageInfo = &imageInfo[j];
-            }
+            data[mTemplate.Slot(0)] = VK::DescriptorInfo::Buffer(buffers[i].Get(), 0, bufferSize);
         }
 
+        mTemplate.Update(device, mSets[i], data.data());
+    }
+    mOwnsLayout = true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Allocate sets from a layout made elsewhere, e.g. one of a compute
+  pipeline's set layouts. The layout is not destroyed with the sets, fill
+  them with Update.
+*/
+/****************************************************************************/
+void VK::DescriptorSet::Create(VK::Device& device, VK::DescriptorPool& pool, VkDescriptorSetLayout layout,
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings, unsigned setCount)
+{
+    mLayout = layout;
+    mBindings = bindings;
+    mOwnsLayout = false;
+    mTemplate.Create(device, mBindings, mLayout);
+
+    std::vector<VkDescriptorSetLayout> layouts(setCount, mLayout);
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool.Get();
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(setCount);
+    allocInfo.pSetLayouts = layouts.data();
 
-        // fill the set
-        vkUpdateDescriptorSets(device.Get(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    mSets.resize(setCount);
+    if (vkAllocateDescriptorSets(device.Get(), &allocInfo, mSets.data()) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("DescriptorSet::Create: failed to allocate descriptor sets!");
+        throw std::runtime_error("failed to allocate descriptor sets!");
     }
 }
 
+/****************************************************************************/
+/*!
+\brief
+  Write every binding of one set at once through the layout's template
+
+\param data
+  Template().SlotCount() descriptors, placed with Template().Slot
+*/
+/****************************************************************************/
+void VK::DescriptorSet::Update(VK::Device& device, unsigned set, const VK::DescriptorInfo* data)
+{
+    mTemplate.Update(device, mSets[set], data);
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -159,7 +164,10 @@ void VK::DescriptorSet::Create(VK::Device& device, VK::DescriptorPool& pool, std
 /****************************************************************************/
 void VK::DescriptorSet::ShutDown(VK::Device& device)
 {
-    vkDestroyDescriptorSetLayout(device.Get(), mLayout, nullptr);
+    mTemplate.ShutDown(device);
+    if (mOwnsLayout)
+        vkDestroyDescriptorSetLayout(device.Get(), mLayout, nullptr);
+    mLayout = VK_NULL_HANDLE;
 }
 
 /****************************************************************************/
@@ -184,6 +192,28 @@ VkDescriptorSetLayout* VK::DescriptorSet::GetPointerToLayout()
     return &mLayout;
 }
 
+/****************************************************************************/
+/*!
+\brief
+  get the bindings the layout was made from
+*/
+/****************************************************************************/
+const std::vector<VkDescriptorSetLayoutBinding>& VK::DescriptorSet::Bindings() const
+{
+    return mBindings;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the update template of the layout
+*/
+/****************************************************************************/
+const VK::DescriptorTemplate& VK::DescriptorSet::Template() const
+{
+    return mTemplate;
+}
+
 /****************************************************************************/
 /*!
 \brief
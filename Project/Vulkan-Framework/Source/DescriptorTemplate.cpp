@@ -0,0 +1,188 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "DescriptorTemplate.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+static const uint32_t NoSlot = ~0u;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  A uniform or storage buffer descriptor
+*/
+/****************************************************************************/
+VK::DescriptorInfo VK::DescriptorInfo::Buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    DescriptorInfo info = {};
+    info.buffer = { buffer, offset, range };
+    return info;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  A sampled, storage or combined image sampler descriptor
+*/
+/****************************************************************************/
+VK::DescriptorInfo VK::DescriptorInfo::Image(VkImageView view, VkImageLayout layout, VkSampler sampler)
+{
+    DescriptorInfo info = {};
+    info.image = { sampler, view, layout };
+    return info;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Make a template that writes sets allocated from a layout
+*/
+/****************************************************************************/
+void VK::DescriptorTemplate::Create(VK::Device& device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayout layout)
+{
+    VkDescriptorUpdateTemplateCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    info.descriptorSetLayout = layout;
+
+    Build(device, bindings, info);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup
+*/
+/****************************************************************************/
+void VK::DescriptorTemplate::ShutDown(VK::Device& device)
+{
+    if (mTemplate != VK_NULL_HANDLE)
+        vkDestroyDescriptorUpdateTemplate(device.Get(), mTemplate, nullptr);
+
+    mTemplate = VK_NULL_HANDLE;
+    mFirstSlot.clear();
+    mSlotCount = 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write every descriptor of a set
+
+\param data
+  SlotCount descriptors, laid out as Slot says
+*/
+/****************************************************************************/
+void VK::DescriptorTemplate::Update(VK::Device& device, VkDescriptorSet set, const DescriptorInfo* data) const
+{
+    vkUpdateDescriptorSetWithTemplate(device.Get(), set, mTemplate, data);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the template
+*/
+/****************************************************************************/
+VkDescriptorUpdateTemplate VK::DescriptorTemplate::Get() const
+{
+    return mTemplate;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of DescriptorInfo a set's data holds
+*/
+/****************************************************************************/
+uint32_t VK::DescriptorTemplate::SlotCount() const
+{
+    return mSlotCount;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get where an array element of a binding goes in a set's data
+*/
+/****************************************************************************/
+uint32_t VK::DescriptorTemplate::Slot(uint32_t binding, uint32_t element) const
+{
+    assert(binding < mFirstSlot.size() && mFirstSlot[binding] != NoSlot);
+    return mFirstSlot[binding] + element;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Give every binding a run of slots in binding order, one entry each
+*/
+/****************************************************************************/
+void VK::DescriptorTemplate::Build(VK::Device& device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorUpdateTemplateCreateInfo& info)
+{
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    mFirstSlot.clear();
+    mSlotCount = 0;
+
+    for (const VkDescriptorSetLayoutBinding& binding : bindings)
+    {
+        if (binding.descriptorType == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT)
+        {
+            DEBUG::log.Error("DescriptorTemplate::Build: inline uniform blocks are not supported!");
+            throw std::runtime_error("inline uniform blocks are not supported!");
+        }
+
+        if (mFirstSlot.size() <= binding.binding)
+            mFirstSlot.resize(binding.binding + 1, NoSlot);
+        mFirstSlot[binding.binding] = mSlotCount;
+
+        VkDescriptorUpdateTemplateEntry entry = {};
+        entry.dstBinding = binding.binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = binding.descriptorCount;
+        entry.descriptorType = binding.descriptorType;
+        entry.offset = mSlotCount * sizeof(DescriptorInfo);
+        entry.stride = sizeof(DescriptorInfo);
+        entries.push_back(entry);
+
+        mSlotCount += binding.descriptorCount;
+    }
+
+    info.descriptorUpdateEntryCount = uint32_t(entries.size());
+    info.pDescriptorUpdateEntries = entries.data();
+
+    if (mTemplate != VK_NULL_HANDLE)
+        vkDestroyDescriptorUpdateTemplate(device.Get(), mTemplate, nullptr);
+
+    if (vkCreateDescriptorUpdateTemplate(device.Get(), &info, nullptr, &mTemplate) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("DescriptorTemplate::Build: failed to create descriptor update template!");
+        throw std::runtime_error("failed to create descriptor update template!");
+    }
+}
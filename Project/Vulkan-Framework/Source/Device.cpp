@@ -33,14 +33,29 @@
 /*!
 \brief
   create a new logical device and choose a physical device
+
+  A surface with a VK_NULL_HANDLE creates a headless device, no present
+  support or swap chain extension is required and the present queue is the
+  graphics queue.
+
+\param dynamicRendering
+  Enable VK_KHR_dynamic_rendering when the GPU has it, check
+  DynamicRendering afterwards
+
+\param drawIndirectCount
+  Enable the Vulkan 1.2 drawIndirectCount feature with multi draw and
+  first instance indirect draws when the GPU has them, check
+  DrawIndirectCount afterwards
 */
 /****************************************************************************/
-void VK::Device::Create(VK::Instance& instance, VK::Surface& surface, VkQueue& graphicsQueue, VkQueue& presentationQueue)
+void VK::Device::Create(VK::Instance& instance, VK::Surface& surface, VkQueue& graphicsQueue, VkQueue& presentationQueue, bool dynamicRendering,
+    bool drawIndirectCount)
 {
     if (mDevice != VK_NULL_HANDLE)
         ShutDown();
 
     // physical device
+    mHeadless = surface.Get() == VK_NULL_HANDLE;
     mPhysicalDevice.Create(instance, surface);
 
     mPhysicalDevice.FindQueueFamilies(mPhysicalDevice.mPhysicalDevice, surface);
@@ -71,6 +86,32 @@ void VK::Device::Create(VK::Instance& instance, VK::Surface& surface, VkQueue& g
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
+    // optional, older drivers keep rendering through render passes
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+    dynamicRendering = dynamicRendering && mPhysicalDevice.SupportsDynamicRendering();
+    if (dynamicRendering)
+    {
+        mPhysicalDevice.mDeviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        createInfo.pNext = &dynamicRenderingFeatures;
+    }
+
+    // GPU culling writes the draws and their count
+    VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.drawIndirectCount = VK_TRUE;
+
+    mDrawIndirectCount = drawIndirectCount && mPhysicalDevice.SupportsDrawIndirectCount();
+    if (mDrawIndirectCount)
+    {
+        deviceFeatures.multiDrawIndirect = VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+        vulkan12Features.pNext = dynamicRendering ? &dynamicRenderingFeatures : nullptr;
+        createInfo.pNext = &vulkan12Features;
+    }
+
     createInfo.enabledExtensionCount = static_cast<uint32_t>(mPhysicalDevice.mDeviceExtensions.size());
     createInfo.ppEnabledExtensionNames = mPhysicalDevice.mDeviceExtensions.data();
 
@@ -94,6 +135,14 @@ void VK::Device::Create(VK::Instance& instance, VK::Surface& surface, VkQueue& g
 
     vkGetDeviceQueue(mDevice, mPhysicalDevice.mQueueFamilyIndicies.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(mDevice, mPhysicalDevice.mQueueFamilyIndicies.presentFamily.value(), 0, &presentationQueue);
+
+    mBeginRendering = nullptr;
+    mEndRendering = nullptr;
+    if (dynamicRendering)
+    {
+        mBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(mDevice, "vkCmdBeginRenderingKHR"));
+        mEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(mDevice, "vkCmdEndRenderingKHR"));
+    }
 }
 
 /****************************************************************************/
@@ -209,6 +258,36 @@ uint32_t VK::Device::GraphicsFamily() const
     return mPhysicalDevice.mQueueFamilyIndicies.graphicsFamily.value();
 }
 
+/****************************************************************************/
+/*!
+\brief
+  Was this device created without a presentation surface
+*/
+/****************************************************************************/
+bool VK::Device::IsHeadless() const
+{
+    return mHeadless;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Can the present queue of this device present to another surface, the
+  device was picked for the first one
+*/
+/****************************************************************************/
+bool VK::Device::SupportsPresent(VK::Surface& surface) const
+{
+    if (mHeadless || !mPhysicalDevice.mQueueFamilyIndicies.presentFamily.has_value())
+        return false;
+
+    VkBool32 supported = VK_FALSE;
+    vkGetPhysicalDeviceSurfaceSupportKHR(mPhysicalDevice.mPhysicalDevice, mPhysicalDevice.mQueueFamilyIndicies.presentFamily.value(),
+        surface.Get(), &supported);
+
+    return supported == VK_TRUE;
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -229,6 +308,51 @@ uint32_t VK::Device::GetMemoryType(uint32_t typeBits, const VkMemoryPropertyFlag
     return ~0u;
 }
 
+/****************************************************************************/
+/*!
+\brief
+  Is VK_KHR_dynamic_rendering enabled on this device
+*/
+/****************************************************************************/
+bool VK::Device::DynamicRendering() const
+{
+    return mBeginRendering != nullptr && mEndRendering != nullptr;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Begin rendering straight into image views, only valid when
+  DynamicRendering is on
+*/
+/****************************************************************************/
+void VK::Device::CmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR& info) const
+{
+    mBeginRendering(commandBuffer, &info);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  End rendering started with CmdBeginRendering
+*/
+/****************************************************************************/
+void VK::Device::CmdEndRendering(VkCommandBuffer commandBuffer) const
+{
+    mEndRendering(commandBuffer);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Is vkCmdDrawIndexedIndirectCount usable on this device
+*/
+/****************************************************************************/
+bool VK::Device::DrawIndirectCount() const
+{
+    return mDrawIndirectCount;
+}
+
 /*============================================================================*\
 || ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
 \*============================================================================*/
@@ -241,6 +365,12 @@ uint32_t VK::Device::GetMemoryType(uint32_t typeBits, const VkMemoryPropertyFlag
 /****************************************************************************/
 void VK::Device::PhysicalDevice::Create(VK::Instance& instance, VK::Surface& surface)
 {
+    mDeviceExtensions.clear();
+    if (surface.Get() != VK_NULL_HANDLE)
+    {
+        mDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(instance.Get(), &deviceCount, nullptr);
 
@@ -297,8 +427,8 @@ bool VK::Device::PhysicalDevice::IsDeviceSuitable(VkPhysicalDevice device, VK::S
 
     bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported)
+    bool swapChainAdequate = surface.Get() == VK_NULL_HANDLE;
+    if (extensionsSupported && !swapChainAdequate)
     {
         SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device, surface);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -349,8 +479,16 @@ void VK::Device::PhysicalDevice::FindQueueFamilies(VkPhysicalDevice device, VK::
             mQueueFamilyIndicies.graphicsFamily = i;
         }
 
+        // headless devices never present, the graphics queue stands in
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface.Get(), &presentSupport);
+        if (surface.Get() == VK_NULL_HANDLE)
+        {
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        }
+        else
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface.Get(), &presentSupport);
+        }
 
         if (presentSupport)
         {
@@ -429,4 +567,80 @@ VK::Device::PhysicalDevice::SwapChainSupportDetails VK::Device::PhysicalDevice::
     }
 
     return details;
-}
\ No newline at end of file
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Does the chosen GPU have VK_KHR_dynamic_rendering and the feature on
+*/
+/****************************************************************************/
+bool VK::Device::PhysicalDevice::SupportsDynamicRendering() const
+{
+    if (!HasExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+    {
+        DEBUG::log.Info("Device: VK_KHR_dynamic_rendering is not supported, using render passes");
+        return false;
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRendering = {};
+    dynamicRendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &dynamicRendering;
+    vkGetPhysicalDeviceFeatures2(mPhysicalDevice, &features);
+
+    return dynamicRendering.dynamicRendering == VK_TRUE;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Does the chosen GPU have Vulkan 1.2 with drawIndirectCount, and the multi
+  draw and first instance features indirect draws of many objects need
+*/
+/****************************************************************************/
+bool VK::Device::PhysicalDevice::SupportsDrawIndirectCount() const
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(mPhysicalDevice, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2)
+    {
+        DEBUG::log.Info("Device: Vulkan 1.2 is not supported, culling on the CPU");
+        return false;
+    }
+
+    VkPhysicalDeviceVulkan12Features vulkan12 = {};
+    vulkan12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12;
+    vkGetPhysicalDeviceFeatures2(mPhysicalDevice, &features);
+
+    bool supported = vulkan12.drawIndirectCount && features.features.multiDrawIndirect && features.features.drawIndirectFirstInstance;
+    if (!supported)
+    {
+        DEBUG::log.Info("Device: drawIndirectCount is not supported, culling on the CPU");
+    }
+    return supported;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Does the chosen GPU have an optional extension
+*/
+/****************************************************************************/
+bool VK::Device::PhysicalDevice::HasExtension(const char* name) const
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    return std::any_of(availableExtensions.begin(), availableExtensions.end(), [name](const VkExtensionProperties& extension)
+        { return std::string(extension.extensionName) == name; });
+}
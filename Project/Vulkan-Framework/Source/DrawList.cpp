@@ -0,0 +1,239 @@
+/****************************************************************************/
+/*!
+\file
+   DrawList.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Draw ordering by sort key and merging into instanced draws
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "DrawList.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// key fields, least significant first
+static const unsigned DepthBits = 20;
+static const unsigned MeshBits = 16;
+static const unsigned MaterialBits = 16;
+static const unsigned PipelineBits = 10;
+static const unsigned PassBits = 2;
+
+static const unsigned MeshShift = DepthBits;
+static const unsigned MaterialShift = MeshShift + MeshBits;
+static const unsigned PipelineShift = MaterialShift + MaterialBits;
+static const unsigned PassShift = PipelineShift + PipelineBits;
+static_assert(PassShift + PassBits == 64, "the key fields must fill 64 bits");
+
+// draws per sort chunk, short lists are sorted on the calling thread
+static const uint32_t SortGrain = 16384;
+
+// a byte per pass
+static const unsigned RadixBits = 8;
+static const unsigned Buckets = 1u << RadixBits;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  A field of a key, wrapped to its width
+*/
+/****************************************************************************/
+static uint64_t Field(uint64_t value, unsigned bits, unsigned shift)
+{
+    return (value & ((uint64_t(1) << bits) - 1)) << shift;
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Sort the items and batch them
+*/
+/****************************************************************************/
+void VK::DrawList::Build(VK::JobPool& jobs, const std::vector<DrawItem>& items, const glm::mat4& view, float farPlane)
+{
+    uint32_t count = uint32_t(items.size());
+    mEntries.resize(count);
+
+    float scale = farPlane > 0 ? 1.0f / farPlane : 0.0f;
+    jobs.For(count, SortGrain, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            // the camera looks down -z
+            const glm::mat4& world = items[i].world;
+            float viewZ = view[0].z * world[3].x + view[1].z * world[3].y + view[2].z * world[3].z + view[3].z;
+            mEntries[i] = { MakeKey(items[i], -viewZ * scale), i };
+        }
+    });
+
+    Sort(jobs);
+
+    mOrder.resize(count);
+    mBatches.clear();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        mOrder[i] = mEntries[i].index;
+
+        // everything above the depth is what a batch shares
+        if (i == 0 || (mEntries[i].key >> MeshShift) != (mEntries[i - 1].key >> MeshShift))
+        {
+            const DrawItem& item = items[mEntries[i].index];
+
+            DrawBatch batch;
+            batch.pass = item.pass;
+            batch.pipeline = item.pipeline;
+            batch.material = item.material;
+            batch.mesh = item.mesh;
+            batch.firstInstance = i;
+            mBatches.push_back(batch);
+        }
+        ++mBatches.back().instanceCount;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the item index of every draw in sorted order
+*/
+/****************************************************************************/
+const std::vector<uint32_t>& VK::DrawList::Order() const
+{
+    return mOrder;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the instanced draws, their instances index the sorted order
+*/
+/****************************************************************************/
+const std::vector<VK::DrawBatch>& VK::DrawList::Batches() const
+{
+    return mBatches;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Pack a draw's state and depth into its sort key
+*/
+/****************************************************************************/
+uint64_t VK::DrawList::MakeKey(const DrawItem& item, float depth)
+{
+    const uint64_t maxDepth = (uint64_t(1) << DepthBits) - 1;
+    uint64_t quantized = uint64_t(std::clamp(depth, 0.0f, 1.0f) * float(maxDepth));
+    if (item.pass == DrawPass::Transparent)
+    {
+        quantized = maxDepth - quantized;
+    }
+
+    return Field(uint64_t(item.pass), PassBits, PassShift) |
+        Field(item.pipeline, PipelineBits, PipelineShift) |
+        Field(item.material, MaterialBits, MaterialShift) |
+        Field(item.mesh, MeshBits, MeshShift) |
+        quantized;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Stable least significant digit radix sort of the entries, a byte at a
+  time. Each chunk counts its own digits, the counts are turned into write
+  offsets per chunk and bucket, then every chunk scatters on its own.
+  Bytes every key shares are skipped.
+*/
+/****************************************************************************/
+void VK::DrawList::Sort(VK::JobPool& jobs)
+{
+    uint32_t count = uint32_t(mEntries.size());
+    if (count < 2)
+        return;
+
+    uint32_t chunkCount = (count + SortGrain - 1) / SortGrain;
+    uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    mScratch.resize(count);
+    mHistograms.resize(size_t(chunkCount) * Buckets);
+
+    std::vector<Entry>* source = &mEntries;
+    std::vector<Entry>* destination = &mScratch;
+
+    for (unsigned shift = 0; shift < 64; shift += RadixBits)
+    {
+        jobs.For(chunkCount, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t chunk = begin; chunk < end; ++chunk)
+            {
+                uint32_t* histogram = &mHistograms[size_t(chunk) * Buckets];
+                std::fill(histogram, histogram + Buckets, 0u);
+
+                uint32_t last = std::min(count, (chunk + 1) * chunkSize);
+                for (uint32_t i = chunk * chunkSize; i < last; ++i)
+                    ++histogram[((*source)[i].key >> shift) & (Buckets - 1)];
+            }
+        });
+
+        // bucket by bucket, chunk by chunk, so equal digits keep their order
+        uint32_t offset = 0;
+        bool shared = false;
+        for (unsigned bucket = 0; bucket < Buckets && !shared; ++bucket)
+        {
+            uint32_t first = offset;
+            for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+            {
+                uint32_t& slot = mHistograms[size_t(chunk) * Buckets + bucket];
+                uint32_t bucketCount = slot;
+                slot = offset;
+                offset += bucketCount;
+            }
+            shared = offset - first == count;
+        }
+
+        if (shared)
+            continue;
+
+        jobs.For(chunkCount, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t chunk = begin; chunk < end; ++chunk)
+            {
+                uint32_t* offsets = &mHistograms[size_t(chunk) * Buckets];
+
+                uint32_t last = std::min(count, (chunk + 1) * chunkSize);
+                for (uint32_t i = chunk * chunkSize; i < last; ++i)
+                {
+                    const Entry& entry = (*source)[i];
+                    (*destination)[offsets[(entry.key >> shift) & (Buckets - 1)]++] = entry;
+                }
+            }
+        });
+
+        std::swap(source, destination);
+    }
+
+    if (source != &mEntries)
+    {
+        mEntries.swap(mScratch);
+    }
+}
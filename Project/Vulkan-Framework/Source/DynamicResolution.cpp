@@ -0,0 +1,263 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "DynamicResolution.hpp"
+#include <cmath>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// render sizes are kept to multiples of this so the scale does not
+// re-record command buffers over a pixel or two
+static const uint32_t ExtentStep = 8;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Create the timestamp queries, the scale starts at its maximum
+
+\param swapChainExtent
+  The size a scale of 1 renders at
+
+\param imageCount
+  Number of command buffers that get timed, one query pair each
+
+\param timeFrames
+  Time the frames with its own queries, false when the times are handed
+  to Update from elsewhere
+*/
+/****************************************************************************/
+void VK::DynamicResolution::Create(VK::Device& device, VkExtent2D swapChainExtent, uint32_t imageCount, const DynamicResolutionDesc& desc,
+    bool timeFrames)
+{
+    ShutDown(device);
+
+    mDesc = desc;
+    mDesc.maxScale = std::clamp(desc.maxScale, 0.1f, 2.0f);
+    mDesc.minScale = std::clamp(desc.minScale, 0.1f, mDesc.maxScale);
+    mBaseExtent = swapChainExtent;
+    mScale = mDesc.maxScale;
+    mExtent = ScaledExtent(mScale);
+    mGpuTime = 0.0f;
+    mSubmitted.assign(imageCount, false);
+    mActive = true;
+
+    if (!timeFrames)
+        return;
+
+    // without timestamps the target still works, it just stays at the max scale
+    mClock = TimestampClock::FromDevice(device);
+    if (!mClock.IsValid())
+    {
+        DEBUG::log.Info("DynamicResolution::Create: the graphics queue has no timestamps, the render scale is fixed!");
+        return;
+    }
+
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = imageCount * 2;
+
+    if (vkCreateQueryPool(device.Get(), &poolInfo, nullptr, &mQueryPool) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("DynamicResolution::Create: failed to create query pool!");
+        throw std::runtime_error("failed to create query pool!");
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup
+*/
+/****************************************************************************/
+void VK::DynamicResolution::ShutDown(VK::Device& device)
+{
+    if (mQueryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(device.Get(), mQueryPool, nullptr);
+        mQueryPool = VK_NULL_HANDLE;
+    }
+
+    mSubmitted.clear();
+    mActive = false;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Start timing a command buffer, record before the first pass
+*/
+/****************************************************************************/
+void VK::DynamicResolution::BeginFrame(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    if (mQueryPool == VK_NULL_HANDLE)
+        return;
+
+    vkCmdResetQueryPool(commandBuffer, mQueryPool, imageIndex * 2, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mQueryPool, imageIndex * 2);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Stop timing a command buffer, record after the last pass
+*/
+/****************************************************************************/
+void VK::DynamicResolution::EndFrame(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    if (mQueryPool == VK_NULL_HANDLE)
+        return;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mQueryPool, imageIndex * 2 + 1);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Read the time of the last frame that used this image and move the scale
+  towards the budget. Call once the image's previous frame has finished
+  and right before it is submitted again.
+*/
+/****************************************************************************/
+void VK::DynamicResolution::Update(VK::Device& device, uint32_t imageIndex)
+{
+    if (mQueryPool == VK_NULL_HANDLE)
+        return;
+
+    bool submitted = mSubmitted[imageIndex];
+    mSubmitted[imageIndex] = true;
+    if (!submitted)
+        return;
+
+    uint64_t timestamps[2] = {};
+    if (vkGetQueryPoolResults(device.Get(), mQueryPool, imageIndex * 2, 2, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+        return;
+
+    Update(mClock.Milliseconds(timestamps[0], timestamps[1]));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Move the scale towards the budget from a frame's GPU time in
+  milliseconds. Going over budget sheds pixels right away, the scale only
+  creeps back up.
+*/
+/****************************************************************************/
+void VK::DynamicResolution::Update(float gpuTime)
+{
+    mGpuTime = gpuTime;
+
+    // the GPU time goes with the pixel count, so with the square of the scale
+    float target = mScale * std::sqrt(mDesc.budgetMs / std::max(gpuTime, 0.01f));
+    float rate = target < mScale ? 0.75f : 0.05f;
+
+    mScale = std::clamp(mScale + (target - mScale) * rate, mDesc.minScale, mDesc.maxScale);
+    mExtent = ScaledExtent(mScale);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Change the GPU time the scale steers towards
+*/
+/****************************************************************************/
+void VK::DynamicResolution::SetBudget(float budgetMs)
+{
+    mDesc.budgetMs = budgetMs;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Was the scaler created
+*/
+/****************************************************************************/
+bool VK::DynamicResolution::IsActive() const
+{
+    return mActive;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the size the scene renders at right now
+*/
+/****************************************************************************/
+VkExtent2D VK::DynamicResolution::Extent() const
+{
+    return mExtent;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the size the render target has to be
+*/
+/****************************************************************************/
+VkExtent2D VK::DynamicResolution::MaxExtent() const
+{
+    return ScaledExtent(mDesc.maxScale);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the current render scale
+*/
+/****************************************************************************/
+float VK::DynamicResolution::Scale() const
+{
+    return mScale;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the last measured GPU frame time in milliseconds
+*/
+/****************************************************************************/
+float VK::DynamicResolution::GpuTime() const
+{
+    return mGpuTime;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Get the swap chain extent scaled and snapped to the extent step
+*/
+/****************************************************************************/
+VkExtent2D VK::DynamicResolution::ScaledExtent(float scale) const
+{
+    uint32_t width = uint32_t(float(mBaseExtent.width) * scale) / ExtentStep * ExtentStep;
+    uint32_t height = uint32_t(float(mBaseExtent.height) * scale) / ExtentStep * ExtentStep;
+
+    return { std::max(width, ExtentStep), std::max(height, ExtentStep) };
+}
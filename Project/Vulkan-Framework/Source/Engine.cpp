@@ -17,15 +17,33 @@
 
 #include "VULKANPCH.hpp"
 #include "Engine.hpp"
+#include <chrono>
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
 \*============================================================================*/
 
+// mDrawOf of a node without a draw
+static const uint32_t NoDraw = ~0u;
+
 /*============================================================================*\
 || -------------------------- STATIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
 
+/****************************************************************************/
+/*!
+\brief
+  Seconds since the first call, does not rely on GLFW so headless
+  renderers can use it
+*/
+/****************************************************************************/
+static double GetTime()
+{
+    using Clock = std::chrono::steady_clock;
+    static const Clock::time_point start = Clock::now();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
 /*============================================================================*\
 || -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
@@ -36,8 +54,9 @@
   Create the engine
 */
 /****************************************************************************/
-VK::Engine::Engine() :
-    pPreviousTime(glfwGetTime()),
+VK::Engine::Engine(const RendererConfig& config) :
+    mRenderer(config),
+    pPreviousTime(GetTime()),
     pStartTime(float(pPreviousTime)),
     pGameLoopIterations(0),
     pFPSCalcInterval(1),
@@ -53,20 +72,89 @@ VK::Engine::Engine() :
 void VK::Engine::Init()
 {
     mWindow = mRenderer.Window(); 
+
+    mJobs.Create();
+    mBunny = mScene.Create();
+    mDrawNodes.push_back(mBunny);
+    mDrawMeshes.push_back(0);
+
+    mDrawOf.assign(mScene.Size(), NoDraw);
+    for (uint32_t i = 0; i < mDrawNodes.size(); ++i)
+    {
+        mDrawOf[mDrawNodes[i]] = i;
+    }
 }
 
 /****************************************************************************/
 /*!
 \brief
   Update the engine
+
+\param frameCount
+  Stop after this many frames, 0 runs until the window is closed
+  (headless renderers have no window and need a frame count)
 */
 /****************************************************************************/
-void VK::Engine::Run()
+void VK::Engine::Run(unsigned frameCount)
 {
-    while (!glfwWindowShouldClose(mWindow))
+    mFrameQueue.Reset();
+    mRenderError = nullptr;
+
+    // the time since the last run is not a frame
+    mRenderer.ResetFrameClock();
+    mRenderThread = std::thread(&VK::Engine::RenderThread, this);
+
+    // the window has to be polled from the thread that created it
+    for (unsigned frame = 0; frameCount == 0 || frame < frameCount; ++frame)
     {
+        mRenderer.PollEvents();
+        if (mWindow && glfwWindowShouldClose(mWindow))
+            break;
+
         float dt = UpdateDT();
-        mRenderer.Draw(dt);
+
+        // blocks once the render thread is a full queue behind
+        FramePacket* packet = mFrameQueue.BeginWrite();
+        if (!packet)
+            break;
+
+        Simulate(dt, *packet);
+        mFrameQueue.EndWrite();
+    }
+
+    // the render thread drains what was already published
+    mFrameQueue.Close();
+    mRenderThread.join();
+    mRenderer.WaitIdle();
+
+    if (mRenderError)
+    {
+        std::rethrow_exception(mRenderError);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Draw packets until the queue is closed, errors are handed back to Run
+*/
+/****************************************************************************/
+void VK::Engine::RenderThread()
+{
+    try
+    {
+        while (const FramePacket* packet = mFrameQueue.BeginRead())
+        {
+            mRenderer.Draw(*packet);
+            mFrameQueue.EndRead();
+        }
+    }
+    catch (...)
+    {
+        mRenderError = std::current_exception();
+
+        // unblock the simulation
+        mFrameQueue.Close();
     }
 }
 
@@ -79,12 +167,209 @@ void VK::Engine::Run()
 void VK::Engine::ShutDown()
 {
     mWindow = nullptr;
+
+    mScene.Clear();
+    mDrawNodes.clear();
+    mDrawMeshes.clear();
+    mDrawOf.clear();
+    mJobs.ShutDown();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the frame time percentiles and hitches the renderer measured, safe
+  to call while the engine runs
+*/
+/****************************************************************************/
+VK::FrameStatsReport VK::Engine::FrameReport() const
+{
+    return mRenderer.FrameReport();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Step every frame by the same time instead of the clock's, so the scene
+  and camera go through the same states on every run
+
+\param dt
+  Seconds a frame advances, 0 goes back to the clock
+*/
+/****************************************************************************/
+void VK::Engine::SetFixedStep(float dt)
+{
+    mFixedStep = std::max(dt, 0.0f);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Move the camera around the origin, looking at it
+
+\param radius
+  Distance from the vertical axis, 0 keeps the default view
+
+\param height
+  Height of the camera above the origin
+
+\param period
+  Seconds of simulation time a circle takes
+*/
+/****************************************************************************/
+void VK::Engine::SetCameraOrbit(float radius, float height, float period)
+{
+    mOrbitRadius = std::max(radius, 0.0f);
+    mOrbitHeight = height;
+    mOrbitPeriod = period > 0 ? period : 1.0f;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Add a cube of objects that never move, between frames only
+
+\param count
+  Objects to add
+
+\param spacing
+  Distance between neighbouring objects
+
+\param unique
+  Give every object its own mesh id so each is a batch of its own, the
+  ids wrap at what a draw key holds
+*/
+/****************************************************************************/
+void VK::Engine::AddObjects(uint32_t count, float spacing, bool unique)
+{
+    uint32_t side = 1;
+    while (side * side * side < count)
+    {
+        ++side;
+    }
+    float offset = float(side - 1) * spacing * 0.5f;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        glm::vec3 cell(float(i % side), float(i / side % side), float(i / (side * side)));
+
+        SceneNode node = mScene.Create();
+        mScene.SetLocal(node, glm::translate(glm::mat4(1), cell * spacing - offset));
+        mDrawNodes.push_back(node);
+        mDrawMeshes.push_back(unique ? i + 1 : 0);
+    }
+
+    mDrawOf.assign(mScene.Size(), NoDraw);
+    for (uint32_t i = 0; i < mDrawNodes.size(); ++i)
+    {
+        mDrawOf[mDrawNodes[i]] = i;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the renderer, for settings and targets
+*/
+/****************************************************************************/
+VK::Renderer& VK::Engine::GetRenderer()
+{
+    return mRenderer;
 }
 
 /*============================================================================*\
 || ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
 \*============================================================================*/
 
+/****************************************************************************/
+/*!
+\brief
+  Advance the test scene and fill the packet for this frame
+*/
+/****************************************************************************/
+void VK::Engine::Simulate(float dt, FramePacket& packet)
+{
+    // Camera
+    float y = -0.1f;
+    glm::vec3 position = { 0, y, 1 };
+    glm::vec3 target = { 0, y, 0 };
+    glm::vec3 up = { 0, 1, 0 };
+    float fov = 0.42173f;
+    float nearPlane = 0.1f;
+    float farPlane = 250.f;
+
+    packet.frame = mFrame++;
+    packet.dt = dt;
+    packet.proj = glm::perspective(fov, mRenderer.AspectRatio(), nearPlane, farPlane);
+
+    mTime += dt;
+    if (mOrbitRadius > 0)
+    {
+        float angle = 2.0f * PI * mTime / mOrbitPeriod;
+        position = { std::sin(angle) * mOrbitRadius, mOrbitHeight, std::cos(angle) * mOrbitRadius };
+        target = { 0, 0, 0 };
+    }
+    packet.view = glm::lookAt(position, target, up);
+
+    // spin the bunny
+    mAngle -= dt;
+    mScene.SetLocal(mBunny, glm::rotate(glm::mat4(1), mAngle, { 0, 1, 0 }));
+    mScene.Update(mJobs);
+
+    // the GPU culls for itself and keeps the objects between frames, so
+    // the draws stay in node order and only the moved ones are flagged
+    uint32_t drawCount = uint32_t(mDrawNodes.size());
+    if (mRenderer.GpuCulling())
+    {
+        packet.draws.resize(drawCount);
+        for (uint32_t i = 0; i < drawCount; ++i)
+        {
+            packet.draws[i] = DrawItem();
+            packet.draws[i].world = mScene.World(mDrawNodes[i]);
+            packet.draws[i].mesh = mDrawMeshes[i];
+        }
+        packet.batches.clear();
+
+        packet.changed.clear();
+        for (SceneNode node : mScene.Changed())
+        {
+            if (node < mDrawOf.size() && mDrawOf[node] != NoDraw)
+                packet.changed.push_back(mDrawOf[node]);
+        }
+        return;
+    }
+
+    // only what the camera can see goes to the renderer
+    mCullList.Resize(drawCount);
+    for (uint32_t i = 0; i < drawCount; ++i)
+    {
+        mCullList.Set(i, mRenderer.MeshBounds(mDrawMeshes[i]), mScene.World(mDrawNodes[i]));
+    }
+    mCuller.Cull(mJobs, VK::Frustum::FromMatrix(packet.proj * packet.view), mCullList, mVisible);
+
+    mItems.clear();
+    for (uint32_t visible : mVisible)
+    {
+        DrawItem item;
+        item.world = mScene.World(mDrawNodes[visible]);
+        item.mesh = mDrawMeshes[visible];
+        mItems.push_back(item);
+    }
+
+    // grouped by state and front to back, runs of the same mesh and
+    // material are drawn instanced
+    mDrawList.Build(mJobs, mItems, packet.view, farPlane);
+
+    const std::vector<uint32_t>& order = mDrawList.Order();
+    packet.draws.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        packet.draws[i] = mItems[order[i]];
+    }
+    packet.batches = mDrawList.Batches();
+    packet.changed.clear();
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -94,7 +379,7 @@ void VK::Engine::ShutDown()
 float VK::Engine::UpdateDT()
 {
     /* calcualte dt */
-    double currentTime = glfwGetTime();
+    double currentTime = GetTime();
     double deltaTime_ = currentTime - pPreviousTime;
     pPreviousTime = currentTime;
 
@@ -102,14 +387,30 @@ float VK::Engine::UpdateDT()
     float elapsedTime = float(currentTime - pStartTime);
     ++pGameLoopIterations;
 
-    // after 1 second, calulate fps
+    // after 1 second, calulate fps and log the frame time tail
     if (elapsedTime > pFPSCalcInterval)
     {
         pFPS = pGameLoopIterations / elapsedTime;
         pStartTime = float(currentTime);
         pGameLoopIterations = 0;
+
+        VK::FrameStatsReport report = mRenderer.FrameReport();
+        std::ostringstream line;
+        line.setf(std::ios::fixed);
+        line.precision(2);
+        line << "Engine: " << pFPS << " fps, cpu p50 " << report.cpu.p50 << " p99 " << report.cpu.p99
+            << " p99.9 " << report.cpu.p999 << " ms, wait p99 " << report.wait.p99 << " ms";
+        if (report.gpu.count > 0)
+        {
+            line << ", gpu p50 " << report.gpu.p50 << " p99 " << report.gpu.p99 << " ms";
+        }
+        line << ", " << report.hitches << " hitches";
+        DEBUG::log.Info(line.str());
     }
 
+    // the stats are written here rather than on the render thread they time
+    mRenderer.ExportFrameStats();
+
     // return dt
-    return float(deltaTime_);
+    return mFixedStep > 0 ? mFixedStep : float(deltaTime_);
 }
@@ -0,0 +1,156 @@
+/****************************************************************************/
+/*!
+\file
+   FrameQueue.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Hands frame packets from the simulation thread to the render thread
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "FrameQueue.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Do two batches draw the same thing
+*/
+/****************************************************************************/
+bool VK::DrawBatch::operator==(const DrawBatch& rhs) const
+{
+    return pass == rhs.pass && pipeline == rhs.pipeline && material == rhs.material && mesh == rhs.mesh &&
+        firstInstance == rhs.firstInstance && instanceCount == rhs.instanceCount;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Do two batches differ
+*/
+/****************************************************************************/
+bool VK::DrawBatch::operator!=(const DrawBatch& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the next free packet to fill, blocks while the render thread is
+  a full queue behind
+
+\return
+  The packet, or nullptr once the queue is closed
+*/
+/****************************************************************************/
+VK::FramePacket* VK::FrameQueue::BeginWrite()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this] { return mClosed || mCount < Capacity; });
+
+    if (mClosed)
+        return nullptr;
+
+    return &mPackets[(mRead + mCount) % Capacity];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Publish the packet returned by BeginWrite
+*/
+/****************************************************************************/
+void VK::FrameQueue::EndWrite()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mCount;
+    }
+    mCondition.notify_all();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the oldest published packet, blocks until one is available
+
+\return
+  The packet, or nullptr once the queue is closed and drained
+*/
+/****************************************************************************/
+const VK::FramePacket* VK::FrameQueue::BeginRead()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this] { return mClosed || mCount > 0; });
+
+    if (mCount == 0)
+        return nullptr;
+
+    return &mPackets[mRead];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Return the packet returned by BeginRead to the producer
+*/
+/****************************************************************************/
+void VK::FrameQueue::EndRead()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRead = (mRead + 1) % Capacity;
+        --mCount;
+    }
+    mCondition.notify_all();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Stop accepting packets and wake up both threads, the reader still
+  gets the packets that were already published
+*/
+/****************************************************************************/
+void VK::FrameQueue::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+    }
+    mCondition.notify_all();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Drop every packet and reopen the queue, neither thread may be using it
+*/
+/****************************************************************************/
+void VK::FrameQueue::Reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRead = 0;
+    mCount = 0;
+    mClosed = false;
+}
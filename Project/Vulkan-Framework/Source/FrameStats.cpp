@@ -0,0 +1,313 @@
+/****************************************************************************/
+/*!
+\file
+   FrameStats.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Frame time distributions, hitches and their export
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "FrameStats.hpp"
+#include <cmath>
+#include <fstream>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// most hitches a report lists
+static const size_t MaxHitches = 64;
+
+// frames before hitches are looked for, the average needs to settle
+static const uint64_t WarmUpFrames = 16;
+
+// weight of a new frame in the running average
+static const float AverageRate = 0.1f;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Nearest rank percentile of sorted times
+*/
+/****************************************************************************/
+static float Percentile(const std::vector<float>& sorted, double percent)
+{
+    size_t rank = size_t(std::ceil(percent / 100.0 * double(sorted.size())));
+    return sorted[std::min(std::max(rank, size_t(1)), sorted.size()) - 1];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write a summary as a JSON object
+*/
+/****************************************************************************/
+static void WriteSummary(std::ofstream& file, const VK::FrameTimeSummary& summary)
+{
+    file << "{\"count\":" << summary.count << ",\"mean\":" << summary.mean << ",\"p50\":" << summary.p50
+        << ",\"p95\":" << summary.p95 << ",\"p99\":" << summary.p99 << ",\"p99.9\":" << summary.p999
+        << ",\"max\":" << summary.max << "}";
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Start over with no frames
+*/
+/****************************************************************************/
+void VK::FrameStats::Create(const FrameStatsDesc& desc)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDesc = desc;
+    mDesc.capacity = std::max(desc.capacity, 1u);
+    mSamples.clear();
+    mSamples.reserve(mDesc.capacity);
+    mHitches.clear();
+    mFrames = 0;
+    mHitchCount = 0;
+    mAverageMs = 0;
+    mSinceExport = 0;
+    mExportDue = false;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a frame over the oldest one and check it for a hitch
+*/
+/****************************************************************************/
+void VK::FrameStats::Add(const FrameSample& sample)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSamples.size() < mDesc.capacity)
+        mSamples.push_back(sample);
+    else
+        mSamples[mFrames % mDesc.capacity] = sample;
+
+    if (mFrames >= WarmUpFrames && sample.cpuMs > mAverageMs * mDesc.hitchFactor &&
+        sample.cpuMs > mAverageMs + mDesc.hitchMinMs)
+    {
+        if (mHitches.size() == MaxHitches)
+            mHitches.erase(mHitches.begin());
+
+        mHitches.push_back({ mFrames, sample.cpuMs, mAverageMs });
+        ++mHitchCount;
+    }
+
+    // hitches are kept out of the average so one does not hide the next
+    else
+    {
+        mAverageMs = mFrames == 0 ? sample.cpuMs : mAverageMs + (sample.cpuMs - mAverageMs) * AverageRate;
+    }
+    ++mFrames;
+
+    mSinceExport += sample.cpuMs / 1000.0;
+    if (mDesc.exportInterval > 0 && mSinceExport >= mDesc.exportInterval)
+    {
+        mSinceExport = 0;
+        mExportDue = true;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write the CSV and the JSON next to each other if the export interval
+  has passed, call from a thread that can wait on the files
+*/
+/****************************************************************************/
+bool VK::FrameStats::ExportIfDue()
+{
+    if (!mExportDue.exchange(false))
+        return false;
+
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        path = mDesc.exportPath;
+    }
+
+    bool csv = WriteCsv(path + ".csv");
+    bool json = WriteJson(path + ".json");
+    return csv && json;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Summarize the frames in the ring, the GPU only over the timed ones
+*/
+/****************************************************************************/
+VK::FrameStatsReport VK::FrameStats::Report() const
+{
+    FrameStatsReport report;
+    std::vector<float> cpu, gpu, wait;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        report.frames = mFrames;
+        report.hitches = mHitchCount;
+        report.recentHitches = mHitches;
+
+        cpu.reserve(mSamples.size());
+        wait.reserve(mSamples.size());
+        for (const FrameSample& sample : mSamples)
+        {
+            cpu.push_back(sample.cpuMs);
+            wait.push_back(sample.waitMs);
+            if (sample.gpuMs >= 0)
+                gpu.push_back(sample.gpuMs);
+        }
+    }
+
+    report.cpu = Summarize(cpu);
+    report.gpu = Summarize(gpu);
+    report.wait = Summarize(wait);
+    return report;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write a line per frame in the ring, GPU times that were not measured
+  are left empty
+
+\param path
+  File to write, replaced if it exists
+*/
+/****************************************************************************/
+bool VK::FrameStats::WriteCsv(const std::string& path) const
+{
+    uint64_t first = 0;
+    std::vector<FrameSample> samples = Snapshot(first);
+
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file)
+    {
+        DEBUG::log.Error("FrameStats::WriteCsv: failed to open " + path + "!");
+        return false;
+    }
+
+    file << "frame,cpu_ms,gpu_ms,wait_ms\n";
+
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        const FrameSample& sample = samples[i];
+        file << first + i << ',' << sample.cpuMs << ',';
+        if (sample.gpuMs >= 0)
+            file << sample.gpuMs;
+        file << ',' << sample.waitMs << '\n';
+    }
+
+    return bool(file);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write the report, with its percentiles and recent hitches
+
+\param path
+  File to write, replaced if it exists
+*/
+/****************************************************************************/
+bool VK::FrameStats::WriteJson(const std::string& path) const
+{
+    FrameStatsReport report = Report();
+
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file)
+    {
+        DEBUG::log.Error("FrameStats::WriteJson: failed to open " + path + "!");
+        return false;
+    }
+
+    file << "{\"frames\":" << report.frames << ",\"hitches\":" << report.hitches << ",\n\"cpu\":";
+    WriteSummary(file, report.cpu);
+    file << ",\n\"gpu\":";
+    WriteSummary(file, report.gpu);
+    file << ",\n\"wait\":";
+    WriteSummary(file, report.wait);
+    file << ",\n\"recentHitches\":[";
+    for (size_t i = 0; i < report.recentHitches.size(); ++i)
+    {
+        const FrameHitch& hitch = report.recentHitches[i];
+        file << (i ? "," : "") << "{\"frame\":" << hitch.frame << ",\"cpuMs\":" << hitch.cpuMs
+            << ",\"averageMs\":" << hitch.averageMs << "}";
+    }
+    file << "]}\n";
+
+    return bool(file);
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Sort the times and take their percentiles, all 0 without times
+*/
+/****************************************************************************/
+VK::FrameTimeSummary VK::FrameStats::Summarize(std::vector<float>& times)
+{
+    FrameTimeSummary summary;
+    if (times.empty())
+        return summary;
+
+    std::sort(times.begin(), times.end());
+
+    double sum = 0;
+    for (float time : times)
+        sum += time;
+
+    summary.count = uint32_t(times.size());
+    summary.mean = float(sum / double(times.size()));
+    summary.p50 = Percentile(times, 50.0);
+    summary.p95 = Percentile(times, 95.0);
+    summary.p99 = Percentile(times, 99.0);
+    summary.p999 = Percentile(times, 99.9);
+    summary.max = times.back();
+    return summary;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Copy the frames in the ring oldest first, so they can be written
+  without holding the lock
+
+\param first
+  Set to the number of the oldest frame
+*/
+/****************************************************************************/
+std::vector<VK::FrameSample> VK::FrameStats::Snapshot(uint64_t& first) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::vector<FrameSample> samples;
+    samples.reserve(mSamples.size());
+    first = mFrames - mSamples.size();
+    for (uint64_t frame = first; frame < mFrames; ++frame)
+    {
+        samples.push_back(mSamples[frame % mDesc.capacity]);
+    }
+    return samples;
+}
@@ -0,0 +1,419 @@
+/****************************************************************************/
+/*!
+\file
+   GpuCulling.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Frustum culling and draw generation on the GPU
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "GpuCulling.hpp"
+#include "PipelineCache.hpp"
+#include <cstddef>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// bindings of Cull.comp and CullOcclusion.comp
+static const uint32_t ObjectBinding = 0;
+static const uint32_t DrawBinding = 1;
+static const uint32_t CountBinding = 2;
+static const uint32_t CullDataBinding = 3;
+static const uint32_t PyramidBinding = 4;
+static const uint32_t VisibilityBinding = 5;
+
+// CullOcclusion.comp's LatePhase
+static const uint32_t LatePhaseConstant = 0;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Make an exclusive buffer
+*/
+/****************************************************************************/
+static void CreateBuffer(VK::Device& device, VK::Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    buffer.Create(device, bufferInfo, memory);
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Make the buffers and the cull pipeline
+
+\param imageCount
+  One set of buffers per image, the image's fence guards them
+
+\param capacity
+  Most objects an image can hold, more are left out
+
+\param pyramid
+  Culls occluded objects against it in two phases when given, it must
+  outlive the culling
+*/
+/****************************************************************************/
+void VK::GpuCulling::Create(VK::Device& device, VK::PipelineCache& cache, unsigned imageCount, uint32_t capacity,
+    const VK::DepthPyramid* pyramid)
+{
+    if (!device.DrawIndirectCount())
+    {
+        DEBUG::log.Error("GpuCulling::Create: drawIndirectCount is not supported!");
+        throw std::runtime_error("drawIndirectCount is not supported!");
+    }
+
+    mCapacity = std::max(capacity, 1u);
+    mPyramid = pyramid;
+    mStats = GpuCullingStats();
+
+    VK::ComputePipelineDesc desc;
+    desc.computePath = "../Resource/Shaders/Cull.comp";
+    if (Occlusion())
+    {
+        desc.computePath = "../Resource/Shaders/CullOcclusion.comp";
+        desc.Specialize(LatePhaseConstant, true);
+        mLatePipeline.Create(device, cache, desc);
+
+        desc.specialization.clear();
+        desc.Specialize(LatePhaseConstant, false);
+    }
+    mPipeline.Create(device, cache, desc);
+    mScene.Create(device, cache, imageCount, mCapacity);
+
+    mCullData.resize(imageCount);
+    mDraws.resize(imageCount);
+    mCounts.resize(imageCount);
+    mMappedCullData.resize(imageCount);
+    mMappedCounts.resize(imageCount);
+
+    // the early draws, then the late ones
+    VkDeviceSize drawSize = sizeof(VkDrawIndexedIndirectCommand) * mCapacity * (Occlusion() ? 2 : 1);
+
+    const VkMemoryPropertyFlags hostMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (unsigned i = 0; i < imageCount; ++i)
+    {
+        CreateBuffer(device, mCullData[i], sizeof(CullData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, hostMemory);
+        CreateBuffer(device, mDraws[i], drawSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        // host visible so the stats can be read once the image's fence is done
+        CreateBuffer(device, mCounts[i], sizeof(Counters),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostMemory);
+
+        void* data = nullptr;
+        mCullData[i].Map(device, sizeof(CullData), &data);
+        mMappedCullData[i] = static_cast<CullData*>(data);
+        *mMappedCullData[i] = {};
+
+        mCounts[i].Map(device, sizeof(Counters), &data);
+        mMappedCounts[i] = static_cast<Counters*>(data);
+        *mMappedCounts[i] = {};
+    }
+
+    // left uninitialized, whatever the first early phase draws the late
+    // phase of the same frame makes up for
+    if (Occlusion())
+    {
+        CreateBuffer(device, mVisibility, sizeof(uint32_t) * mCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    // one cull set per image
+    const std::vector<VkDescriptorSetLayoutBinding>& cullBindings = mPipeline.SetBindings(0);
+    mCullPool.Create(device, cullBindings, imageCount);
+    mCullSets.Create(device, mCullPool, mPipeline.SetLayout(0), cullBindings, imageCount);
+
+    // and one object set, for the vertex shader
+    std::vector<VkDescriptorSetLayoutBinding> objectBindings = ObjectBindings();
+    mObjectPool.Create(device, objectBindings, imageCount);
+    mObjectSets.Create(device, mObjectPool, cache.GetSetLayout(device, objectBindings), objectBindings, imageCount);
+
+    // the shared descriptors are filled once, only the per image ones
+    // change between sets
+    const VK::DescriptorTemplate& cullTemplate = mCullSets.Template();
+    std::vector<VK::DescriptorInfo> cullData(cullTemplate.SlotCount());
+    cullData[cullTemplate.Slot(ObjectBinding)] = VK::DescriptorInfo::Buffer(mScene.Objects());
+    if (Occlusion())
+    {
+        cullData[cullTemplate.Slot(PyramidBinding)] = VK::DescriptorInfo::Image(mPyramid->View(), VK_IMAGE_LAYOUT_GENERAL, mPyramid->Sampler());
+        cullData[cullTemplate.Slot(VisibilityBinding)] = VK::DescriptorInfo::Buffer(mVisibility.Get());
+    }
+
+    const VK::DescriptorTemplate& objectTemplate = mObjectSets.Template();
+    std::vector<VK::DescriptorInfo> objectData(objectTemplate.SlotCount());
+    objectData[objectTemplate.Slot(0)] = VK::DescriptorInfo::Buffer(mScene.Objects());
+
+    for (unsigned i = 0; i < imageCount; ++i)
+    {
+        cullData[cullTemplate.Slot(DrawBinding)] = VK::DescriptorInfo::Buffer(mDraws[i].Get());
+        cullData[cullTemplate.Slot(CountBinding)] = VK::DescriptorInfo::Buffer(mCounts[i].Get());
+        cullData[cullTemplate.Slot(CullDataBinding)] = VK::DescriptorInfo::Buffer(mCullData[i].Get(), 0, offsetof(CullData, groups));
+        mCullSets.Update(device, i, cullData.data());
+
+        mObjectSets.Update(device, i, objectData.data());
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, the GPU must be done with every image
+*/
+/****************************************************************************/
+void VK::GpuCulling::ShutDown(VK::Device& device)
+{
+    if (!IsActive())
+        return;
+
+    mObjectSets.ShutDown(device);
+    mObjectPool.ShutDown(device);
+    mCullSets.ShutDown(device);
+    mCullPool.ShutDown(device);
+    mPipeline.ShutDown(device);
+    mScene.ShutDown(device);
+
+    if (Occlusion())
+    {
+        mLatePipeline.ShutDown(device);
+        mVisibility.ShutDown(device);
+    }
+
+    for (unsigned i = 0; i < mCullData.size(); ++i)
+    {
+        mCullData[i].UnMap(device);
+        mCounts[i].UnMap(device);
+
+        mCullData[i].ShutDown(device);
+        mDraws[i].ShutDown(device);
+        mCounts[i].ShutDown(device);
+    }
+
+    mCullData.clear();
+    mDraws.clear();
+    mCounts.clear();
+    mMappedCullData.clear();
+    mMappedCounts.clear();
+    mPyramid = nullptr;
+    mCapacity = 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write an image's changed objects and frustum, the image must not be in
+  flight. The dispatch is sized here so the recorded commands never change.
+
+\param changed
+  Indices of the objects that changed since the last Update
+*/
+/****************************************************************************/
+void VK::GpuCulling::Update(unsigned image, const glm::mat4& viewProj, const std::vector<GpuObject>& objects,
+    const std::vector<uint32_t>& changed)
+{
+    CullData& data = *mMappedCullData[image];
+    const Counters& counters = *mMappedCounts[image];
+    mStats.objects = data.objectCount;
+    mStats.frustumCulled = counters.frustumCulled;
+    mStats.occluded = counters.occluded;
+    mStats.earlyDraws = counters.earlyDraws;
+    mStats.lateDraws = counters.lateDraws;
+
+    mScene.Update(image, objects, changed);
+    mStats.uploaded = mScene.Uploaded();
+
+    uint32_t count = mScene.Count();
+
+    Frustum frustum = Frustum::FromMatrix(viewProj);
+    std::copy(frustum.planes, frustum.planes + 6, data.planes);
+    data.objectCount = count;
+    data.capacity = mCapacity;
+    data.viewProj = viewProj;
+    if (Occlusion())
+    {
+        data.mipCount = mPyramid->MipCount();
+        data.pyramidSize[0] = mPyramid->Extent().width;
+        data.pyramidSize[1] = mPyramid->Extent().height;
+    }
+    data.groups[0] = mPipeline.GroupCount(count);
+    data.groups[1] = 1;
+    data.groups[2] = 1;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record the cull, outside of any render pass and before Draw
+*/
+/****************************************************************************/
+void VK::GpuCulling::Cull(VK::CommandBuffer& commandBuffer, unsigned image)
+{
+    mScene.Upload(commandBuffer, image);
+
+    // start from no draws, the last user of the counts was this image's
+    // previous frame. The compute source also orders the visibility
+    // writes of the frame submitted before this one.
+    vkCmdFillBuffer(commandBuffer[image], mCounts[image].Get(), 0, sizeof(Counters), 0);
+    commandBuffer.Barrier(image, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    commandBuffer.BindComputePipeline(image, mPipeline);
+    commandBuffer.BindComputeDescriptorSet(image, mPipeline, { mCullSets.Get(image) });
+    commandBuffer.DispatchIndirect(image, mCullData[image].Get(), offsetof(CullData, groups));
+
+    // without occlusion the counts are final, so the host may read them
+    // once the fence is signaled
+    VkPipelineStageFlags stage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+    VkAccessFlags access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    if (Occlusion())
+    {
+        stage |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        access |= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    }
+    else
+    {
+        stage |= VK_PIPELINE_STAGE_HOST_BIT;
+        access |= VK_ACCESS_HOST_READ_BIT;
+    }
+    commandBuffer.Barrier(image, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, stage, access);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record the draws the cull wrote, with the graphics pipeline, vertex and
+  index buffers and ObjectSet already bound
+*/
+/****************************************************************************/
+void VK::GpuCulling::Draw(VK::CommandBuffer& commandBuffer, unsigned image)
+{
+    commandBuffer.DrawIndexedIndirectCount(image, mDraws[image].Get(), 0,
+        mCounts[image].Get(), offsetof(Counters, earlyDraws), mCapacity);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record the late phase, outside of any render pass, after the depth
+  pyramid is built from what Draw drew and before DrawLate
+*/
+/****************************************************************************/
+void VK::GpuCulling::CullLate(VK::CommandBuffer& commandBuffer, unsigned image)
+{
+    assert(Occlusion());
+
+    commandBuffer.BindComputePipeline(image, mLatePipeline);
+    commandBuffer.BindComputeDescriptorSet(image, mLatePipeline, { mCullSets.Get(image) });
+    commandBuffer.DispatchIndirect(image, mCullData[image].Get(), offsetof(CullData, groups));
+
+    commandBuffer.Barrier(image, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record the draws of the objects the late phase found newly visible,
+  bound the same way as for Draw
+*/
+/****************************************************************************/
+void VK::GpuCulling::DrawLate(VK::CommandBuffer& commandBuffer, unsigned image)
+{
+    assert(Occlusion());
+
+    commandBuffer.DrawIndexedIndirectCount(image, mDraws[image].Get(), sizeof(VkDrawIndexedIndirectCommand) * mCapacity,
+        mCounts[image].Get(), offsetof(Counters, lateDraws), mCapacity);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the bindings of the set the vertex shader reads objects through
+*/
+/****************************************************************************/
+std::vector<VkDescriptorSetLayoutBinding> VK::GpuCulling::ObjectBindings()
+{
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    return { binding };
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get an image's object set
+*/
+/****************************************************************************/
+VkDescriptorSet VK::GpuCulling::ObjectSet(unsigned image)
+{
+    return mObjectSets.Get(image);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get what the GPU did with the frame the last Update collected
+*/
+/****************************************************************************/
+const VK::GpuCullingStats& VK::GpuCulling::Stats() const
+{
+    return mStats;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the most objects an image holds
+*/
+/****************************************************************************/
+uint32_t VK::GpuCulling::Capacity() const
+{
+    return mCapacity;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Was the culling created
+*/
+/****************************************************************************/
+bool VK::GpuCulling::IsActive() const
+{
+    return mCapacity > 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Does the culling test against a depth pyramid
+*/
+/****************************************************************************/
+bool VK::GpuCulling::Occlusion() const
+{
+    return mPyramid != nullptr;
+}
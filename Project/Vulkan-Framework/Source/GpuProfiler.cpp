@@ -0,0 +1,347 @@
+/****************************************************************************/
+/*!
+\file
+   GpuProfiler.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Named GPU timestamp scopes with rolling times
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "GpuProfiler.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// the scope BeginFrame opens around the whole command buffer
+static const char* FrameScope = "Frame";
+
+// an open scope that was not timed
+static const uint32_t Dropped = ~0u;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  get the tick length and valid bits of the graphics queue's timestamps,
+  the clock is invalid if the queue has none
+*/
+/****************************************************************************/
+VK::TimestampClock VK::TimestampClock::FromDevice(VK::Device& device)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.GetPhysicalDevice(), &properties);
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device.GetPhysicalDevice(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device.GetPhysicalDevice(), &familyCount, families.data());
+
+    TimestampClock clock;
+    uint32_t validBits = families[device.GraphicsFamily()].timestampValidBits;
+    if (validBits == 0)
+        return clock;
+
+    clock.period = properties.limits.timestampPeriod;
+    clock.mask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+    return clock;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Can the queue's work be timed
+*/
+/****************************************************************************/
+bool VK::TimestampClock::IsValid() const
+{
+    return period > 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the milliseconds between two timestamps, across a wrap of the
+  valid bits
+*/
+/****************************************************************************/
+float VK::TimestampClock::Milliseconds(uint64_t begin, uint64_t end) const
+{
+    uint64_t ticks = ((end & mask) - (begin & mask)) & mask;
+    return float(double(ticks) * period / 1000000.0);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create the timestamp queries
+
+\param imageCount
+  Number of command buffers that get timed, each has its own queries
+
+\param maxScopes
+  Most scopes a command buffer can time, the frame scope included
+*/
+/****************************************************************************/
+void VK::GpuProfiler::Create(VK::Device& device, unsigned imageCount, uint32_t maxScopes)
+{
+    ShutDown(device);
+
+    // without timestamps every scope is left untimed
+    mClock = TimestampClock::FromDevice(device);
+    if (!mClock.IsValid())
+    {
+        DEBUG::log.Info("GpuProfiler::Create: the graphics queue has no timestamps, nothing is profiled!");
+        return;
+    }
+
+    mMaxScopes = std::max(maxScopes, 1u);
+    mImages.assign(imageCount, Image());
+    mResults.resize(size_t(mMaxScopes) * 2);
+
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = imageCount * mMaxScopes * 2;
+
+    if (vkCreateQueryPool(device.Get(), &poolInfo, nullptr, &mQueryPool) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("GpuProfiler::Create: failed to create query pool!");
+        throw std::runtime_error("failed to create query pool!");
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, the GPU must be done with every image. The stats are kept so
+  a recreated profiler carries on with them.
+*/
+/****************************************************************************/
+void VK::GpuProfiler::ShutDown(VK::Device& device)
+{
+    if (mQueryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(device.Get(), mQueryPool, nullptr);
+        mQueryPool = VK_NULL_HANDLE;
+    }
+
+    mImages.clear();
+    mResults.clear();
+    mMaxScopes = 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Reset an image's queries and open the frame scope, record first
+*/
+/****************************************************************************/
+void VK::GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, unsigned image)
+{
+    if (!IsActive())
+        return;
+
+    Image& state = mImages[image];
+    state.records.clear();
+    state.open.clear();
+
+    vkCmdResetQueryPool(commandBuffer, mQueryPool, image * mMaxScopes * 2, mMaxScopes * 2);
+    BeginScope(commandBuffer, image, FrameScope);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Close whatever is still open and the frame scope, record last
+*/
+/****************************************************************************/
+void VK::GpuProfiler::EndFrame(VkCommandBuffer commandBuffer, unsigned image)
+{
+    if (!IsActive())
+        return;
+
+    while (!mImages[image].open.empty())
+    {
+        EndScope(commandBuffer, image);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Open a scope, it times everything recorded until the matching EndScope
+*/
+/****************************************************************************/
+void VK::GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, unsigned image, const std::string& name)
+{
+    if (!IsActive())
+        return;
+
+    Image& state = mImages[image];
+    if (state.records.size() >= mMaxScopes)
+    {
+        state.open.push_back(Dropped);
+        return;
+    }
+
+    uint32_t record = uint32_t(state.records.size());
+    state.records.push_back(ScopeIndex(name, unsigned(state.open.size())));
+    state.open.push_back(record);
+
+    uint32_t query = (image * mMaxScopes + record) * 2;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mQueryPool, query);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Close the innermost open scope
+*/
+/****************************************************************************/
+void VK::GpuProfiler::EndScope(VkCommandBuffer commandBuffer, unsigned image)
+{
+    if (!IsActive())
+        return;
+
+    Image& state = mImages[image];
+    if (state.open.empty())
+    {
+        DEBUG::log.Error("GpuProfiler::EndScope: no scope is open!");
+        throw std::runtime_error("no scope is open!");
+    }
+
+    uint32_t record = state.open.back();
+    state.open.pop_back();
+    if (record == Dropped)
+        return;
+
+    uint32_t query = (image * mMaxScopes + record) * 2 + 1;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mQueryPool, query);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Read the times of the image's last submit into the scopes. Nothing is
+  read before its first submit.
+*/
+/****************************************************************************/
+bool VK::GpuProfiler::Update(VK::Device& device, unsigned image)
+{
+    if (!IsActive())
+        return false;
+
+    Image& state = mImages[image];
+    bool submitted = state.submitted;
+    state.submitted = true;
+    if (!submitted || state.records.empty())
+        return false;
+
+    uint32_t queryCount = uint32_t(state.records.size()) * 2;
+    if (vkGetQueryPoolResults(device.Get(), mQueryPool, image * mMaxScopes * 2, queryCount,
+        sizeof(uint64_t) * queryCount, mResults.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+        return false;
+
+    for (size_t record = 0; record < state.records.size(); ++record)
+    {
+        float ms = mClock.Milliseconds(mResults[record * 2], mResults[record * 2 + 1]);
+
+        uint32_t scope = state.records[record];
+        GpuScopeStats& stats = mScopes[scope];
+        std::vector<float>& samples = mSamples[scope];
+        samples[stats.samples % Window] = ms;
+        ++stats.samples;
+
+        uint32_t count = std::min(stats.samples, Window);
+        float sum = 0;
+        stats.minMs = samples[0];
+        stats.maxMs = samples[0];
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            sum += samples[i];
+            stats.minMs = std::min(stats.minMs, samples[i]);
+            stats.maxMs = std::max(stats.maxMs, samples[i]);
+        }
+        stats.avgMs = sum / float(count);
+        stats.lastMs = ms;
+    }
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the stats of every scope timed so far
+*/
+/****************************************************************************/
+const std::vector<VK::GpuScopeStats>& VK::GpuProfiler::Scopes() const
+{
+    return mScopes;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get a scope's stats by name, null if it was never recorded
+*/
+/****************************************************************************/
+const VK::GpuScopeStats* VK::GpuProfiler::Find(const std::string& name) const
+{
+    auto it = mScopeOf.find(name);
+    return it == mScopeOf.end() ? nullptr : &mScopes[it->second];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Does the profiler time anything
+*/
+/****************************************************************************/
+bool VK::GpuProfiler::IsActive() const
+{
+    return mQueryPool != VK_NULL_HANDLE;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  get the index of a scope by name, made on first use
+*/
+/****************************************************************************/
+uint32_t VK::GpuProfiler::ScopeIndex(const std::string& name, unsigned depth)
+{
+    auto it = mScopeOf.find(name);
+    if (it != mScopeOf.end())
+        return it->second;
+
+    uint32_t scope = uint32_t(mScopes.size());
+    mScopeOf.emplace(name, scope);
+
+    GpuScopeStats stats;
+    stats.name = name;
+    stats.depth = depth;
+    mScopes.push_back(stats);
+    mSamples.emplace_back(Window, 0.0f);
+    return scope;
+}
@@ -0,0 +1,265 @@
+/****************************************************************************/
+/*!
+\file
+   GpuScene.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Persistent GPU copy of the scene's objects, updated by deltas
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "GpuScene.hpp"
+#include "PipelineCache.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// bindings of SceneScatter.comp
+static const uint32_t ObjectBinding = 0;
+static const uint32_t UploadBinding = 1;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Copy a mesh's model space bounds into the object
+*/
+/****************************************************************************/
+void VK::GpuObject::SetBounds(const Bounds& bounds)
+{
+    sphere = glm::vec4(bounds.center, bounds.radius);
+    extents = glm::vec4(bounds.extents, 0);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Make the scene buffer, the upload buffers and the scatter pipeline
+
+\param imageCount
+  One upload buffer per image, the image's fence guards it
+
+\param capacity
+  Most objects the scene holds, more are left out
+*/
+/****************************************************************************/
+void VK::GpuScene::Create(VK::Device& device, VK::PipelineCache& cache, unsigned imageCount, uint32_t capacity)
+{
+    mCapacity = std::max(capacity, 1u);
+    mCount = 0;
+    mUploaded = 0;
+    mDirty.assign(mCapacity, 0);
+    mDirtyList.clear();
+    mDirtyList.reserve(mCapacity);
+
+    VK::ComputePipelineDesc desc;
+    desc.computePath = "../Resource/Shaders/SceneScatter.comp";
+    mPipeline.Create(device, cache, desc);
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = sizeof(GpuObject) * mCapacity;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    mObjects.Create(device, bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    // every object may change in one frame
+    VkDeviceSize uploadSize = sizeof(UploadHeader) + sizeof(UploadEntry) * mCapacity;
+    mUploads.resize(imageCount);
+    mMapped.resize(imageCount);
+
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings = mPipeline.SetBindings(0);
+    mPool.Create(device, bindings, imageCount);
+    mSets.Create(device, mPool, mPipeline.SetLayout(0), bindings, imageCount);
+
+    const VK::DescriptorTemplate& setTemplate = mSets.Template();
+    std::vector<VK::DescriptorInfo> descriptors(setTemplate.SlotCount());
+    descriptors[setTemplate.Slot(ObjectBinding)] = VK::DescriptorInfo::Buffer(mObjects.Get());
+
+    for (unsigned i = 0; i < imageCount; ++i)
+    {
+        bufferInfo.size = uploadSize;
+        bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        mUploads[i].Create(device, bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        void* data = nullptr;
+        mUploads[i].Map(device, uploadSize, &data);
+        mMapped[i] = static_cast<UploadHeader*>(data);
+        *mMapped[i] = { { 0, 1, 1 }, 0 };
+
+        descriptors[setTemplate.Slot(UploadBinding)] = VK::DescriptorInfo::Buffer(mUploads[i].Get());
+        mSets.Update(device, i, descriptors.data());
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, the GPU must be done with every image
+*/
+/****************************************************************************/
+void VK::GpuScene::ShutDown(VK::Device& device)
+{
+    if (!IsActive())
+        return;
+
+    mSets.ShutDown(device);
+    mPool.ShutDown(device);
+    mPipeline.ShutDown(device);
+    mObjects.ShutDown(device);
+
+    for (VK::Buffer& upload : mUploads)
+    {
+        upload.UnMap(device);
+        upload.ShutDown(device);
+    }
+
+    mUploads.clear();
+    mMapped.clear();
+    mDirty.clear();
+    mDirtyList.clear();
+    mCount = 0;
+    mCapacity = 0;
+    mUploaded = 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write the objects that changed into an image's upload buffer
+
+\param objects
+  Every object of the scene, those past the capacity are left out
+
+\param changed
+  Indices of the objects that changed since the last Update, may repeat
+*/
+/****************************************************************************/
+void VK::GpuScene::Update(unsigned image, const std::vector<GpuObject>& objects, const std::vector<uint32_t>& changed)
+{
+    uint32_t count = std::min(uint32_t(objects.size()), mCapacity);
+
+    auto mark = [this](uint32_t index)
+    {
+        if (!mDirty[index])
+        {
+            mDirty[index] = 1;
+            mDirtyList.push_back(index);
+        }
+    };
+
+    // the persistent buffer starts out empty, and a scene that changed
+    // size has most likely moved its objects around
+    if (count != mCount)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            mark(i);
+        mCount = count;
+    }
+    else
+    {
+        for (uint32_t index : changed)
+        {
+            if (index < count)
+                mark(index);
+        }
+    }
+
+    UploadHeader& header = *mMapped[image];
+    UploadEntry* uploads = reinterpret_cast<UploadEntry*>(&header + 1);
+    for (uint32_t i = 0; i < mDirtyList.size(); ++i)
+    {
+        uint32_t index = mDirtyList[i];
+        uploads[i].index = index;
+        uploads[i].object = objects[index];
+        mDirty[index] = 0;
+    }
+
+    mUploaded = uint32_t(mDirtyList.size());
+    mDirtyList.clear();
+
+    header.count = mUploaded;
+    header.groups[0] = mPipeline.GroupCount(mUploaded);
+    header.groups[1] = 1;
+    header.groups[2] = 1;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record the scatter of an image's uploads into the scene buffer
+*/
+/****************************************************************************/
+void VK::GpuScene::Upload(VK::CommandBuffer& commandBuffer, unsigned image)
+{
+    // earlier frames may still read the objects being replaced
+    commandBuffer.Barrier(image, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+    commandBuffer.BindComputePipeline(image, mPipeline);
+    commandBuffer.BindComputeDescriptorSet(image, mPipeline, { mSets.Get(image) });
+    commandBuffer.DispatchIndirect(image, mUploads[image].Get(), 0);
+
+    commandBuffer.Barrier(image, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the scene buffer, GpuObject.glsl objects
+*/
+/****************************************************************************/
+VkBuffer VK::GpuScene::Objects() const
+{
+    return mObjects.Get();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of objects in the scene buffer
+*/
+/****************************************************************************/
+uint32_t VK::GpuScene::Count() const
+{
+    return mCount;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of objects the last Update sent
+*/
+/****************************************************************************/
+uint32_t VK::GpuScene::Uploaded() const
+{
+    return mUploaded;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Was the scene created
+*/
+/****************************************************************************/
+bool VK::GpuScene::IsActive() const
+{
+    return mCapacity > 0;
+}
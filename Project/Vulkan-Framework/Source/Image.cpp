@@ -23,6 +23,69 @@
 || -------------------------- STATIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
 
+/****************************************************************************/
+/*!
+\brief
+  Get the pipeline stages and accesses that use an image in a given layout,
+  used as either side of a barrier
+
+\param layout
+  The image layout
+*/
+/****************************************************************************/
+VK::LayoutUsage VK::GetLayoutUsage(VkImageLayout layout)
+{
+    switch (layout)
+    {
+    case VK_IMAGE_LAYOUT_UNDEFINED:
+    case VK_IMAGE_LAYOUT_PREINITIALIZED:
+        return { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0 };
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+        return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+        return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+        return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT };
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT };
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+        return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 };
+    default:
+        return { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT };
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the aspects a view or barrier of this format covers
+*/
+/****************************************************************************/
+VkImageAspectFlags VK::GetFormatAspect(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_S8_UINT:
+        return VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
 /*============================================================================*\
 || -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
@@ -115,8 +178,6 @@ void VK::Image::ShutDown(VK::Device& device)
 /****************************************************************************/
 void VK::Image::TransitionImageLayout(VK::Device& device, VK::CommandPool& commandPool, VkQueue& graphicsQueue, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
 {
-    UNUSED(format);
-
     VkCommandBuffer commandBuffer = VK::BeginSingleTimeCommands(device, commandPool);
 
     VkImageMemoryBarrier barrier = {};
@@ -126,38 +187,32 @@ void VK::Image::TransitionImageLayout(VK::Device& device, VK::CommandPool& comma
     barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.image = mImage;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.aspectMask = VK::GetFormatAspect(format);
     barrier.subresourceRange.baseMipLevel = 0;
     barrier.subresourceRange.levelCount = 1;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && (newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL || newLayout == VK_IMAGE_LAYOUT_GENERAL))
+    if (newLayout == VK_IMAGE_LAYOUT_UNDEFINED || newLayout == VK_IMAGE_LAYOUT_PREINITIALIZED)
     {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        DEBUG::log.Error("Image::TransitionImageLayout: ", "unsupported layout transition!");
+        throw std::invalid_argument("unsupported layout transition!");
     }
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-    {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
-    else
+    // the old layout says what has to finish, the new one what has to wait
+    VK::LayoutUsage source = VK::GetLayoutUsage(oldLayout);
+    VK::LayoutUsage destination = VK::GetLayoutUsage(newLayout);
+
+    // GENERAL right after creation is only ever filled by a copy
+    if (newLayout == VK_IMAGE_LAYOUT_GENERAL && oldLayout == VK_IMAGE_LAYOUT_UNDEFINED)
     {
-        DEBUG::log.Error("Image::TransitionImageLayout: ", "unsupported layout transition!");
-        throw std::invalid_argument("unsupported layout transition!");
+        destination = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT };
     }
 
-    vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    barrier.srcAccessMask = source.access;
+    barrier.dstAccessMask = destination.access;
+
+    vkCmdPipelineBarrier(commandBuffer, source.stage, destination.stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
     VK::EndSingleTimeCommands(device, commandPool, graphicsQueue, commandBuffer);
 }
@@ -14,6 +14,7 @@
 #include "VULKANPCH.hpp"
 #include "Instance.hpp"
 #include "DebugMessenger.hpp"
+#include <cstring>
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -31,9 +32,12 @@
 /*!
 \brief
   Generate a new vulkan instance
+
+\param headless
+  Skip the window system / surface extensions
 */
 /****************************************************************************/
-void VK::Instance::Create()
+void VK::Instance::Create(bool headless)
 {
     if (mInstance != VK_NULL_HANDLE)
     {
@@ -74,12 +78,16 @@ void VK::Instance::Create()
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
+    if (!headless)
+    {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
-    extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+    }
     extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 
     if (mEnableValidationLayers)
@@ -0,0 +1,158 @@
+/****************************************************************************/
+/*!
+\file
+   InstanceBuffer.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Per image world matrices of instanced draws
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "InstanceBuffer.hpp"
+#include "PipelineCache.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Make and map the buffers
+
+\param imageCount
+  One buffer per image, the image's fence guards it
+
+\param capacity
+  Most matrices an image can hold
+*/
+/****************************************************************************/
+void VK::InstanceBuffer::Create(VK::Device& device, VK::PipelineCache& cache, unsigned imageCount, uint32_t capacity)
+{
+    mCapacity = std::max(capacity, 1u);
+    mBuffers.resize(imageCount);
+    mMapped.resize(imageCount);
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings = Bindings();
+    mPool.Create(device, bindings, imageCount);
+    mSets.Create(device, mPool, cache.GetSetLayout(device, bindings), bindings, imageCount);
+
+    for (unsigned i = 0; i < imageCount; ++i)
+    {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = sizeof(glm::mat4) * mCapacity;
+        bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        mBuffers[i].Create(device, bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        void* data = nullptr;
+        mBuffers[i].Map(device, sizeof(glm::mat4) * mCapacity, &data);
+        mMapped[i] = static_cast<glm::mat4*>(data);
+
+        VK::DescriptorInfo descriptor = VK::DescriptorInfo::Buffer(mBuffers[i].Get());
+        mSets.Update(device, i, &descriptor);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, the GPU must be done with every image
+*/
+/****************************************************************************/
+void VK::InstanceBuffer::ShutDown(VK::Device& device)
+{
+    if (!IsActive())
+        return;
+
+    mSets.ShutDown(device);
+    mPool.ShutDown(device);
+
+    for (VK::Buffer& buffer : mBuffers)
+    {
+        buffer.UnMap(device);
+        buffer.ShutDown(device);
+    }
+
+    mBuffers.clear();
+    mMapped.clear();
+    mCapacity = 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Copy the matrices an image's next submit draws with
+*/
+/****************************************************************************/
+void VK::InstanceBuffer::Update(unsigned image, const std::vector<glm::mat4>& worlds)
+{
+    uint32_t count = std::min(uint32_t(worlds.size()), mCapacity);
+    std::copy(worlds.begin(), worlds.begin() + count, mMapped[image]);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the bindings of the set the vertex shader reads the matrices through
+*/
+/****************************************************************************/
+std::vector<VkDescriptorSetLayoutBinding> VK::InstanceBuffer::Bindings()
+{
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    return { binding };
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get an image's instance set
+*/
+/****************************************************************************/
+VkDescriptorSet VK::InstanceBuffer::Set(unsigned image)
+{
+    return mSets.Get(image);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the most matrices an image holds
+*/
+/****************************************************************************/
+uint32_t VK::InstanceBuffer::Capacity() const
+{
+    return mCapacity;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Was the buffer created
+*/
+/****************************************************************************/
+bool VK::InstanceBuffer::IsActive() const
+{
+    return mCapacity > 0;
+}
@@ -0,0 +1,168 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "JobPool.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Start the workers
+
+\param workerCount
+  Threads besides the caller, 0 uses one less than the core count
+*/
+/****************************************************************************/
+void VK::JobPool::Create(unsigned workerCount)
+{
+    if (workerCount == 0)
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    mStopping = false;
+    for (unsigned i = 0; i < workerCount; ++i)
+        mWorkers.emplace_back(&VK::JobPool::WorkerLoop, this);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, waits for the workers to leave
+*/
+/****************************************************************************/
+void VK::JobPool::ShutDown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+
+    for (std::thread& worker : mWorkers)
+        worker.join();
+    mWorkers.clear();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Run body over [0, count) in chunks of grain and wait for all of them.
+  Small ranges, and pools without workers, run on the calling thread.
+*/
+/****************************************************************************/
+void VK::JobPool::For(uint32_t count, uint32_t grain, const RangeFunc& body)
+{
+    grain = std::max(grain, 1u);
+    if (mWorkers.empty() || count <= grain)
+    {
+        if (count > 0)
+            body(0, count);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        // a worker that woke late for the last loop may still be leaving it
+        mDone.wait(lock, [this]() { return mActive == 0; });
+
+        mBody = &body;
+        mCount = count;
+        mGrain = grain;
+        mNext = 0;
+        ++mGeneration;
+    }
+    mWake.notify_all();
+
+    RunChunks(body, count, grain);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this]() { return mActive == 0; });
+    mBody = nullptr;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of threads besides the caller
+*/
+/****************************************************************************/
+unsigned VK::JobPool::WorkerCount() const
+{
+    return unsigned(mWorkers.size());
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Join every loop For starts until the pool shuts down
+*/
+/****************************************************************************/
+void VK::JobPool::WorkerLoop()
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (;;)
+    {
+        mWake.wait(lock, [this, seen]() { return mStopping || (mGeneration != seen && mBody); });
+        if (mStopping)
+            return;
+
+        seen = mGeneration;
+        const RangeFunc* body = mBody;
+        uint32_t count = mCount;
+        uint32_t grain = mGrain;
+        ++mActive;
+
+        lock.unlock();
+        RunChunks(*body, count, grain);
+        lock.lock();
+
+        if (--mActive == 0)
+            mDone.notify_all();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Take chunks until the range is used up
+*/
+/****************************************************************************/
+void VK::JobPool::RunChunks(const RangeFunc& body, uint32_t count, uint32_t grain)
+{
+    for (;;)
+    {
+        uint32_t begin = mNext.fetch_add(grain);
+        if (begin >= count)
+            return;
+
+        body(begin, std::min(begin + grain, count));
+    }
+}
@@ -18,6 +18,11 @@
 
 #include "VULKANPCH.hpp"
 #include "Engine.hpp"
+#include "Benchmark.hpp"
+#include "Culling.hpp"
+#include <cctype>
+#include <chrono>
+#include <random>
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -27,28 +32,172 @@
 || -------------------------- STATIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
 
+/****************************************************************************/
+/*!
+\brief
+  Average milliseconds one cull of a list takes
+*/
+/****************************************************************************/
+static double TimeCull(VK::JobPool& jobs, const VK::Frustum& frustum, const VK::CullList& list, std::vector<uint32_t>& visible)
+{
+    using Clock = std::chrono::steady_clock;
+    const unsigned iterations = 20;
+
+    VK::FrustumCuller culler;
+    culler.Cull(jobs, frustum, list, visible);
+
+    Clock::time_point start = Clock::now();
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        culler.Cull(jobs, frustum, list, visible);
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Cull 10k, 100k and 1M objects scattered around the camera, on one
+  thread and across the job pool
+*/
+/****************************************************************************/
+static void CullBenchmark()
+{
+    VK::JobPool single;
+    VK::JobPool pool;
+    pool.Create();
+
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 250.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+    VK::Frustum frustum = VK::Frustum::FromMatrix(proj * view);
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-250.0f, 250.0f);
+    std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+    std::cout << "objects, visible, 1 thread ms, " << pool.WorkerCount() + 1 << " threads ms" << std::endl;
+    for (uint32_t count : { 10000u, 100000u, 1000000u })
+    {
+        VK::CullList list;
+        list.Resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            glm::vec3 center(position(random), position(random), position(random));
+            glm::vec3 extents(size(random), size(random), size(random));
+            list.Set(i, VK::Bounds::FromPoints(center - extents, center + extents));
+        }
+
+        std::vector<uint32_t> visible;
+        double singleMs = TimeCull(single, frustum, list, visible);
+        double poolMs = TimeCull(pool, frustum, list, visible);
+
+        std::cout << count << ", " << visible.size() << ", " << singleMs << ", " << poolMs << std::endl;
+    }
+
+    pool.ShutDown();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Run the headless benchmark scenarios and write their results
+
+\param args
+  [scenario] [--frames N] [--size W H] [--gpu-culling] [--out path]
+*/
+/****************************************************************************/
+static int Benchmark(const std::vector<std::string>& args)
+{
+    VK::BenchmarkDesc desc;
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        if (args[i] == "--frames" && i + 1 < args.size())
+        {
+            desc.frames = unsigned(std::stoul(args[++i]));
+        }
+        else if (args[i] == "--size" && i + 2 < args.size())
+        {
+            desc.width = std::stoi(args[++i]);
+            desc.height = std::stoi(args[++i]);
+        }
+        else if (args[i] == "--gpu-culling")
+        {
+            desc.gpuCulling = true;
+        }
+        else if (args[i] == "--out" && i + 1 < args.size())
+        {
+            desc.outputPath = args[++i];
+        }
+        else
+        {
+            desc.scenario = args[i];
+        }
+    }
+
+    VK::Benchmark benchmark;
+    try
+    {
+        if (!benchmark.Run(desc))
+            return EXIT_FAILURE;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        DEBUG::log.Error(e.what());
+        return EXIT_FAILURE;
+    }
+
+    return benchmark.WriteJson(desc.outputPath) ? 0 : EXIT_FAILURE;
+}
+
 /*============================================================================*\
 || -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
 
-int main(char** argv, int argc)
+int main(int argc, char** argv)
 {
-    UNUSED(argv);
-    UNUSED(argc);
+    // --headless [frames] renders offscreen without a window
+    // --bench-cull times frustum culling and exits
+    // --bench [scenario] [options] runs the headless benchmark and exits
+    VK::RendererConfig config;
+    unsigned frameCount = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--headless")
+        {
+            config.headless = true;
+            frameCount = 1000;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+            {
+                frameCount = unsigned(std::stoul(argv[++i]));
+            }
+        }
+        else if (std::string(argv[i]) == "--bench-cull")
+        {
+            CullBenchmark();
+            return 0;
+        }
+        else if (std::string(argv[i]) == "--bench")
+        {
+            return Benchmark(std::vector<std::string>(argv + i + 1, argv + argc));
+        }
+    }
 
-    VK::Engine engine;
+    VK::Engine engine(config);
     engine.Init();
 
     try
     {
-        engine.Run();
+        engine.Run(frameCount);
     }
     catch (const std::exception& e)
     {
         // should be handled better
         std::cerr << e.what() << std::endl;
         DEBUG::log.Error(e.what());
+#ifdef _WIN32
         __debugbreak();
+#endif
         return EXIT_FAILURE;
     }
 
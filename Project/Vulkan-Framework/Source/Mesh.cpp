@@ -13,6 +13,7 @@
 
 #include "VULKANPCH.hpp"
 #include "Mesh.hpp"
+#include "CpuProfiler.hpp"
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -22,6 +23,39 @@
 || -------------------------- STATIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
 
+/****************************************************************************/
+/*!
+\brief
+  Box around the vertices as they are drawn, with the sphere shrunk to the
+  furthest vertex from the box center
+*/
+/****************************************************************************/
+static VK::Bounds ComputeBounds(const std::vector<VK::Vertex>& vertices)
+{
+    if (vertices.empty())
+        return VK::Bounds();
+
+    glm::vec3 min = glm::vec3(vertices[0].pos);
+    glm::vec3 max = min;
+    for (const VK::Vertex& vertex : vertices)
+    {
+        min = glm::min(min, glm::vec3(vertex.pos));
+        max = glm::max(max, glm::vec3(vertex.pos));
+    }
+
+    VK::Bounds bounds = VK::Bounds::FromPoints(min, max);
+
+    float radius = 0;
+    for (const VK::Vertex& vertex : vertices)
+        radius = std::max(radius, glm::length(glm::vec3(vertex.pos) - bounds.center));
+    bounds.radius = radius;
+
+    // the vertex shaders mirror y
+    bounds.center.y = -bounds.center.y;
+
+    return bounds;
+}
+
 /*============================================================================*\
 || -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
@@ -34,6 +68,8 @@
 /****************************************************************************/
 void VK::Mesh::Create(VK::Device& device, VK::CommandPool commandPool, VkQueue graphicsQ, std::string path)
 {
+    VK_PROFILE_SCOPE("Mesh::Create");
+
     /* read file via ASSIMP */
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
@@ -50,6 +86,7 @@ void VK::Mesh::Create(VK::Device& device, VK::CommandPool commandPool, VkQueue g
         aiMesh* mesh = scene->mMeshes[i];
         GetMesh(mesh);
     }
+    mBounds = ComputeBounds(mVertices);
 
     /* set up shader interface */
     mBindingDescription[0].binding = 0;
@@ -155,6 +192,17 @@ uint32_t VK::Mesh::IndexCount() const
     return uint32_t(mIndices.size());
 }
 
+/****************************************************************************/
+/*!
+\brief
+  get the bounds in model space, for culling
+*/
+/****************************************************************************/
+const VK::Bounds& VK::Mesh::LocalBounds() const
+{
+    return mBounds;
+}
+
 /****************************************************************************/
 /*!
 \brief
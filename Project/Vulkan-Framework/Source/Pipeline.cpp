@@ -13,6 +13,10 @@
 
 #include "VULKANPCH.hpp"
 #include "Pipeline.hpp"
+#include "PipelineCache.hpp"
+#include "Hash.hpp"
+#include "CpuProfiler.hpp"
+#include <cstring>
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -25,28 +29,25 @@
 /****************************************************************************/
 /*!
 \brief
-  read in a files data
+  compare two descriptor bindings, the immutable sampler pointer is ignored
 */
 /****************************************************************************/
-static std::vector<char> readFile(const std::string& filename)
+static bool SameBinding(const VkDescriptorSetLayoutBinding& lhs, const VkDescriptorSetLayoutBinding& rhs)
 {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open())
-    {
-        DEBUG::log.Error("readFile: failed to open file!");
-        throw std::runtime_error("failed to open file!");
-    }
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-
-    file.close();
+    return lhs.binding == rhs.binding && lhs.descriptorType == rhs.descriptorType &&
+        lhs.descriptorCount == rhs.descriptorCount && lhs.stageFlags == rhs.stageFlags;
+}
 
-    return buffer;
+/****************************************************************************/
+/*!
+\brief
+  compare two lists of plain Vulkan structs
+*/
+/****************************************************************************/
+template <typename T>
+static bool SameBytes(const std::vector<T>& lhs, const std::vector<T>& rhs)
+{
+    return lhs.size() == rhs.size() && (lhs.empty() || std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(T)) == 0);
 }
 
 /*============================================================================*\
@@ -56,222 +57,317 @@ static std::vector<char> readFile(const std::string& filename)
 /****************************************************************************/
 /*!
 \brief
-  Create a new pipeline
+  Set a constant in a list sorted by id, replacing an earlier value for
+  the id
+*/
+/****************************************************************************/
+void VK::SetSpecialization(std::vector<SpecializationConstant>& specialization, uint32_t id, uint32_t value)
+{
+    auto at = std::lower_bound(specialization.begin(), specialization.end(), id,
+        [](const SpecializationConstant& constant, uint32_t key) { return constant.id < key; });
+
+    if (at != specialization.end() && at->id == id)
+        at->value = value;
+    else
+        specialization.insert(at, { id, value });
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Mix the resources a pipeline layout is made from into a hash
 */
 /****************************************************************************/
-void VK::PipeLine::Create(VK::Device& device, VK::RenderPass& renderPass, VK::SwapChain& swapChain, VK::Mesh mesh,
-    std::vector<VkDescriptorSetLayout> uniformBuffer, std::string vertexPath, std::string fragmentPath, unsigned colorAttachCount,
-    VkCullModeFlags cullMode, bool depthTest, bool depthWrite, VkPolygonMode polyMode)
+void VK::HashLayout(uint64_t& hash, const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& setLayouts,
+    const std::vector<VkPushConstantRange>& pushConstants)
 {
-    if (mPipeline != VK_NULL_HANDLE)
-        ShutDown(device);
-
-    // load shaders
-    std::vector<char>  vertShaderCode = readFile(vertexPath.c_str());
-    std::vector<char>  fragShaderCode = readFile(fragmentPath.c_str());
-
-    VkShaderModule vertShaderModule = CreateShaderModule(vertShaderCode, device);
-    VkShaderModule fragShaderModule = CreateShaderModule(fragShaderCode, device);
-
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
-
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
-
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    auto bindingDescription = mesh.BindingDescription();
-    auto attributeDescriptions = mesh.AttributeDescription();
-    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescription.size());
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = bindingDescription.data();
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-    // build the rest of the pipelne
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-    VkExtent2D extent = swapChain.Extent();
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)extent.width;
-    viewport.height = (float)extent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor = {};
-    scissor.offset = { 0, 0 };
-    scissor.extent = extent;
-
-    VkPipelineViewportStateCreateInfo viewportState = {};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer = {};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = polyMode;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = cullMode;
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-
-    VkPipelineMultisampleStateCreateInfo multisampling = {};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-
-    std::vector<VkPipelineColorBlendAttachmentState> cBlendAttach;
-    for (unsigned i = 0; i < colorAttachCount; ++i)
-        cBlendAttach.push_back(colorBlendAttachment);
-
-    VkPipelineColorBlendStateCreateInfo colorBlending = {};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = colorAttachCount;
-    colorBlending.pAttachments = cBlendAttach.data();
-    colorBlending.blendConstants[0] = 0.0f;
-    colorBlending.blendConstants[1] = 0.0f;
-    colorBlending.blendConstants[2] = 0.0f;
-    colorBlending.blendConstants[3] = 0.0f;
-
-    // make pipeline layout
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = uint32_t(uniformBuffer.size());
-    pipelineLayoutInfo.pSetLayouts = uniformBuffer.data();
-
-    if (vkCreatePipelineLayout(device.Get(), &pipelineLayoutInfo, nullptr, &mLayout) != VK_SUCCESS)
+    HashValue(hash, uint64_t(setLayouts.size()));
+    for (const std::vector<VkDescriptorSetLayoutBinding>& set : setLayouts)
     {
-        DEBUG::log.Error("PipeLine::Create: failed to create pipeline layout!");
-        throw std::runtime_error("failed to create pipeline layout!");
+        HashValue(hash, uint64_t(set.size()));
+        for (const VkDescriptorSetLayoutBinding& binding : set)
+        {
+            HashValue(hash, binding.binding);
+            HashValue(hash, binding.descriptorType);
+            HashValue(hash, binding.descriptorCount);
+            HashValue(hash, binding.stageFlags);
+        }
     }
+    HashVector(hash, pushConstants);
+}
 
-    // make pipeline
-    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
-    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = depthTest;
-    depthStencil.depthWriteEnable = depthWrite;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencil.depthBoundsTestEnable = VK_FALSE;
-    depthStencil.minDepthBounds = 0.0f;
-    depthStencil.maxDepthBounds = 1.0f;
-    depthStencil.stencilTestEnable = VK_FALSE;
-    depthStencil.front = {}; // Optional
-    depthStencil.back = {}; // Optional
-
-    VkGraphicsPipelineCreateInfo pipelineInfo = {};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.layout = mLayout;
-    pipelineInfo.renderPass = renderPass.Get();
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-    pipelineInfo.pDepthStencilState = &depthStencil;
-    if (vkCreateGraphicsPipelines(device.Get(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mPipeline) != VK_SUCCESS)
+/****************************************************************************/
+/*!
+\brief
+  Compare the resources two pipeline layouts are made from
+*/
+/****************************************************************************/
+bool VK::SameLayout(const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& lhsSets, const std::vector<VkPushConstantRange>& lhsPush,
+    const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& rhsSets, const std::vector<VkPushConstantRange>& rhsPush)
+{
+    if (lhsSets.size() != rhsSets.size())
+        return false;
+
+    for (size_t i = 0; i < lhsSets.size(); ++i)
     {
-        DEBUG::log.Error("PipeLine::Create: failed to create graphics pipeline!");
-        throw std::runtime_error("failed to create graphics pipeline!");
+        if (lhsSets[i].size() != rhsSets[i].size())
+            return false;
+
+        for (size_t j = 0; j < lhsSets[i].size(); ++j)
+        {
+            if (!SameBinding(lhsSets[i][j], rhsSets[i][j]))
+                return false;
+        }
     }
 
-    // cleanup
-    vkDestroyShaderModule(device.Get(), fragShaderModule, nullptr);
-    vkDestroyShaderModule(device.Get(), vertShaderModule, nullptr);
+    return SameBytes(lhsPush, rhsPush);
 }
 
 /****************************************************************************/
 /*!
 \brief
-  cleanup
+  Set a specialization constant, replacing an earlier value for the id
 */
 /****************************************************************************/
-void VK::PipeLine::ShutDown(VK::Device& device)
+void VK::PipelineDesc::Specialize(uint32_t id, uint32_t value)
 {
-    vkDestroyPipeline(device.Get(), mPipeline, nullptr);
-    vkDestroyPipelineLayout(device.Get(), mLayout, nullptr);
-    mPipeline = VK_NULL_HANDLE;
+    SetSpecialization(specialization, id, value);
 }
 
 /****************************************************************************/
 /*!
 \brief
-  get the pipeline
+  Set an int specialization constant
 */
 /****************************************************************************/
-VkPipeline VK::PipeLine::Get() const
+void VK::PipelineDesc::Specialize(uint32_t id, int32_t value)
 {
-    return mPipeline;
+    Specialize(id, static_cast<uint32_t>(value));
 }
 
 /****************************************************************************/
 /*!
 \brief
-  get a pointer to the pipeline
+  Set a float specialization constant
 */
 /****************************************************************************/
-VkPipeline* VK::PipeLine::GetPointerTo()
+void VK::PipelineDesc::Specialize(uint32_t id, float value)
 {
-    return &mPipeline;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    Specialize(id, bits);
 }
 
 /****************************************************************************/
 /*!
 \brief
-  get the pipeline layout
+  Set a bool specialization constant, bools are 32 bit in SPIR-V
 */
 /****************************************************************************/
-VkPipelineLayout VK::PipeLine::Layout() const
+void VK::PipelineDesc::Specialize(uint32_t id, bool value)
 {
-    return mLayout;
+    Specialize(id, uint32_t(value ? VK_TRUE : VK_FALSE));
 }
 
 /****************************************************************************/
 /*!
 \brief
-  create a shader
+  Hash everything that changes the compiled pipeline. The render pass
+  handle is left out, its formats stand in for it.
 */
 /****************************************************************************/
-VkShaderModule VK::PipeLine::CreateShaderModule(const std::vector<char>& code, VK::Device device)
+uint64_t VK::PipelineDesc::Hash() const
 {
-    VkShaderModuleCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    uint64_t hash = HashOffset;
 
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device.Get(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    HashString(hash, vertexPath);
+    HashString(hash, fragmentPath);
+    HashValue(hash, uint64_t(defines.size()));
+    for (const ShaderDefine& define : defines)
     {
-        DEBUG::log.Error("PipeLine::CreateShaderModule: failed to create shader module!");
-        throw std::runtime_error("failed to create shader module!");
+        HashString(hash, define.name);
+        HashString(hash, define.value);
     }
 
-    return shaderModule;
-}
\ No newline at end of file
+    HashVector(hash, specialization);
+    HashVector(hash, vertexBindings);
+    HashVector(hash, vertexAttributes);
+    HashValue(hash, topology);
+
+    HashLayout(hash, setLayouts, pushConstants);
+
+    HashValue(hash, cullMode);
+    HashValue(hash, polyMode);
+    HashValue(hash, frontFace);
+    HashValue(hash, samples);
+
+    HashValue(hash, uint8_t(depthTest));
+    HashValue(hash, uint8_t(depthWrite));
+    HashValue(hash, depthCompare);
+    HashValue(hash, uint8_t(blend));
+
+    HashVector(hash, colorFormats);
+    HashValue(hash, depthFormat);
+    HashValue(hash, subpass);
+
+    return hash;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compare everything that goes into the hash
+*/
+/****************************************************************************/
+bool VK::PipelineDesc::operator==(const PipelineDesc& rhs) const
+{
+    return vertexPath == rhs.vertexPath && fragmentPath == rhs.fragmentPath && defines == rhs.defines && specialization == rhs.specialization &&
+        SameBytes(vertexBindings, rhs.vertexBindings) && SameBytes(vertexAttributes, rhs.vertexAttributes) &&
+        topology == rhs.topology && SameLayout(setLayouts, pushConstants, rhs.setLayouts, rhs.pushConstants) &&
+        cullMode == rhs.cullMode && polyMode == rhs.polyMode && frontFace == rhs.frontFace && samples == rhs.samples &&
+        depthTest == rhs.depthTest && depthWrite == rhs.depthWrite && depthCompare == rhs.depthCompare &&
+        blend == rhs.blend && colorFormats == rhs.colorFormats && depthFormat == rhs.depthFormat && subpass == rhs.subpass;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the pipeline for a description, it is only compiled the first time
+  the cache sees the description
+*/
+/****************************************************************************/
+void VK::PipeLine::Create(VK::Device& device, VK::PipelineCache& cache, const PipelineDesc& desc)
+{
+    VK_PROFILE_SCOPE("PipeLine::Create");
+
+    VK::PipelineCache::Entry entry = cache.GetPipeline(device, desc);
+
+    mPipeline = entry.pipeline;
+    mLayout = entry.layout;
+    mFallback = nullptr;
+    mReady = true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the pipeline for a description without blocking, a new description
+  is compiled in the background. Call Update every frame until it is ready.
+
+\param fallback
+  Drawn with meanwhile, it must take the same descriptor sets. Without one
+  Get returns VK_NULL_HANDLE and the draw should be skipped.
+*/
+/****************************************************************************/
+void VK::PipeLine::CreateAsync(VK::Device& device, VK::PipelineCache& cache, const PipelineDesc& desc, const VK::PipeLine* fallback)
+{
+    VK_PROFILE_SCOPE("PipeLine::CreateAsync");
+
+    mSeenCompleted = cache.CompletedCount();
+    VK::PipelineCache::Entry entry = cache.RequestPipeline(device, desc);
+
+    mPipeline = entry.pipeline;
+    mLayout = entry.layout;
+    mFallback = fallback;
+    mReady = entry.pipeline != VK_NULL_HANDLE;
+
+    if (!mReady)
+        mDesc = desc;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, the cache keeps the pipeline alive for the next user
+*/
+/****************************************************************************/
+void VK::PipeLine::ShutDown(VK::Device&)
+{
+    mPipeline = VK_NULL_HANDLE;
+    mLayout = VK_NULL_HANDLE;
+    mFallback = nullptr;
+    mReady = false;
+    mDesc = PipelineDesc();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Pick up a finished background compile, only looks the description up
+  when the cache finished something since the last call. Throws if the
+  compile failed.
+
+\return
+  True when the pipeline changed and recorded commands are stale
+*/
+/****************************************************************************/
+bool VK::PipeLine::Update(VK::Device& device, VK::PipelineCache& cache)
+{
+    if (mReady)
+        return false;
+
+    uint64_t completed = cache.CompletedCount();
+    if (completed == mSeenCompleted)
+        return false;
+    mSeenCompleted = completed;
+
+    VK::PipelineCache::Entry entry = cache.RequestPipeline(device, mDesc);
+    if (entry.pipeline == VK_NULL_HANDLE)
+        return false;
+
+    mPipeline = entry.pipeline;
+    mLayout = entry.layout;
+    mReady = true;
+    mDesc = PipelineDesc();
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Is the real pipeline compiled
+*/
+/****************************************************************************/
+bool VK::PipeLine::IsReady() const
+{
+    return mReady;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the pipeline
+*/
+/****************************************************************************/
+VkPipeline VK::PipeLine::Get() const
+{
+    if (!mReady && mFallback)
+        return mFallback->Get();
+
+    return mPipeline;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get a pointer to the pipeline
+*/
+/****************************************************************************/
+VkPipeline* VK::PipeLine::GetPointerTo()
+{
+    return &mPipeline;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the layout of the pipeline Get returns
+*/
+/****************************************************************************/
+VkPipelineLayout VK::PipeLine::Layout() const
+{
+    if (!mReady && mFallback)
+        return mFallback->Layout();
+
+    return mLayout;
+}
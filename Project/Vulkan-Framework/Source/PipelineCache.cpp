@@ -0,0 +1,845 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "PipelineCache.hpp"
+#include "Image.hpp"
+#include <chrono>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// specialization data that has to live until the pipeline is created
+struct SpecializationData
+{
+    std::vector<VkSpecializationMapEntry> mapEntries;
+    std::vector<uint32_t> constants;
+    VkSpecializationInfo info = {};
+};
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  milliseconds since a point in time
+*/
+/****************************************************************************/
+static float MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  a readable name for a pipeline in the compile times
+*/
+/****************************************************************************/
+static std::string PipelineName(const VK::PipelineDesc& desc)
+{
+    return desc.vertexPath + " | " + desc.fragmentPath;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  append the parts of a binding list that define a set layout to a key
+*/
+/****************************************************************************/
+static void AppendBindings(std::vector<uint32_t>& key, const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    key.push_back(uint32_t(bindings.size()));
+    for (const VkDescriptorSetLayoutBinding& binding : bindings)
+    {
+        key.push_back(binding.binding);
+        key.push_back(uint32_t(binding.descriptorType));
+        key.push_back(binding.descriptorCount);
+        key.push_back(binding.stageFlags);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Lay specialization constants out one per word, the same data goes to
+  every stage
+
+\return
+  The info to give the stages, nullptr without constants
+*/
+/****************************************************************************/
+static const VkSpecializationInfo* BuildSpecialization(SpecializationData& data, const std::vector<VK::SpecializationConstant>& specialization,
+    const VK::ShaderReflection& reflection, const std::string& name)
+{
+    const std::vector<uint32_t>& declared = reflection.SpecializationIds();
+    for (const VK::SpecializationConstant& constant : specialization)
+    {
+        if (std::find(declared.begin(), declared.end(), constant.id) == declared.end())
+            DEBUG::log.Info("PipelineCache: no stage of", name, "declares constant_id", constant.id);
+
+        data.mapEntries.push_back({ constant.id, uint32_t(data.constants.size() * sizeof(uint32_t)), sizeof(uint32_t) });
+        data.constants.push_back(constant.value);
+    }
+
+    data.info.mapEntryCount = uint32_t(data.mapEntries.size());
+    data.info.pMapEntries = data.mapEntries.data();
+    data.info.dataSize = data.constants.size() * sizeof(uint32_t);
+    data.info.pData = data.constants.data();
+
+    return data.constants.empty() ? nullptr : &data.info;
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Create the driver side cache all pipelines are compiled through and
+  start the compile workers
+
+\param shaderCacheDirectory
+  Where compiled GLSL is kept between runs
+
+\param workerCount
+  Number of background compile threads, 0 picks one from the core count
+*/
+/****************************************************************************/
+void VK::PipelineCache::Create(VK::Device& device, const std::string& shaderCacheDirectory, unsigned workerCount)
+{
+    mDevice = &device;
+    mShaders.Create(shaderCacheDirectory);
+
+    VkPipelineCacheCreateInfo cacheInfo = {};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    if (vkCreatePipelineCache(device.Get(), &cacheInfo, nullptr, &mCache) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("PipelineCache::Create: failed to create pipeline cache!");
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    // leave cores for the render and simulation threads
+    if (workerCount == 0)
+        workerCount = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+
+    mStopping = false;
+    for (unsigned i = 0; i < workerCount; ++i)
+        mWorkers.emplace_back(&VK::PipelineCache::WorkerLoop, this);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, nothing made by the cache may be in use. Queued compiles are
+  dropped, running ones are finished first.
+*/
+/****************************************************************************/
+void VK::PipelineCache::ShutDown(VK::Device& device)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        mJobs.clear();
+    }
+    mJobReady.notify_all();
+
+    for (std::thread& worker : mWorkers)
+        worker.join();
+    mWorkers.clear();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto& pipeline : mPipelines)
+        vkDestroyPipeline(device.Get(), pipeline.second.entry.pipeline, nullptr);
+    for (auto& pipeline : mComputePipelines)
+        vkDestroyPipeline(device.Get(), pipeline.second.pipeline, nullptr);
+    for (auto& layout : mLayouts)
+        vkDestroyPipelineLayout(device.Get(), layout.second, nullptr);
+    for (auto& setLayout : mSetLayouts)
+        vkDestroyDescriptorSetLayout(device.Get(), setLayout.second, nullptr);
+
+    mPipelines.clear();
+    mComputePipelines.clear();
+    mLayouts.clear();
+    mSetLayouts.clear();
+    mCompileTimes.clear();
+    mShaders.ShutDown(device);
+    mPending = 0;
+
+    if (mCache != VK_NULL_HANDLE)
+    {
+        vkDestroyPipelineCache(device.Get(), mCache, nullptr);
+        mCache = VK_NULL_HANDLE;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the pipeline for a description, compiling it on this thread if it
+  is new. Blocks when a worker is already compiling it.
+*/
+/****************************************************************************/
+VK::PipelineCache::Entry VK::PipelineCache::GetPipeline(VK::Device& device, const PipelineDesc& desc)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    auto found = mPipelines.find(desc);
+    if (found == mPipelines.end())
+    {
+        mPipelines.emplace(desc, Slot());
+        ++mPending;
+
+        return CompileNow(lock, device, desc);
+    }
+
+    // still queued, no point waiting behind the other jobs
+    auto queued = std::find(mJobs.begin(), mJobs.end(), desc);
+    if (queued != mJobs.end())
+    {
+        mJobs.erase(queued);
+        return CompileNow(lock, device, desc);
+    }
+
+    Slot& slot = found->second;
+    mCompileDone.wait(lock, [&slot]() { return slot.state != State::Pending; });
+
+    if (slot.state == State::Failed)
+    {
+        DEBUG::log.Error("PipelineCache::GetPipeline: failed to create graphics pipeline: " + slot.error);
+        throw std::runtime_error("failed to create graphics pipeline: " + slot.error);
+    }
+
+    return slot.entry;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the pipeline for a description without waiting for it. A new
+  description is queued for the workers and the entry is empty until it
+  is done. Throws once its compile has failed.
+*/
+/****************************************************************************/
+VK::PipelineCache::Entry VK::PipelineCache::RequestPipeline(VK::Device& device, const PipelineDesc& desc)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    auto found = mPipelines.find(desc);
+    if (found != mPipelines.end())
+    {
+        const Slot& slot = found->second;
+        if (slot.state == State::Failed)
+        {
+            DEBUG::log.Error("PipelineCache::RequestPipeline: failed to create graphics pipeline: " + slot.error);
+            throw std::runtime_error("failed to create graphics pipeline: " + slot.error);
+        }
+        return slot.entry;
+    }
+
+    mPipelines.emplace(desc, Slot());
+    ++mPending;
+
+    if (mWorkers.empty())
+        return CompileNow(lock, device, desc);
+
+    mJobs.push_back(desc);
+    lock.unlock();
+    mJobReady.notify_one();
+
+    return Entry();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the compute pipeline for a description, compiling it on this thread
+  if it is new
+*/
+/****************************************************************************/
+VK::PipelineCache::Entry VK::PipelineCache::GetComputePipeline(VK::Device& device, const ComputePipelineDesc& desc)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto found = mComputePipelines.find(desc);
+        if (found != mComputePipelines.end())
+            return found->second;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Entry entry = CompileCompute(device, desc);
+    float milliseconds = MillisecondsSince(start);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // another thread compiled the same description meanwhile, keep the first
+    auto inserted = mComputePipelines.emplace(desc, entry);
+    if (!inserted.second)
+    {
+        vkDestroyPipeline(device.Get(), entry.pipeline, nullptr);
+        return inserted.first->second;
+    }
+
+    mCompileTimes.push_back({ desc.computePath, milliseconds, false });
+    return entry;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the pipeline layout for a list of sets and push constants
+*/
+/****************************************************************************/
+VkPipelineLayout VK::PipelineCache::GetLayout(VK::Device& device, const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& setLayouts,
+    const std::vector<VkPushConstantRange>& pushConstants)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return FindLayout(device, setLayouts, pushConstants);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the descriptor set layout for a list of bindings
+*/
+/****************************************************************************/
+VkDescriptorSetLayout VK::PipelineCache::GetSetLayout(VK::Device& device, const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return FindSetLayout(device, bindings);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the shader module cache
+*/
+/****************************************************************************/
+VK::ShaderCache& VK::PipelineCache::Shaders()
+{
+    return mShaders;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the driver side pipeline cache
+*/
+/****************************************************************************/
+VkPipelineCache VK::PipelineCache::Get() const
+{
+    return mCache;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of unique graphics and compute pipelines compiled so far
+*/
+/****************************************************************************/
+size_t VK::PipelineCache::PipelineCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPipelines.size() + mComputePipelines.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of unique pipeline layouts made so far
+*/
+/****************************************************************************/
+size_t VK::PipelineCache::LayoutCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLayouts.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of compiles queued or running
+*/
+/****************************************************************************/
+size_t VK::PipelineCache::PendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPending;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of background compiles finished so far, changes whenever
+  a requested pipeline may have become ready
+*/
+/****************************************************************************/
+uint64_t VK::PipelineCache::CompletedCount() const
+{
+    return mCompleted;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get how long every compile took, in the order they finished
+*/
+/****************************************************************************/
+std::vector<VK::PipelineCache::CompileRecord> VK::PipelineCache::CompileTimes() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCompileTimes;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  hash a description for the pipeline map
+*/
+/****************************************************************************/
+size_t VK::PipelineCache::DescHash::operator()(const PipelineDesc& desc) const
+{
+    return size_t(desc.Hash());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  hash a description for the compute pipeline map
+*/
+/****************************************************************************/
+size_t VK::PipelineCache::ComputeDescHash::operator()(const ComputePipelineDesc& desc) const
+{
+    return size_t(desc.Hash());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get or make a pipeline layout, the lock must be held
+*/
+/****************************************************************************/
+VkPipelineLayout VK::PipelineCache::FindLayout(VK::Device& device, const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& setLayouts,
+    const std::vector<VkPushConstantRange>& pushConstants)
+{
+    std::vector<uint32_t> key;
+    key.push_back(uint32_t(setLayouts.size()));
+    for (const std::vector<VkDescriptorSetLayoutBinding>& set : setLayouts)
+        AppendBindings(key, set);
+    for (const VkPushConstantRange& range : pushConstants)
+    {
+        key.push_back(range.stageFlags);
+        key.push_back(range.offset);
+        key.push_back(range.size);
+    }
+
+    auto found = mLayouts.find(key);
+    if (found != mLayouts.end())
+        return found->second;
+
+    std::vector<VkDescriptorSetLayout> sets;
+    for (const std::vector<VkDescriptorSetLayoutBinding>& set : setLayouts)
+        sets.push_back(FindSetLayout(device, set));
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = uint32_t(sets.size());
+    pipelineLayoutInfo.pSetLayouts = sets.data();
+    pipelineLayoutInfo.pushConstantRangeCount = uint32_t(pushConstants.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstants.data();
+
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(device.Get(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("PipelineCache::FindLayout: failed to create pipeline layout!");
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    mLayouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get or make a descriptor set layout, the lock must be held. Sets
+  allocated from any identically defined layout can be bound with it.
+*/
+/****************************************************************************/
+VkDescriptorSetLayout VK::PipelineCache::FindSetLayout(VK::Device& device, const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    std::vector<uint32_t> key;
+    AppendBindings(key, bindings);
+
+    auto found = mSetLayouts.find(key);
+    if (found != mSetLayouts.end())
+        return found->second;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = uint32_t(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    VkDescriptorSetLayout setLayout;
+    if (vkCreateDescriptorSetLayout(device.Get(), &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("PipelineCache::FindSetLayout: failed to create descriptor set layout!");
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+
+    mSetLayouts.emplace(std::move(key), setLayout);
+    return setLayout;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Drop the queued compiles that use a render pass and wait for the running
+  ones, call before the render pass is destroyed. A dropped description is
+  queued again the next time it is requested.
+*/
+/****************************************************************************/
+void VK::PipelineCache::CancelRenderPass(VkRenderPass renderPass)
+{
+    if (renderPass == VK_NULL_HANDLE)
+        return;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (auto job = mJobs.begin(); job != mJobs.end();)
+    {
+        if (job->renderPass != renderPass)
+        {
+            ++job;
+            continue;
+        }
+
+        mPipelines.erase(*job);
+        --mPending;
+        job = mJobs.erase(job);
+    }
+
+    mCompileDone.wait(lock, [this, renderPass]()
+        { return std::find(mCompiling.begin(), mCompiling.end(), renderPass) == mCompiling.end(); });
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compile a pending pipeline on the calling thread, the lock is released
+  while the driver works so other lookups and workers carry on
+*/
+/****************************************************************************/
+VK::PipelineCache::Entry VK::PipelineCache::CompileNow(std::unique_lock<std::mutex>& lock, VK::Device& device, const PipelineDesc& desc)
+{
+    lock.unlock();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Entry entry;
+    try
+    {
+        entry = Compile(device, desc);
+    }
+    catch (const std::exception& e)
+    {
+        Finish(desc, Entry(), MillisecondsSince(start), false, e.what());
+        throw;
+    }
+    catch (...)
+    {
+        Finish(desc, Entry(), MillisecondsSince(start), false);
+        throw;
+    }
+    Finish(desc, entry, MillisecondsSince(start), false);
+
+    return entry;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compile queued pipelines until the cache shuts down
+*/
+/****************************************************************************/
+void VK::PipelineCache::WorkerLoop()
+{
+    for (;;)
+    {
+        PipelineDesc desc;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mJobReady.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+            if (mStopping)
+                return;
+
+            desc = std::move(mJobs.front());
+            mJobs.pop_front();
+            mCompiling.push_back(desc.renderPass);
+        }
+
+        // a failure is kept for RequestPipeline to throw to the owner,
+        // which polls it from the thread that can handle it
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Entry entry;
+        std::string error;
+        try
+        {
+            entry = Compile(*mDevice, desc);
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+            DEBUG::log.Error("PipelineCache::WorkerLoop: failed to compile " + PipelineName(desc) + ": " + error);
+        }
+        Finish(desc, entry, MillisecondsSince(start), true, error);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Store a finished compile and wake everyone waiting for it
+*/
+/****************************************************************************/
+void VK::PipelineCache::Finish(const PipelineDesc& desc, const Entry& entry, float milliseconds, bool async, const std::string& error)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        Slot& slot = mPipelines.find(desc)->second;
+        slot.entry = entry;
+        slot.state = entry.pipeline != VK_NULL_HANDLE ? State::Ready : State::Failed;
+        if (slot.state == State::Failed)
+            slot.error = error.empty() ? "unknown error" : error;
+        --mPending;
+
+        CompileRecord record;
+        record.name = PipelineName(desc);
+        record.milliseconds = milliseconds;
+        record.async = async;
+        mCompileTimes.push_back(record);
+
+        if (async)
+        {
+            mCompiling.erase(std::find(mCompiling.begin(), mCompiling.end(), desc.renderPass));
+            ++mCompleted;
+        }
+    }
+    mCompileDone.notify_all();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compile a new graphics pipeline, safe to call from several threads.
+  Layouts and vertex input the description leaves empty are reflected
+  from the shaders.
+*/
+/****************************************************************************/
+VK::PipelineCache::Entry VK::PipelineCache::Compile(VK::Device& device, const PipelineDesc& desc)
+{
+    // modules are made once and kept by the shader cache
+    const VK::ShaderCache::Module& vertShader = mShaders.Get(device, desc.vertexPath, desc.defines);
+    const VK::ShaderCache::Module& fragShader = mShaders.Get(device, desc.fragmentPath, desc.defines);
+    VkShaderModule vertShaderModule = vertShader.module;
+    VkShaderModule fragShaderModule = fragShader.module;
+
+    VK::ShaderReflection reflection = vertShader.reflection;
+    reflection.Merge(fragShader.reflection);
+
+    std::vector<VkVertexInputBindingDescription> vertexBindings = desc.vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes = desc.vertexAttributes;
+    if (vertexBindings.empty() && vertexAttributes.empty())
+        reflection.VertexInput(vertexBindings, vertexAttributes);
+
+    SpecializationData specializationData;
+    const VkSpecializationInfo* specialization = BuildSpecialization(specializationData, desc.specialization, reflection, PipelineName(desc));
+
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        entry.layout = FindLayout(device, desc.setLayouts.empty() ? reflection.SetLayouts() : desc.setLayouts,
+            desc.pushConstants.empty() ? reflection.PushConstants() : desc.pushConstants);
+    }
+
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName = "main";
+    vertShaderStageInfo.pSpecializationInfo = specialization;
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = specialization;
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = uint32_t(vertexBindings.size());
+    vertexInputInfo.vertexAttributeDescriptionCount = uint32_t(vertexAttributes.size());
+    vertexInputInfo.pVertexBindingDescriptions = vertexBindings.data();
+    vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes.data();
+
+    // build the rest of the pipelne
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = desc.topology;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // viewport and scissor are set while recording, so the render size can change
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = desc.polyMode;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = desc.cullMode;
+    rasterizer.frontFace = desc.frontFace;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = desc.samples;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = desc.blend;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    std::vector<VkPipelineColorBlendAttachmentState> cBlendAttach(desc.colorFormats.size(), colorBlendAttachment);
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = uint32_t(cBlendAttach.size());
+    colorBlending.pAttachments = cBlendAttach.data();
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = desc.depthTest;
+    depthStencil.depthWriteEnable = desc.depthWrite;
+    depthStencil.depthCompareOp = desc.depthCompare;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.minDepthBounds = 0.0f;
+    depthStencil.maxDepthBounds = 1.0f;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    // without a render pass the attachment formats are given directly
+    VkPipelineRenderingCreateInfoKHR renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = uint32_t(desc.colorFormats.size());
+    renderingInfo.pColorAttachmentFormats = desc.colorFormats.data();
+    renderingInfo.depthAttachmentFormat = desc.depthFormat;
+    renderingInfo.stencilAttachmentFormat = (VK::GetFormatAspect(desc.depthFormat) & VK_IMAGE_ASPECT_STENCIL_BIT) ? desc.depthFormat : VK_FORMAT_UNDEFINED;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = desc.renderPass == VK_NULL_HANDLE ? &renderingInfo : nullptr;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDepthStencilState = desc.depthFormat != VK_FORMAT_UNDEFINED ? &depthStencil : nullptr;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = entry.layout;
+    pipelineInfo.renderPass = desc.renderPass;
+    pipelineInfo.subpass = desc.subpass;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    if (vkCreateGraphicsPipelines(device.Get(), mCache, 1, &pipelineInfo, nullptr, &entry.pipeline) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("PipelineCache::Compile: failed to create graphics pipeline!");
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+
+    return entry;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compile a new compute pipeline, safe to call from several threads. A
+  layout the description leaves empty is reflected from the shader.
+*/
+/****************************************************************************/
+VK::PipelineCache::Entry VK::PipelineCache::CompileCompute(VK::Device& device, const ComputePipelineDesc& desc)
+{
+    const VK::ShaderCache::Module& shader = mShaders.Get(device, desc.computePath, desc.defines);
+
+    SpecializationData specializationData;
+    const VkSpecializationInfo* specialization = BuildSpecialization(specializationData, desc.specialization, shader.reflection, desc.computePath);
+
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        entry.layout = FindLayout(device, desc.setLayouts.empty() ? shader.reflection.SetLayouts() : desc.setLayouts,
+            desc.pushConstants.empty() ? shader.reflection.PushConstants() : desc.pushConstants);
+    }
+
+    VkPipelineShaderStageCreateInfo stageInfo = {};
+    stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stageInfo.module = shader.module;
+    stageInfo.pName = "main";
+    stageInfo.pSpecializationInfo = specialization;
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = stageInfo;
+    pipelineInfo.layout = entry.layout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    if (vkCreateComputePipelines(device.Get(), mCache, 1, &pipelineInfo, nullptr, &entry.pipeline) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("PipelineCache::CompileCompute: failed to create compute pipeline!");
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+
+    return entry;
+}
@@ -0,0 +1,907 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "PresentTarget.hpp"
+#include "CpuProfiler.hpp"
+#include <chrono>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// specialization constants of Simple.frag
+static const uint32_t SimpleShowNormals = 0;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Called when a window gets resized,
+  signal its target to resize its buffers
+
+\param window
+  The window that got resized
+
+\param width
+  The new width
+
+\param height
+  The new height
+*/
+/****************************************************************************/
+static void FramebufferResizeCallback(WindowPtr window, int width, int height)
+{
+    VK::PresentTarget* target = reinterpret_cast<VK::PresentTarget*>(glfwGetWindowUserPointer(window));
+    target->Resize(width, height);
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Create the window and its surface, must be called from the thread that
+  polls window events. Headless targets only remember their size.
+*/
+/****************************************************************************/
+void VK::PresentTarget::OpenWindow(VK::Instance& instance, const PresentTargetDesc& desc)
+{
+    mHeadless = desc.headless;
+    mWidth = desc.width;
+    mHeight = desc.height;
+
+    if (mHeadless)
+        return;
+
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+    mWindow = glfwCreateWindow(desc.width, desc.height, desc.title.c_str(), nullptr, nullptr);
+    if (!mWindow)
+    {
+        DEBUG::log.Error("PresentTarget::OpenWindow: failed to create window!");
+        throw std::runtime_error("failed to create window!");
+    }
+
+    glfwSetWindowUserPointer(mWindow, this);
+    glfwSetFramebufferSizeCallback(mWindow, FramebufferResizeCallback);
+
+    mSurface.Create(instance, mWindow);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create the swap chain and everything drawn into it
+*/
+/****************************************************************************/
+void VK::PresentTarget::Create(VK::Device& device, VK::CommandPool& commandPool, VK::PipelineCache& pipelineCache, VK::Mesh& mesh, const RendererConfig& config)
+{
+    InitSwapChain(device, config);
+    InitSyncObjects(device, config.framesInFlight);
+
+    mCommandBuffer.Create(device, commandPool, unsigned(mSwapChain.Images()->size()));
+    if (config.gpuProfiling)
+    {
+        mGpuProfiler.Create(device, unsigned(mSwapChain.Images()->size()));
+    }
+    mGpuDriven = config.gpuCulling && device.DrawIndirectCount();
+    mOcclusion = mGpuDriven && config.occlusionCulling;
+    InitDynamicResolution(device, config);
+    InitRenderGraph(device, mesh);
+    InitPipelines(device, pipelineCache, mesh, config);
+
+    UpdateCommandBuffers();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Rebuild everything that depends on the swap chain, the device must be idle
+*/
+/****************************************************************************/
+void VK::PresentTarget::Recreate(VK::Device& device, VK::CommandPool& commandPool, VK::PipelineCache& pipelineCache, VK::Mesh& mesh, const RendererConfig& config)
+{
+    VK_PROFILE_SCOPE("RecreateSwapChain");
+
+    ShutdownSwapChain(device, commandPool);
+
+    InitSwapChain(device, config);
+    mCommandBuffer.Create(device, commandPool, unsigned(mSwapChain.Images()->size()));
+    if (config.gpuProfiling)
+    {
+        mGpuProfiler.Create(device, unsigned(mSwapChain.Images()->size()));
+    }
+    mImagesInFlight.assign(mSwapChain.Images()->size(), VK::Fence());
+    mHeadlessImage = 0;
+    mResized = false;
+
+    InitDynamicResolution(device, config);
+    InitRenderGraph(device, mesh);
+    InitPipelines(device, pipelineCache, mesh, config);
+    UpdateCommandBuffers();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Destroy everything including the window, the device must be idle
+*/
+/****************************************************************************/
+void VK::PresentTarget::ShutDown(VK::Instance& instance, VK::Device& device, VK::CommandPool& commandPool)
+{
+    ShutdownSwapChain(device, commandPool);
+    mSwapChain.ShutDown(device);
+    ShutdownSyncObjects(device);
+    mSurface.ShutDown(instance);
+
+    if (mWindow)
+    {
+        glfwDestroyWindow(mWindow);
+        mWindow = nullptr;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create the acquire and present semaphores of every frame in flight
+*/
+/****************************************************************************/
+void VK::PresentTarget::InitSyncObjects(VK::Device& device, unsigned framesInFlight)
+{
+    mImageAvailableSemaphores.resize(framesInFlight);
+    mRenderFinishedSemaphores.resize(framesInFlight);
+    mImagesInFlight.assign(mSwapChain.Images()->size(), VK::Fence());
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (size_t i = 0; i < framesInFlight; ++i)
+    {
+        mImageAvailableSemaphores[i].Create(device, semaphoreInfo);
+        mRenderFinishedSemaphores[i].Create(device, semaphoreInfo);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Destroy the per frame semaphores, forget which frame used which image
+*/
+/****************************************************************************/
+void VK::PresentTarget::ShutdownSyncObjects(VK::Device& device)
+{
+    for (size_t i = 0; i < mImageAvailableSemaphores.size(); ++i)
+    {
+        mRenderFinishedSemaphores[i].ShutDown(device);
+        mImageAvailableSemaphores[i].ShutDown(device);
+    }
+
+    mRenderFinishedSemaphores.clear();
+    mImageAvailableSemaphores.clear();
+    mImagesInFlight.assign(mImagesInFlight.size(), VK::Fence());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the next image, wait until the last frame that drew into it is done
+  and get its command buffer ready for this frame
+
+\param frame
+  The frame in flight, picks the semaphore the acquire signals
+
+\param frameFence
+  Fence the renderer submits this frame with
+
+\param scene
+  Camera and objects of the frame
+
+\return
+  The acquire result, VK_ERROR_OUT_OF_DATE_KHR means Recreate
+*/
+/****************************************************************************/
+VkResult VK::PresentTarget::Acquire(VK::Device& device, size_t frame, VK::Fence& frameFence, FrameScene& scene)
+{
+    VK_PROFILE_SCOPE("Acquire");
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point waitStart = Clock::now();
+
+    VkResult result = VK_SUCCESS;
+    if (mHeadless)
+    {
+        // offscreen images are used round robin, mImagesInFlight guards reuse
+        mImageIndex = mHeadlessImage;
+        mHeadlessImage = (mHeadlessImage + 1) % uint32_t(mSwapChain.Images()->size());
+    }
+    else
+    {
+        VK_PROFILE_SCOPE("AcquireNextImage");
+        result = vkAcquireNextImageKHR(device.Get(), mSwapChain.Get(), UINT64_MAX, mImageAvailableSemaphores[frame].Get(), VK_NULL_HANDLE, &mImageIndex);
+    }
+
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+        return result;
+
+    if (mImagesInFlight[mImageIndex].Get() != VK_NULL_HANDLE)
+    {
+        VK_PROFILE_SCOPE("WaitForImageFence");
+        vkWaitForFences(device.Get(), 1, mImagesInFlight[mImageIndex].GetPointerTo(), VK_TRUE, UINT64_MAX);
+    }
+    mImagesInFlight[mImageIndex] = frameFence;
+    mWaitMs = std::chrono::duration<float, std::milli>(Clock::now() - waitStart).count();
+
+    // update buffers
+    {
+        VK_PROFILE_SCOPE("UpdateBuffers");
+        mMatrixBuffer.Update(device, mImageIndex, &scene.matrices, sizeof(MatrixBuffer));
+        if (mGpuDriven)
+        {
+            mGpuCulling.Update(mImageIndex, scene.matrices.proj * scene.matrices.view, scene.objects, scene.changed);
+        }
+        else
+        {
+            mInstances.Update(mImageIndex, scene.instances);
+        }
+    }
+
+    // the image's last frame is done, so its timing is ready and its
+    // command buffer can be re-recorded at the new scale or with a
+    // pipeline that finished compiling
+    bool timed = mGpuProfiler.Update(device, mImageIndex);
+    mPipeline.Update(device, *mPipelineCache);
+    // the batches are recorded, so a change in them means recording again.
+    // Instances past the buffer are left out.
+    mBatches.clear();
+    uint32_t capacity = mInstances.Capacity();
+    for (const DrawBatch& batch : scene.batches)
+    {
+        if (batch.firstInstance >= capacity)
+            break;
+
+        mBatches.push_back(batch);
+        mBatches.back().instanceCount = std::min(batch.instanceCount, capacity - batch.firstInstance);
+    }
+    bool stale = mRecordedPipelines[mImageIndex] != mPipeline.Get() || mRecordedBatches[mImageIndex] != mBatches;
+
+    if (mDynamicResolution.IsActive())
+    {
+        if (!mGpuProfiler.IsActive())
+            mDynamicResolution.Update(device, mImageIndex);
+        else if (timed)
+            mDynamicResolution.Update(GpuFrameTime());
+
+        VkExtent2D extent = SceneExtent();
+        stale |= extent.width != mRecordedExtents[mImageIndex].width || extent.height != mRecordedExtents[mImageIndex].height;
+    }
+
+    if (stale)
+    {
+        RecordCommandBuffer(mImageIndex);
+    }
+
+    return result;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Change the GPU time dynamic resolution steers towards
+*/
+/****************************************************************************/
+void VK::PresentTarget::SetBudget(float budgetMs)
+{
+    mDynamicResolution.SetBudget(budgetMs);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Remember the new window size, the swap chain is rebuilt after the next
+  present
+*/
+/****************************************************************************/
+void VK::PresentTarget::Resize(int width, int height)
+{
+    mWidth = width;
+    mHeight = height;
+    mResized = true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Was the window resized since the last call
+*/
+/****************************************************************************/
+bool VK::PresentTarget::TakeResized()
+{
+    return mResized.exchange(false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Did the user ask to close the window
+*/
+/****************************************************************************/
+bool VK::PresentTarget::ShouldClose() const
+{
+    return mWindow && glfwWindowShouldClose(mWindow);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the window, nullptr when headless
+*/
+/****************************************************************************/
+WindowPtr VK::PresentTarget::Window() const
+{
+    return mWindow;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the surface of the window
+*/
+/****************************************************************************/
+VK::Surface& VK::PresentTarget::GetSurface()
+{
+    return mSurface;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the swap chain, or the offscreen image ring when headless
+*/
+/****************************************************************************/
+VK::SwapChain& VK::PresentTarget::GetSwapChain()
+{
+    return mSwapChain;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Does this target render into offscreen images
+*/
+/****************************************************************************/
+bool VK::PresentTarget::IsHeadless() const
+{
+    return mHeadless;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the width / height of the window
+*/
+/****************************************************************************/
+float VK::PresentTarget::AspectRatio() const
+{
+    if (mHeight == 0)
+        return 1.0f;
+
+    return float(mWidth) / float(mHeight);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  the layout the color attachment is left in at the end of the frame
+*/
+/****************************************************************************/
+VkImageLayout VK::PresentTarget::ColorFinalLayout() const
+{
+    return mHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get what the GPU culling did with the acquired image's last frame
+*/
+/****************************************************************************/
+const VK::GpuCullingStats& VK::PresentTarget::CullingStats() const
+{
+    return mGpuCulling.Stats();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the GPU time of the frame and of every render graph pass, empty
+  unless RendererConfig::gpuProfiling is set
+*/
+/****************************************************************************/
+const std::vector<VK::GpuScopeStats>& VK::PresentTarget::GpuScopes() const
+{
+    return mGpuProfiler.Scopes();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the GPU time in milliseconds of the last frame read back, negative
+  if frames are not timed
+*/
+/****************************************************************************/
+float VK::PresentTarget::GpuFrameTime() const
+{
+    const VK::GpuScopeStats* frame = mGpuProfiler.IsActive() ? mGpuProfiler.Find("Frame") : nullptr;
+    return frame ? frame->lastMs : -1.0f;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the milliseconds the last successful Acquire waited on the swap
+  chain and on the image's last frame
+*/
+/****************************************************************************/
+float VK::PresentTarget::WaitTime() const
+{
+    return mWaitMs;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the index of the acquired image
+*/
+/****************************************************************************/
+uint32_t VK::PresentTarget::ImageIndex() const
+{
+    return mImageIndex;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the acquired image
+*/
+/****************************************************************************/
+VkImage VK::PresentTarget::Image()
+{
+    return (*mSwapChain.Images())[mImageIndex];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the command buffer that draws the acquired image
+*/
+/****************************************************************************/
+VkCommandBuffer VK::PresentTarget::CommandBuffer() const
+{
+    return mCommandBuffer[mImageIndex];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the semaphore the acquire of a frame signals
+*/
+/****************************************************************************/
+VkSemaphore VK::PresentTarget::ImageAvailable(size_t frame) const
+{
+    return mImageAvailableSemaphores[frame].Get();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the semaphore the present of a frame waits on
+*/
+/****************************************************************************/
+VkSemaphore VK::PresentTarget::RenderFinished(size_t frame) const
+{
+    return mRenderFinishedSemaphores[frame].Get();
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Create the swap chain, or the offscreen image ring when headless
+*/
+/****************************************************************************/
+void VK::PresentTarget::InitSwapChain(VK::Device& device, const RendererConfig& config)
+{
+    if (mHeadless)
+    {
+        uint32_t imageCount = config.minImageCount > 0 ? config.minImageCount : config.framesInFlight + 1;
+        mSwapChain.CreateHeadless(device, { uint32_t(mWidth.load()), uint32_t(mHeight.load()) }, imageCount);
+    }
+    else
+    {
+        // the old swap chain is retired inside Create
+        mSwapChain.Create(mSurface, device, mWindow, config.presentModes, config.minImageCount);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create the render scaler if it was requested and the swap chain can be
+  blitted into, otherwise the scene renders straight into the swap chain
+*/
+/****************************************************************************/
+void VK::PresentTarget::InitDynamicResolution(VK::Device& device, const RendererConfig& config)
+{
+    mDynamicResolution.ShutDown(device);
+    if (!config.dynamicResolution)
+        return;
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(device.GetPhysicalDevice(), mSwapChain.Format(), &properties);
+    VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+        VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    if ((properties.optimalTilingFeatures & needed) != needed || !(mSwapChain.ImageUsage() & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+    {
+        DEBUG::log.Error("PresentTarget::InitDynamicResolution: the swap chain can not be upscaled into, rendering at full size!");
+        return;
+    }
+
+    // the profiler's frame scope already times every frame
+    mDynamicResolution.Create(device, mSwapChain.Extent(), uint32_t(mSwapChain.Images()->size()), config.resolution,
+        !mGpuProfiler.IsActive());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Declare the frame's passes and compile them into render passes and
+  framebuffers, the depth buffer is a transient graph image
+*/
+/****************************************************************************/
+void VK::PresentTarget::InitRenderGraph(VK::Device& device, VK::Mesh& mesh)
+{
+    std::vector<VkImageView> views;
+    for (VK::ImageView& view : *mSwapChain.ImageViews())
+    {
+        views.push_back(view.Get());
+    }
+
+    VkClearValue clearColor = {};
+    clearColor.color = { 0.2f, 0.2f, 0.2f, 1.0f };
+    VK::RenderGraphResource backBuffer = mRenderGraph.ImportImage("BackBuffer", *mSwapChain.Images(), views,
+        mSwapChain.Format(), mSwapChain.Extent(), ColorFinalLayout(), clearColor);
+
+    // with dynamic resolution the scene goes into a max size target first
+    bool scaled = mDynamicResolution.IsActive();
+    VkExtent2D targetExtent = scaled ? mDynamicResolution.MaxExtent() : mSwapChain.Extent();
+
+    VK::RenderGraphResource sceneColor = backBuffer;
+    if (scaled)
+    {
+        VK::RenderGraphImageDesc colorDesc;
+        colorDesc.format = mSwapChain.Format();
+        colorDesc.extent = targetExtent;
+        colorDesc.clear = clearColor;
+        sceneColor = mRenderGraph.CreateImage("SceneColor", colorDesc);
+    }
+
+    VK::RenderGraphImageDesc depthDesc;
+    depthDesc.format = FindDepthFormat(device);
+    depthDesc.extent = targetExtent;
+    depthDesc.clear.depthStencil = { 1.0f, 0 };
+    VK::RenderGraphResource depth = mRenderGraph.CreateImage("Depth", depthDesc);
+    mDepth = depth;
+
+    // the GPU writes the scene's draws before the scene pass, the graph
+    // only tracks images so the pass keeps itself alive
+    if (mGpuDriven)
+    {
+        mRenderGraph.AddPass("Cull",
+            [](VK::RenderGraph::PassBuilder& builder)
+            {
+                builder.SideEffect();
+            },
+            [this](VkCommandBuffer, uint32_t i)
+            {
+                if (mPipeline.Get() != VK_NULL_HANDLE)
+                    mGpuCulling.Cull(mCommandBuffer, i);
+            });
+    }
+
+    // the mesh is owned by the renderer and outlives the graph
+    VK::Mesh* scene = &mesh;
+    mScenePass = mRenderGraph.AddPass("Scene",
+        [=](VK::RenderGraph::PassBuilder& builder)
+        {
+            builder.WriteColor(sceneColor);
+            builder.WriteDepth(depth);
+        },
+        [this, scene](VkCommandBuffer, uint32_t i)
+        {
+            // still compiling or nothing survived culling, the pass only clears
+            if (mPipeline.Get() == VK_NULL_HANDLE || (!mGpuDriven && mBatches.empty()))
+                return;
+
+            mCommandBuffer.SetViewport(i, SceneExtent());
+            mCommandBuffer.BindVertexBufferes(i, { scene->Buffer()->Get() }, { 0,0 });
+            mCommandBuffer.BindPipeline(i, mPipeline);
+
+            if (mGpuDriven)
+            {
+                mCommandBuffer.BindDescriptorSet(i, mPipeline, { mMatrixBuffer.Set(i), mGpuCulling.ObjectSet(i) });
+                mCommandBuffer.BindIndexBuffer(i, scene->IndexBuffer()->Get());
+                mGpuCulling.Draw(mCommandBuffer, i);
+                return;
+            }
+
+            // one draw per batch, the test scene has a single mesh and material
+            mCommandBuffer.BindDescriptorSet(i, mPipeline, { mMatrixBuffer.Set(i), mInstances.Set(i) });
+            mCommandBuffer.BindIndexBuffer(i, scene->IndexBuffer()->Get());
+            for (const DrawBatch& batch : mBatches)
+            {
+                mCommandBuffer.DrawIndexedInstances(i, scene->IndexCount(), batch.instanceCount, batch.firstInstance);
+            }
+        });
+
+    // the scene pass drew last frame's visible objects, their depth is
+    // reduced into the pyramid, every object is tested against it and the
+    // ones that came into view are drawn on top
+    if (mOcclusion)
+    {
+        mRenderGraph.AddPass("DepthPyramid",
+            [=](VK::RenderGraph::PassBuilder& builder)
+            {
+                builder.ReadTexture(depth);
+                builder.SideEffect();
+            },
+            [this](VkCommandBuffer, uint32_t i)
+            {
+                if (mPipeline.Get() != VK_NULL_HANDLE)
+                    mDepthPyramid.Build(mCommandBuffer, i, SceneExtent());
+            });
+
+        mRenderGraph.AddPass("CullLate",
+            [](VK::RenderGraph::PassBuilder& builder)
+            {
+                builder.SideEffect();
+            },
+            [this](VkCommandBuffer, uint32_t i)
+            {
+                if (mPipeline.Get() != VK_NULL_HANDLE)
+                    mGpuCulling.CullLate(mCommandBuffer, i);
+            });
+
+        mLateScenePass = mRenderGraph.AddPass("SceneLate",
+            [=](VK::RenderGraph::PassBuilder& builder)
+            {
+                builder.WriteColor(sceneColor);
+                builder.WriteDepth(depth);
+            },
+            [this, scene](VkCommandBuffer, uint32_t i)
+            {
+                if (mPipeline.Get() == VK_NULL_HANDLE)
+                    return;
+
+                mCommandBuffer.SetViewport(i, SceneExtent());
+                mCommandBuffer.BindVertexBufferes(i, { scene->Buffer()->Get() }, { 0,0 });
+                mCommandBuffer.BindPipeline(i, mPipeline);
+                mCommandBuffer.BindDescriptorSet(i, mPipeline, { mMatrixBuffer.Set(i), mGpuCulling.ObjectSet(i) });
+                mCommandBuffer.BindIndexBuffer(i, scene->IndexBuffer()->Get());
+                mGpuCulling.DrawLate(mCommandBuffer, i);
+            });
+    }
+
+    if (scaled)
+    {
+        mRenderGraph.AddPass("Upscale",
+            [=](VK::RenderGraph::PassBuilder& builder)
+            {
+                builder.ReadTransfer(sceneColor);
+                builder.WriteTransfer(backBuffer);
+            },
+            [this, sceneColor, backBuffer](VkCommandBuffer commandBuffer, uint32_t i)
+            {
+                VkExtent2D source = SceneExtent();
+                VkExtent2D destination = mSwapChain.Extent();
+
+                VkImageBlit blit = {};
+                blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+                blit.srcOffsets[1] = { int32_t(source.width), int32_t(source.height), 1 };
+                blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+                blit.dstOffsets[1] = { int32_t(destination.width), int32_t(destination.height), 1 };
+
+                vkCmdBlitImage(commandBuffer,
+                    mRenderGraph.GetImage(sceneColor), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    mRenderGraph.GetImage(backBuffer, i), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1, &blit, VK_FILTER_LINEAR);
+            });
+    }
+
+    mRenderGraph.Compile(device, mSwapChain.Extent());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get all pipelines, after a resize they come straight out of the cache
+*/
+/****************************************************************************/
+void VK::PresentTarget::InitPipelines(VK::Device& device, VK::PipelineCache& pipelineCache, VK::Mesh& mesh, const RendererConfig& config)
+{
+    mPipelineCache = &pipelineCache;
+
+    mMatrixBuffer.Create(device, unsigned(mSwapChain.Images()->size()), sizeof(MatrixBuffer), VK_SHADER_STAGE_VERTEX_BIT);
+
+    VK::BindingDesc bindings = mesh.BindingDescription();
+    VK::AttributeDesc attributes = mesh.AttributeDescription();
+
+    VK::PipelineDesc desc;
+    desc.vertexPath = "../Resource/Shaders/Instanced.vert";
+    desc.fragmentPath = "../Resource/Shaders/Simple.frag";
+    desc.vertexBindings.assign(bindings.begin(), bindings.end());
+    desc.vertexAttributes.assign(attributes.begin(), attributes.end());
+    desc.colorFormats = { mSwapChain.Format() };
+    desc.depthFormat = FindDepthFormat(device);
+    desc.Specialize(SimpleShowNormals, true);
+    desc.renderPass = mRenderGraph.GetRenderPass(mScenePass).Get();
+    mPipelinePass = desc.renderPass;
+
+    if (mGpuDriven)
+    {
+        // the graph made the depth image at the largest scene extent
+        VK::DepthPyramid* pyramid = nullptr;
+        if (mOcclusion)
+        {
+            VkExtent2D depthExtent = mDynamicResolution.IsActive() ? mDynamicResolution.MaxExtent() : mSwapChain.Extent();
+            mDepthPyramid.Create(device, pipelineCache, mRenderGraph.GetImage(mDepth), FindDepthFormat(device), depthExtent);
+            pyramid = &mDepthPyramid;
+        }
+
+        mGpuCulling.Create(device, pipelineCache, unsigned(mSwapChain.Images()->size()), config.gpuObjectCapacity, pyramid);
+
+        desc.vertexPath = "../Resource/Shaders/Indirect.vert";
+        desc.setLayouts = { mMatrixBuffer.Bindings(), VK::GpuCulling::ObjectBindings() };
+    }
+    else
+    {
+        mInstances.Create(device, pipelineCache, unsigned(mSwapChain.Images()->size()), config.instanceCapacity);
+        desc.setLayouts = { mMatrixBuffer.Bindings(), VK::InstanceBuffer::Bindings() };
+    }
+
+    if (config.asyncPipelines)
+        mPipeline.CreateAsync(device, pipelineCache, desc);
+    else
+        mPipeline.Create(device, pipelineCache, desc);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  fill all command buffers
+*/
+/****************************************************************************/
+void VK::PresentTarget::UpdateCommandBuffers()
+{
+    VK_PROFILE_SCOPE("UpdateCommandBuffers");
+
+    mRecordedExtents.assign(mCommandBuffer.size(), VkExtent2D());
+    mRecordedPipelines.assign(mCommandBuffer.size(), VK_NULL_HANDLE);
+    mRecordedBatches.assign(mCommandBuffer.size(), std::vector<DrawBatch>());
+    for (unsigned i = 0; i < mCommandBuffer.size(); ++i)
+    {
+        RecordCommandBuffer(i);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  fill one command buffer, it must not be in use by the GPU
+*/
+/****************************************************************************/
+void VK::PresentTarget::RecordCommandBuffer(unsigned i)
+{
+    VK_PROFILE_SCOPE("RecordCommandBuffer");
+
+    VkExtent2D extent = SceneExtent();
+
+    vkResetCommandBuffer(mCommandBuffer[i], VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
+    mCommandBuffer.Begin(i);
+    mDynamicResolution.BeginFrame(mCommandBuffer[i], i);
+    mGpuProfiler.BeginFrame(mCommandBuffer[i], i);
+
+    // the graph begins and ends the render passes around the scene pass
+    mRenderGraph.SetRenderArea(mScenePass, extent);
+    if (mOcclusion)
+    {
+        mRenderGraph.SetRenderArea(mLateScenePass, extent);
+    }
+    mRenderGraph.Execute(mCommandBuffer[i], i, &mGpuProfiler);
+
+    mGpuProfiler.EndFrame(mCommandBuffer[i], i);
+    mDynamicResolution.EndFrame(mCommandBuffer[i], i);
+    mCommandBuffer.EndRT(i);
+
+    mRecordedExtents[i] = extent;
+    mRecordedPipelines[i] = mPipeline.Get();
+    mRecordedBatches[i] = mBatches;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  shutdown everything swapchain related, the swap chain itself is kept
+  so the next one can retire it
+*/
+/****************************************************************************/
+void VK::PresentTarget::ShutdownSwapChain(VK::Device& device, VK::CommandPool& commandPool)
+{
+    mMatrixBuffer.ShutDown(device);
+    mGpuCulling.ShutDown(device);
+    mDepthPyramid.ShutDown(device);
+    mInstances.ShutDown(device);
+    mPipeline.ShutDown(device);
+
+    // a background compile may still be using the scene pass
+    if (mPipelineCache)
+    {
+        mPipelineCache->CancelRenderPass(mPipelinePass);
+    }
+    mPipelinePass = VK_NULL_HANDLE;
+    mRenderGraph.ShutDown(device);
+    mDynamicResolution.ShutDown(device);
+    mGpuProfiler.ShutDown(device);
+    mCommandBuffer.ShutDown(device, commandPool);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the desired depth format
+*/
+/****************************************************************************/
+VkFormat VK::PresentTarget::FindDepthFormat(VK::Device& device)
+{
+    // the depth pyramid samples it
+    VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (mOcclusion)
+    {
+        features |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    }
+
+    return device.FindSupportedFormat(
+        { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+        VK_IMAGE_TILING_OPTIMAL,
+        features);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  the size the scene is rendered at this frame
+*/
+/****************************************************************************/
+VkExtent2D VK::PresentTarget::SceneExtent() const
+{
+    return mDynamicResolution.IsActive() ? mDynamicResolution.Extent() : mSwapChain.Extent();
+}
@@ -0,0 +1,451 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "Readback.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  is this a 4 channel, 8 bit per channel format we know how to swizzle
+*/
+/****************************************************************************/
+static bool IsRGBA8(VkFormat format)
+{
+    return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+static bool IsBGRA8(VkFormat format)
+{
+    return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  does the physical device have a memory type with all of these flags
+*/
+/****************************************************************************/
+static bool HasMemoryType(VK::Device& device, VkMemoryPropertyFlags flags)
+{
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(device.GetPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
+    {
+        if ((memProperties.memoryTypes[i].propertyFlags & flags) == flags)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  bytes per output pixel
+*/
+/****************************************************************************/
+static size_t PixelSize(VK::ReadbackFormat format)
+{
+    return format == VK::ReadbackFormat::RGB8 ? 3 : 4;
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  create the readback ring
+
+\param extent
+  Size of the color image that will be captured
+
+\param format
+  Format of the color image that will be captured
+
+\param desc
+  Ring size, copy layout and output format
+
+\param callback
+  Receives every completed frame, slotCount frames after it was captured
+*/
+/****************************************************************************/
+void VK::Readback::Create(VK::Device& device, VK::CommandPool& commandPool, VkExtent2D extent, VkFormat format,
+    const ReadbackDesc& desc, ReadbackCallback callback)
+{
+    if (desc.format != ReadbackFormat::Native && !IsRGBA8(format) && !IsBGRA8(format))
+    {
+        DEBUG::log.Error("Readback::Create: format conversion needs an 8 bit RGBA or BGRA source!");
+        throw std::invalid_argument("format conversion needs an 8 bit RGBA or BGRA source!");
+    }
+
+    mDesc = desc;
+    mDesc.slotCount = std::max(desc.slotCount, 1u);
+    mDesc.tileSize = std::max(desc.tileSize, 1u);
+    mCallback = callback;
+    mExtent = extent;
+    mFormat = format;
+    mNextSlot = 0;
+    mFrame = 0;
+
+    // describe the copy once, it is the same every frame
+    const VkDeviceSize pixelSize = 4;
+    mRegions.clear();
+    if (mDesc.copy == ReadbackCopy::Tiled)
+    {
+        uint32_t tile = mDesc.tileSize;
+        uint32_t tilesX = (extent.width + tile - 1) / tile;
+        uint32_t tilesY = (extent.height + tile - 1) / tile;
+        VkDeviceSize tileBytes = VkDeviceSize(tile) * tile * pixelSize;
+
+        for (uint32_t y = 0; y < tilesY; ++y)
+        {
+            for (uint32_t x = 0; x < tilesX; ++x)
+            {
+                VkBufferImageCopy region = {};
+                region.bufferOffset = (VkDeviceSize(y) * tilesX + x) * tileBytes;
+                region.bufferRowLength = tile;
+                region.bufferImageHeight = tile;
+                region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+                region.imageOffset = { int32_t(x * tile), int32_t(y * tile), 0 };
+                region.imageExtent = { std::min(tile, extent.width - x * tile), std::min(tile, extent.height - y * tile), 1 };
+                mRegions.push_back(region);
+            }
+        }
+
+        mSize = VkDeviceSize(tilesX) * tilesY * tileBytes;
+    }
+    else
+    {
+        VkBufferImageCopy region = {};
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageExtent = { extent.width, extent.height, 1 };
+        mRegions.push_back(region);
+
+        mSize = VkDeviceSize(extent.width) * extent.height * pixelSize;
+    }
+
+    // prefer cached memory so the CPU reads are not uncached
+    VkMemoryPropertyFlags memFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    if (!HasMemoryType(device, memFlags))
+    {
+        memFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    }
+    mCoherent = (memFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = mSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    mSlots.resize(mDesc.slotCount);
+    for (auto& slot : mSlots)
+    {
+        slot.buffer.Create(device, bufferInfo, memFlags);
+        slot.fence.Create(device, fenceInfo);
+
+        // stays mapped for the lifetime of the ring
+        void* data = nullptr;
+        slot.buffer.Map(device, size_t(mSize), &data);
+        slot.mapped = static_cast<uint8_t*>(data);
+        slot.pending = false;
+    }
+
+    mCommandBuffers.Create(device, commandPool, mDesc.slotCount);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, frames still in flight are dropped
+*/
+/****************************************************************************/
+void VK::Readback::ShutDown(VK::Device& device, VK::CommandPool& commandPool)
+{
+    if (mSlots.empty())
+        return;
+
+    for (auto& slot : mSlots)
+    {
+        slot.buffer.UnMap(device);
+        slot.buffer.ShutDown(device);
+        slot.fence.ShutDown(device);
+    }
+    mSlots.clear();
+
+    mCommandBuffers.ShutDown(device, commandPool);
+    mCommandBuffers.clear();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  copy a rendered image into the next slot of the ring
+
+  Submitted after the frame on the same queue, so it is ordered behind the
+  rendering. When presenting, the render finished semaphore must be signaled
+  here instead of by the frame so present waits for the copy too.
+
+\param image
+  The final color image
+
+\param layout
+  The layout the frame left the image in, it is restored after the copy
+
+\param signalSemaphore
+  Optional semaphore to signal once the copy is done
+*/
+/****************************************************************************/
+void VK::Readback::Capture(VK::Device& device, VkQueue queue, VkImage image, VkImageLayout layout, VkSemaphore signalSemaphore)
+{
+    // hand finished frames to the consumer
+    Poll(device);
+
+    // only blocks if the consumer fell a full ring behind the GPU
+    Slot& slot = mSlots[mNextSlot];
+    if (slot.pending)
+    {
+        vkWaitForFences(device.Get(), 1, slot.fence.GetPointerTo(), VK_TRUE, UINT64_MAX);
+        Deliver(device, slot);
+    }
+
+    Record(mNextSlot, image, layout);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &mCommandBuffers[mNextSlot];
+    submitInfo.signalSemaphoreCount = signalSemaphore != VK_NULL_HANDLE ? 1 : 0;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+
+    vkResetFences(device.Get(), 1, slot.fence.GetPointerTo());
+    if (vkQueueSubmit(queue, 1, &submitInfo, slot.fence.Get()) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("Readback::Capture: failed to submit readback command buffer!");
+        throw std::runtime_error("failed to submit readback command buffer!");
+    }
+
+    slot.frame = mFrame++;
+    slot.pending = true;
+    mNextSlot = (mNextSlot + 1) % unsigned(mSlots.size());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  deliver every completed frame, oldest first, without waiting
+*/
+/****************************************************************************/
+void VK::Readback::Poll(VK::Device& device)
+{
+    // mNextSlot is the oldest capture
+    for (size_t i = 0; i < mSlots.size(); ++i)
+    {
+        Slot& slot = mSlots[(mNextSlot + i) % mSlots.size()];
+        if (!slot.pending)
+            continue;
+
+        if (vkGetFenceStatus(device.Get(), slot.fence.Get()) != VK_SUCCESS)
+            break;
+
+        Deliver(device, slot);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  wait for and deliver every frame still in flight
+*/
+/****************************************************************************/
+void VK::Readback::Flush(VK::Device& device)
+{
+    for (size_t i = 0; i < mSlots.size(); ++i)
+    {
+        Slot& slot = mSlots[(mNextSlot + i) % mSlots.size()];
+        if (!slot.pending)
+            continue;
+
+        vkWaitForFences(device.Get(), 1, slot.fence.GetPointerTo(), VK_TRUE, UINT64_MAX);
+        Deliver(device, slot);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  is the ring created
+*/
+/****************************************************************************/
+bool VK::Readback::IsActive() const
+{
+    return !mSlots.empty();
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  record the image to buffer copy for a slot
+*/
+/****************************************************************************/
+void VK::Readback::Record(unsigned i, VkImage image, VkImageLayout layout)
+{
+    VkCommandBuffer cmd = mCommandBuffers[i];
+    vkResetCommandBuffer(cmd, 0);
+    mCommandBuffers.Begin(i);
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = layout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mSlots[i].buffer.Get(),
+        uint32_t(mRegions.size()), mRegions.data());
+
+    // give the image back in the layout the frame left it in
+    if (layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+    {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = layout;
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    // make the copy visible to the host
+    VkBufferMemoryBarrier bufferBarrier = {};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = mSlots[i].buffer.Get();
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+    mCommandBuffers.EndRT(i);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  convert a finished slot if requested and pass it to the consumer
+*/
+/****************************************************************************/
+void VK::Readback::Deliver(VK::Device& device, Slot& slot)
+{
+    slot.pending = false;
+
+    if (!mCoherent)
+    {
+        VkMappedMemoryRange range = {};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = slot.buffer.GetMemory();
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+        vkInvalidateMappedMemoryRanges(device.Get(), 1, &range);
+    }
+
+    ReadbackFrame frame;
+    frame.frame = slot.frame;
+    frame.width = mExtent.width;
+    frame.height = mExtent.height;
+    frame.format = mDesc.format;
+
+    if (mDesc.format == ReadbackFormat::Native)
+    {
+        frame.tileSize = mDesc.copy == ReadbackCopy::Tiled ? mDesc.tileSize : 0;
+        frame.data = slot.mapped;
+        frame.size = size_t(mSize);
+    }
+    else
+    {
+        // swizzle and untile into a linear image
+        size_t outPixel = PixelSize(mDesc.format);
+        mConverted.resize(size_t(mExtent.width) * mExtent.height * outPixel);
+
+        bool srcBGRA = IsBGRA8(mFormat);
+        bool dstBGRA = mDesc.format == ReadbackFormat::BGRA8;
+        bool swap = srcBGRA != dstBGRA;
+        bool tiled = mDesc.copy == ReadbackCopy::Tiled;
+        uint32_t tile = mDesc.tileSize;
+        uint32_t tilesX = (mExtent.width + tile - 1) / tile;
+
+        for (uint32_t y = 0; y < mExtent.height; ++y)
+        {
+            for (uint32_t x = 0; x < mExtent.width; ++x)
+            {
+                size_t srcIndex = size_t(y) * mExtent.width + x;
+                if (tiled)
+                {
+                    size_t tileIndex = size_t(y / tile) * tilesX + x / tile;
+                    srcIndex = tileIndex * tile * tile + size_t(y % tile) * tile + x % tile;
+                }
+
+                const uint8_t* src = slot.mapped + srcIndex * 4;
+                uint8_t* dst = mConverted.data() + (size_t(y) * mExtent.width + x) * outPixel;
+
+                dst[0] = swap ? src[2] : src[0];
+                dst[1] = src[1];
+                dst[2] = swap ? src[0] : src[2];
+                if (outPixel == 4)
+                {
+                    dst[3] = src[3];
+                }
+            }
+        }
+
+        frame.data = mConverted.data();
+        frame.size = mConverted.size();
+    }
+
+    if (mCallback)
+    {
+        mCallback(frame);
+    }
+}
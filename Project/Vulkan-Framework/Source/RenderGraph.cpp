@@ -0,0 +1,1070 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "RenderGraph.hpp"
+#include <algorithm>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace VK
+{
+    static const VkAccessFlags WriteAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Only writes have to be made available, reads just have to finish
+    */
+    /****************************************************************************/
+    static VkAccessFlags AvailableAccess(VkAccessFlags access, bool written)
+    {
+        return written ? (access & WriteAccess) : 0;
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  The pass renders into this image
+*/
+/****************************************************************************/
+void VK::RenderGraph::PassBuilder::WriteColor(RenderGraphResource resource)
+{
+    Use(resource, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, true);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  The pass depth tests against and writes this image
+*/
+/****************************************************************************/
+void VK::RenderGraph::PassBuilder::WriteDepth(RenderGraphResource resource)
+{
+    Use(resource, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, true);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  The pass depth tests against this image without writing it
+*/
+/****************************************************************************/
+void VK::RenderGraph::PassBuilder::ReadDepth(RenderGraphResource resource)
+{
+    Use(resource, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false, true);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  The pass samples this image in its shaders
+*/
+/****************************************************************************/
+void VK::RenderGraph::PassBuilder::ReadTexture(RenderGraphResource resource)
+{
+    Use(resource, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false, false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  The pass copies or blits from this image
+*/
+/****************************************************************************/
+void VK::RenderGraph::PassBuilder::ReadTransfer(RenderGraphResource resource)
+{
+    Use(resource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false, false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  The pass copies, blits or clears into this image
+*/
+/****************************************************************************/
+void VK::RenderGraph::PassBuilder::WriteTransfer(RenderGraphResource resource)
+{
+    Use(resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true, false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  The pass does something outside of the graph, never cull it
+*/
+/****************************************************************************/
+void VK::RenderGraph::PassBuilder::SideEffect()
+{
+    mGraph.mPasses[mPass].sideEffect = true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Declare an image the graph owns, it only lives as long as the passes
+  using it and may share memory with other transient images
+
+\return
+  Handle to use in the pass setup
+*/
+/****************************************************************************/
+VK::RenderGraphResource VK::RenderGraph::CreateImage(const std::string& name, const RenderGraphImageDesc& desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    mResources.push_back(resource);
+
+    return RenderGraphResource(mResources.size() - 1);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Declare an image owned outside of the graph, its contents are kept
+  and it is left in finalLayout at the end of the graph
+
+\param images
+  The image per swap chain image, Execute picks one with its image index
+
+\param views
+  A view of each image
+
+\return
+  Handle to use in the pass setup
+*/
+/****************************************************************************/
+VK::RenderGraphResource VK::RenderGraph::ImportImage(const std::string& name, const std::vector<VkImage>& images, const std::vector<VkImageView>& views,
+    VkFormat format, VkExtent2D extent, VkImageLayout finalLayout, VkClearValue clear)
+{
+    if (images.empty() || images.size() != views.size())
+    {
+        DEBUG::log.Error("RenderGraph::ImportImage: ", name, " needs one view per image!");
+        throw std::invalid_argument("imported images need one view per image!");
+    }
+
+    Resource resource;
+    resource.name = name;
+    resource.desc.format = format;
+    resource.desc.extent = extent;
+    resource.desc.clear = clear;
+    resource.finalLayout = finalLayout;
+    resource.imported = true;
+    resource.images = images;
+    resource.views = views;
+    mResources.push_back(resource);
+
+    return RenderGraphResource(mResources.size() - 1);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Add a pass, passes run in the order they are added
+
+\param setup
+  Called right away to declare what the pass reads and writes
+
+\param execute
+  Records the pass, called from Execute inside the pass's render pass
+
+\return
+  Index of the pass
+*/
+/****************************************************************************/
+unsigned VK::RenderGraph::AddPass(const std::string& name, SetupFunc setup, ExecuteFunc execute)
+{
+    Pass pass;
+    pass.name = name;
+    pass.execute = execute;
+    mPasses.push_back(pass);
+
+    unsigned index = unsigned(mPasses.size() - 1);
+    PassBuilder builder(*this, index);
+    setup(builder);
+
+    return index;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Turn the declared passes into render passes, framebuffers, barriers
+  and memory
+
+\param extent
+  Size of images declared without one
+*/
+/****************************************************************************/
+void VK::RenderGraph::Compile(VK::Device& device, VkExtent2D extent)
+{
+    mStats = RenderGraphStats();
+    mStats.passes = unsigned(mPasses.size());
+    mDynamicRendering = device.DynamicRendering() ? &device : nullptr;
+
+    CullPasses();
+    CreateTransients(device, extent);
+    AliasTransients(device);
+    CreatePasses(device, extent);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record every pass that survived culling
+
+\param imageIndex
+  Which image of the imported resources to use
+
+\param profiler
+  Times each pass, barriers included, in a scope named after it
+*/
+/****************************************************************************/
+void VK::RenderGraph::Execute(VkCommandBuffer commandBuffer, uint32_t imageIndex, VK::GpuProfiler* profiler)
+{
+    for (Pass& pass : mPasses)
+    {
+        if (pass.culled)
+            continue;
+
+        if (profiler)
+        {
+            profiler->BeginScope(commandBuffer, imageIndex, pass.name);
+        }
+
+        FlushBarriers(commandBuffer, imageIndex, pass.barriers, pass.srcStage, pass.dstStage);
+
+        if (!pass.colorAttachments.empty() || !pass.depthAttachment.empty())
+        {
+            BeginRendering(commandBuffer, imageIndex, pass);
+            pass.execute(commandBuffer, imageIndex);
+            mDynamicRendering->CmdEndRendering(commandBuffer);
+        }
+        else if (pass.renderPass.Get() == VK_NULL_HANDLE)
+        {
+            pass.execute(commandBuffer, imageIndex);
+        }
+        else
+        {
+            VkRenderPassBeginInfo renderPassInfo = {};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = pass.renderPass.Get();
+            renderPassInfo.framebuffer = pass.frameBuffers[imageIndex % pass.frameBuffers.size()].Get();
+            renderPassInfo.renderArea.offset = { 0, 0 };
+            renderPassInfo.renderArea.extent = pass.renderArea.width > 0 ? pass.renderArea : pass.extent;
+            renderPassInfo.clearValueCount = uint32_t(pass.clears.size());
+            renderPassInfo.pClearValues = pass.clears.data();
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            pass.execute(commandBuffer, imageIndex);
+            vkCmdEndRenderPass(commandBuffer);
+        }
+
+        if (profiler)
+        {
+            profiler->EndScope(commandBuffer, imageIndex);
+        }
+    }
+
+    FlushBarriers(commandBuffer, imageIndex, mFinalBarriers, mFinalSrcStage, mFinalDstStage);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Destroy everything Compile made and forget all passes and resources
+*/
+/****************************************************************************/
+void VK::RenderGraph::ShutDown(VK::Device& device)
+{
+    for (Pass& pass : mPasses)
+    {
+        for (VK::FrameBuffer& frameBuffer : pass.frameBuffers)
+        {
+            frameBuffer.ShutDown(device);
+        }
+        pass.renderPass.ShutDown(device);
+    }
+
+    for (Resource& resource : mResources)
+    {
+        if (resource.imported)
+            continue;
+
+        resource.ownedView.ShutDown(device);
+        for (VkImage image : resource.images)
+        {
+            vkDestroyImage(device.Get(), image, nullptr);
+        }
+    }
+
+    for (Block& block : mBlocks)
+    {
+        vkFreeMemory(device.Get(), block.memory, nullptr);
+    }
+
+    mPasses.clear();
+    mResources.clear();
+    mBlocks.clear();
+    mFinalBarriers.clear();
+    mFinalSrcStage = 0;
+    mFinalDstStage = 0;
+    mStats = RenderGraphStats();
+    mDynamicRendering = nullptr;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Only render the top left corner of a pass's attachments, takes effect
+  the next time the pass is recorded
+
+\param extent
+  Size of the corner, 0 goes back to the whole attachment
+*/
+/****************************************************************************/
+void VK::RenderGraph::SetRenderArea(unsigned pass, VkExtent2D extent)
+{
+    Pass& target = mPasses[pass];
+    target.renderArea.width = std::min(extent.width, target.extent.width);
+    target.renderArea.height = std::min(extent.height, target.extent.height);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the render pass pipelines drawn in a pass must be made for, it has
+  no handle with dynamic rendering and the pipelines are made for the
+  attachment formats instead
+*/
+/****************************************************************************/
+VK::RenderPass& VK::RenderGraph::GetRenderPass(unsigned pass)
+{
+    return mPasses[pass].renderPass;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the image of a resource, transient images only exist after Compile
+*/
+/****************************************************************************/
+VkImage VK::RenderGraph::GetImage(RenderGraphResource resource, uint32_t imageIndex) const
+{
+    const Resource& res = mResources[resource];
+    if (res.images.empty())
+        return VK_NULL_HANDLE;
+
+    return res.images[imageIndex % res.images.size()];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get a view of a resource, transient images only exist after Compile
+*/
+/****************************************************************************/
+VkImageView VK::RenderGraph::GetView(RenderGraphResource resource, uint32_t imageIndex) const
+{
+    const Resource& res = mResources[resource];
+    if (res.views.empty())
+        return VK_NULL_HANDLE;
+
+    return res.views[imageIndex % res.views.size()];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Was the pass dropped because nothing consumes what it writes
+*/
+/****************************************************************************/
+bool VK::RenderGraph::IsCulled(unsigned pass) const
+{
+    return mPasses[pass].culled;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get what the last Compile produced
+*/
+/****************************************************************************/
+const VK::RenderGraphStats& VK::RenderGraph::Stats() const
+{
+    return mStats;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Builder handed to a pass setup function
+*/
+/****************************************************************************/
+VK::RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph, unsigned pass) :
+    mGraph(graph),
+    mPass(pass)
+{
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record that the pass uses a resource in a layout
+*/
+/****************************************************************************/
+void VK::RenderGraph::PassBuilder::Use(RenderGraphResource resource, VkImageLayout layout, VkImageUsageFlags usage, bool write, bool attachment)
+{
+    if (resource >= mGraph.mResources.size())
+    {
+        DEBUG::log.Error("RenderGraph::PassBuilder::Use: unknown resource!");
+        throw std::invalid_argument("unknown render graph resource!");
+    }
+
+    Pass& pass = mGraph.mPasses[mPass];
+    for (const Access& access : pass.accesses)
+    {
+        if (access.resource == resource)
+        {
+            DEBUG::log.Error("RenderGraph::PassBuilder::Use: ", pass.name, " uses ", mGraph.mResources[resource].name, " twice!");
+            throw std::invalid_argument("a pass may only use a resource once!");
+        }
+    }
+
+    VK::LayoutUsage layoutUsage = VK::GetLayoutUsage(layout);
+
+    Access access;
+    access.resource = resource;
+    access.layout = layout;
+    access.stage = layoutUsage.stage;
+    access.access = write ? layoutUsage.access : (layoutUsage.access & ~VK::WriteAccess);
+    access.write = write;
+    access.attachment = attachment;
+    pass.accesses.push_back(access);
+
+    mGraph.mResources[resource].usage |= usage;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Walk the passes backwards keeping only the ones whose writes are
+  consumed by a later pass or leave the graph through an imported image.
+  Every writer before a kept writer is kept too, later writers load.
+*/
+/****************************************************************************/
+void VK::RenderGraph::CullPasses()
+{
+    std::vector<bool> needed(mResources.size(), false);
+    for (size_t i = 0; i < mResources.size(); ++i)
+    {
+        needed[i] = mResources[i].imported;
+    }
+
+    for (size_t i = mPasses.size(); i-- > 0;)
+    {
+        Pass& pass = mPasses[i];
+
+        bool keep = pass.sideEffect;
+        for (const Access& access : pass.accesses)
+        {
+            keep = keep || (access.write && needed[access.resource]);
+        }
+
+        pass.culled = !keep;
+        if (pass.culled)
+        {
+            ++mStats.culledPasses;
+            continue;
+        }
+
+        for (const Access& access : pass.accesses)
+        {
+            needed[access.resource] = true;
+        }
+    }
+
+    // lifetimes over the passes that are left
+    for (int i = 0; i < int(mPasses.size()); ++i)
+    {
+        if (mPasses[i].culled)
+            continue;
+
+        for (const Access& access : mPasses[i].accesses)
+        {
+            Resource& resource = mResources[access.resource];
+            if (resource.firstPass < 0)
+                resource.firstPass = i;
+            resource.lastPass = i;
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create the transient images that are used, memory is bound later
+*/
+/****************************************************************************/
+void VK::RenderGraph::CreateTransients(VK::Device& device, VkExtent2D extent)
+{
+    for (Resource& resource : mResources)
+    {
+        if (resource.imported || resource.firstPass < 0)
+            continue;
+
+        if (resource.desc.extent.width == 0 || resource.desc.extent.height == 0)
+        {
+            resource.desc.extent = extent;
+        }
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = resource.desc.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = resource.usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+        VkImage image = VK_NULL_HANDLE;
+        if (vkCreateImage(device.Get(), &imageInfo, nullptr, &image) != VK_SUCCESS)
+        {
+            DEBUG::log.Error("RenderGraph::CreateTransients: failed to create ", resource.name, "!");
+            throw std::runtime_error("failed to create transient image!");
+        }
+
+        resource.images = { image };
+        vkGetImageMemoryRequirements(device.Get(), image, &resource.requirements);
+
+        ++mStats.transientImages;
+        mStats.transientBytes += resource.requirements.size;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Pack the transient images into as few memory blocks as possible, images
+  share a block when their pass ranges do not overlap. Biggest first so the
+  small ones fill in behind them.
+*/
+/****************************************************************************/
+void VK::RenderGraph::AliasTransients(VK::Device& device)
+{
+    std::vector<RenderGraphResource> order;
+    for (size_t i = 0; i < mResources.size(); ++i)
+    {
+        if (!mResources[i].imported && mResources[i].firstPass >= 0)
+            order.push_back(RenderGraphResource(i));
+    }
+
+    std::sort(order.begin(), order.end(), [this](RenderGraphResource a, RenderGraphResource b)
+    {
+        return mResources[a].requirements.size > mResources[b].requirements.size;
+    });
+
+    for (RenderGraphResource index : order)
+    {
+        Resource& resource = mResources[index];
+
+        for (size_t b = 0; b < mBlocks.size() && resource.block < 0; ++b)
+        {
+            Block& block = mBlocks[b];
+            if ((block.typeBits & resource.requirements.memoryTypeBits) == 0)
+                continue;
+
+            bool overlaps = false;
+            for (RenderGraphResource other : block.residents)
+            {
+                const Resource& resident = mResources[other];
+                overlaps = overlaps || (resource.firstPass <= resident.lastPass && resident.firstPass <= resource.lastPass);
+            }
+
+            if (!overlaps)
+            {
+                resource.block = int(b);
+            }
+        }
+
+        if (resource.block < 0)
+        {
+            mBlocks.push_back(Block());
+            resource.block = int(mBlocks.size() - 1);
+        }
+
+        // everything is bound at offset 0, so the block just has to fit the biggest
+        Block& block = mBlocks[resource.block];
+        block.typeBits &= resource.requirements.memoryTypeBits;
+        block.size = std::max(block.size, resource.requirements.size);
+        block.residents.push_back(index);
+    }
+
+    for (Block& block : mBlocks)
+    {
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block.size;
+        allocInfo.memoryTypeIndex = device.GetMemoryType(block.typeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(device.Get(), &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+        {
+            DEBUG::log.Error("RenderGraph::AliasTransients: failed to allocate transient memory!");
+            throw std::runtime_error("failed to allocate transient memory!");
+        }
+
+        // residents in the order they come to life, used for the aliasing barriers
+        std::sort(block.residents.begin(), block.residents.end(), [this](RenderGraphResource a, RenderGraphResource b)
+        {
+            return mResources[a].firstPass < mResources[b].firstPass;
+        });
+
+        for (RenderGraphResource index : block.residents)
+        {
+            Resource& resource = mResources[index];
+            vkBindImageMemory(device.Get(), resource.images[0], block.memory, 0);
+
+            VkImageViewCreateInfo viewInfo = {};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = resource.images[0];
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.desc.format;
+            viewInfo.subresourceRange.aspectMask = VK::GetFormatAspect(resource.desc.format);
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+            resource.ownedView.Create(device, viewInfo);
+            resource.views = { resource.ownedView.Get() };
+        }
+
+        ++mStats.memoryBlocks;
+        mStats.allocatedBytes += block.size;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Build the render pass, framebuffers and barriers of every pass. Layout
+  changes of attachments happen inside the render pass through its
+  attachment layouts and external dependencies, only images sampled
+  in a pass need an explicit barrier. With dynamic rendering attachments
+  get barriers as well and imported images reach their final layout
+  after the last pass. The barriers of a pass are batched into one
+  vkCmdPipelineBarrier.
+*/
+/****************************************************************************/
+void VK::RenderGraph::CreatePasses(VK::Device& device, VkExtent2D extent)
+{
+    std::vector<State> states(mResources.size());
+    for (size_t i = 0; i < mResources.size(); ++i)
+    {
+        states[i] = StartState(RenderGraphResource(i));
+    }
+
+    for (int p = 0; p < int(mPasses.size()); ++p)
+    {
+        Pass& pass = mPasses[p];
+        if (pass.culled)
+            continue;
+
+        std::vector<VkAttachmentDescription> attachments;
+        std::vector<VkAttachmentReference> colorRefs;
+        VkAttachmentReference depthRef = {};
+        bool hasDepth = false;
+        std::vector<RenderGraphResource> attached;
+
+        VkSubpassDependency enter = {};
+        enter.srcSubpass = VK_SUBPASS_EXTERNAL;
+        enter.dstSubpass = 0;
+
+        VkSubpassDependency leave = {};
+        leave.srcSubpass = 0;
+        leave.dstSubpass = VK_SUBPASS_EXTERNAL;
+
+        pass.extent = extent;
+        for (const Access& access : pass.accesses)
+        {
+            Resource& resource = mResources[access.resource];
+            State& state = states[access.resource];
+            bool barrier = NeedsBarrier(state, access);
+
+            if (!access.attachment)
+            {
+                if (barrier)
+                {
+                    AddBarrier(pass, state, access);
+                }
+            }
+            else if (mDynamicRendering)
+            {
+                bool first = resource.firstPass == p;
+                bool last = resource.lastPass == p;
+
+                if (barrier)
+                {
+                    AddBarrier(pass, state, access);
+                }
+
+                RenderingAttachment attachment = {};
+                attachment.resource = access.resource;
+                attachment.layout = access.layout;
+                attachment.loadOp = first ? (access.write ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE) : VK_ATTACHMENT_LOAD_OP_LOAD;
+                attachment.storeOp = (last && !resource.imported) ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+                attachment.clear = resource.desc.clear;
+                attachment.stencil = (VK::GetFormatAspect(resource.desc.format) & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+
+                if (access.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+                {
+                    pass.colorAttachments.push_back(attachment);
+                }
+                else
+                {
+                    pass.depthAttachment.assign(1, attachment);
+                }
+                pass.extent = resource.desc.extent;
+            }
+            else
+            {
+                bool first = resource.firstPass == p;
+                bool last = resource.lastPass == p;
+
+                VkAttachmentDescription attachment = {};
+                attachment.format = resource.desc.format;
+                attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+                attachment.loadOp = first ? (access.write ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE) : VK_ATTACHMENT_LOAD_OP_LOAD;
+                attachment.storeOp = (last && !resource.imported) ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+                attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                if (VK::GetFormatAspect(resource.desc.format) & VK_IMAGE_ASPECT_STENCIL_BIT)
+                {
+                    attachment.stencilLoadOp = attachment.loadOp;
+                    attachment.stencilStoreOp = attachment.storeOp;
+                }
+                attachment.initialLayout = state.layout;
+                attachment.finalLayout = access.layout;
+
+                if (barrier)
+                {
+                    enter.srcStageMask |= state.stage;
+                    enter.srcAccessMask |= VK::AvailableAccess(state.access, state.written);
+                    enter.dstStageMask |= access.stage;
+                    enter.dstAccessMask |= access.access;
+                }
+
+                // the render pass leaves imported images in their final layout
+                if (last && resource.imported && resource.finalLayout != access.layout)
+                {
+                    VK::LayoutUsage after = VK::GetLayoutUsage(resource.finalLayout);
+                    attachment.finalLayout = resource.finalLayout;
+                    leave.srcStageMask |= access.stage;
+                    leave.srcAccessMask |= VK::AvailableAccess(access.access, access.write);
+                    leave.dstStageMask |= after.stage;
+                    leave.dstAccessMask |= after.access;
+                }
+
+                VkAttachmentReference reference = {};
+                reference.attachment = uint32_t(attachments.size());
+                reference.layout = access.layout;
+                if (access.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+                {
+                    colorRefs.push_back(reference);
+                }
+                else
+                {
+                    depthRef = reference;
+                    hasDepth = true;
+                }
+
+                attachments.push_back(attachment);
+                attached.push_back(access.resource);
+                pass.clears.push_back(resource.desc.clear);
+                pass.extent = resource.desc.extent;
+            }
+
+            // consecutive reads in one layout share a state, so the next writer waits for all of them
+            if (!barrier)
+            {
+                state.stage |= access.stage;
+                state.access |= access.access;
+            }
+            else
+            {
+                state = { access.layout, access.stage, access.access, access.write };
+            }
+
+            // the render pass did the final transition
+            if (access.attachment && resource.lastPass == p && resource.imported && !mDynamicRendering)
+            {
+                state.layout = resource.finalLayout;
+            }
+        }
+
+        mStats.barriers += unsigned(pass.barriers.size());
+
+        if (attachments.empty())
+            continue;
+
+        VkSubpassDescription subpass = {};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = uint32_t(colorRefs.size());
+        subpass.pColorAttachments = colorRefs.data();
+        subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+        // an empty source scope still has to wait for whatever the image was before
+        if (enter.srcStageMask == 0)
+        {
+            enter.srcStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        }
+        if (enter.dstStageMask == 0)
+        {
+            enter.dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        }
+
+        std::vector<VkSubpassDependency> dependencies = { enter };
+        if (leave.srcStageMask != 0)
+        {
+            dependencies.push_back(leave);
+        }
+
+        VkRenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = uint32_t(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = uint32_t(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+        pass.renderPass.Create(device, renderPassInfo);
+
+        // one framebuffer per image of the imported attachments
+        size_t variants = 1;
+        for (RenderGraphResource resource : attached)
+        {
+            variants = std::max(variants, mResources[resource].views.size());
+        }
+
+        pass.frameBuffers.resize(variants);
+        for (size_t v = 0; v < variants; ++v)
+        {
+            std::vector<VkImageView> views;
+            for (RenderGraphResource resource : attached)
+            {
+                views.push_back(GetView(resource, uint32_t(v)));
+            }
+
+            VkFramebufferCreateInfo framebufferInfo = {};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = pass.renderPass.Get();
+            framebufferInfo.attachmentCount = uint32_t(views.size());
+            framebufferInfo.pAttachments = views.data();
+            framebufferInfo.width = pass.extent.width;
+            framebufferInfo.height = pass.extent.height;
+            framebufferInfo.layers = 1;
+            pass.frameBuffers[v].Create(device, framebufferInfo);
+        }
+    }
+
+    // imported images no render pass left in their final layout
+    for (size_t i = 0; i < mResources.size(); ++i)
+    {
+        const Resource& resource = mResources[i];
+        const State& state = states[i];
+        if (!resource.imported || resource.firstPass < 0 || state.layout == resource.finalLayout)
+            continue;
+
+        VK::LayoutUsage after = VK::GetLayoutUsage(resource.finalLayout);
+
+        VkImageMemoryBarrier imageBarrier = {};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = VK::AvailableAccess(state.access, state.written);
+        imageBarrier.dstAccessMask = after.access;
+        imageBarrier.oldLayout = state.layout;
+        imageBarrier.newLayout = resource.finalLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.subresourceRange = { VK::GetFormatAspect(resource.desc.format), 0, 1, 0, 1 };
+
+        mFinalBarriers.push_back({ RenderGraphResource(i), imageBarrier });
+        mFinalSrcStage |= state.stage;
+        mFinalDstStage |= after.stage;
+    }
+
+    mStats.barriers += unsigned(mFinalBarriers.size());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  What a resource looks like before its first pass of the frame. Imported
+  images come from the acquire semaphore, which is waited on at color
+  output. Transient images inherit the last use of whatever had their
+  memory before them, the previous frame for the first one in a block.
+*/
+/****************************************************************************/
+VK::RenderGraph::State VK::RenderGraph::StartState(RenderGraphResource resource) const
+{
+    const Resource& res = mResources[resource];
+    if (res.imported || res.block < 0)
+        return { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, false };
+
+    const std::vector<RenderGraphResource>& residents = mBlocks[res.block].residents;
+    size_t slot = std::find(residents.begin(), residents.end(), resource) - residents.begin();
+    RenderGraphResource previous = residents[(slot + residents.size() - 1) % residents.size()];
+
+    State state = EndState(previous);
+    state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    state.written = true;
+    return state;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  What a resource looks like after its last pass
+*/
+/****************************************************************************/
+VK::RenderGraph::State VK::RenderGraph::EndState(RenderGraphResource resource) const
+{
+    const Resource& res = mResources[resource];
+    for (const Access& access : mPasses[res.lastPass].accesses)
+    {
+        if (access.resource == resource)
+            return { access.layout, access.stage, access.access, access.write };
+    }
+
+    return { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, false };
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Reads after reads in the same layout are the only accesses that do not
+  need a dependency
+*/
+/****************************************************************************/
+bool VK::RenderGraph::NeedsBarrier(const State& state, const Access& access) const
+{
+    return state.layout != access.layout || state.written || access.write;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Move an image from its last use to the next one before a pass
+*/
+/****************************************************************************/
+void VK::RenderGraph::AddBarrier(Pass& pass, const State& state, const Access& access)
+{
+    const Resource& resource = mResources[access.resource];
+
+    VkImageMemoryBarrier imageBarrier = {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = VK::AvailableAccess(state.access, state.written);
+    imageBarrier.dstAccessMask = access.access;
+    imageBarrier.oldLayout = state.layout;
+    imageBarrier.newLayout = access.layout;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.subresourceRange = { VK::GetFormatAspect(resource.desc.format), 0, 1, 0, 1 };
+
+    pass.barriers.push_back({ access.resource, imageBarrier });
+    pass.srcStage |= state.stage;
+    pass.dstStage |= access.stage;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Begin dynamic rendering into the attachment views of a pass
+*/
+/****************************************************************************/
+void VK::RenderGraph::BeginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, const Pass& pass)
+{
+    // color first, the depth attachment goes last so the pointers stay valid
+    mAttachmentScratch.clear();
+    for (const std::vector<RenderingAttachment>* list : { &pass.colorAttachments, &pass.depthAttachment })
+    {
+        for (const RenderingAttachment& attachment : *list)
+        {
+            VkRenderingAttachmentInfoKHR info = {};
+            info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+            info.imageView = GetView(attachment.resource, imageIndex);
+            info.imageLayout = attachment.layout;
+            info.resolveMode = VK_RESOLVE_MODE_NONE;
+            info.loadOp = attachment.loadOp;
+            info.storeOp = attachment.storeOp;
+            info.clearValue = attachment.clear;
+            mAttachmentScratch.push_back(info);
+        }
+    }
+
+    const VkRenderingAttachmentInfoKHR* depth = pass.depthAttachment.empty() ? nullptr : &mAttachmentScratch.back();
+
+    VkRenderingInfoKHR renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.renderArea.offset = { 0, 0 };
+    renderingInfo.renderArea.extent = pass.renderArea.width > 0 ? pass.renderArea : pass.extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = uint32_t(pass.colorAttachments.size());
+    renderingInfo.pColorAttachments = mAttachmentScratch.data();
+    renderingInfo.pDepthAttachment = depth;
+    renderingInfo.pStencilAttachment = (depth && pass.depthAttachment[0].stencil) ? depth : nullptr;
+
+    mDynamicRendering->CmdBeginRendering(commandBuffer, renderingInfo);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a batch of image barriers with one vkCmdPipelineBarrier
+*/
+/****************************************************************************/
+void VK::RenderGraph::FlushBarriers(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::vector<Barrier>& barriers,
+    VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+    if (barriers.empty())
+        return;
+
+    mScratch.clear();
+    for (const Barrier& barrier : barriers)
+    {
+        const Resource& resource = mResources[barrier.resource];
+        mScratch.push_back(barrier.barrier);
+        mScratch.back().image = resource.images[imageIndex % resource.images.size()];
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, uint32_t(mScratch.size()), mScratch.data());
+}
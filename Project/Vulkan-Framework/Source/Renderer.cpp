@@ -13,6 +13,7 @@
 
 #include "VULKANPCH.hpp"
 #include "Renderer.hpp"
+#include "CpuProfiler.hpp"
 #include <array>
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -39,30 +40,6 @@ namespace VK {
     {
         DEBUG::log.Error("GLFW Error ", error, " : ", description);
     }
-
-    /****************************************************************************/
-    /*!
-    \brief
-      Called when our window gets resized,
-      signal the renderer to resize its buffers
-
-    \param window
-      The window that got resized
-
-    \param width
-      The new width
-
-    \param height
-      The new height
-    */
-    /****************************************************************************/
-    static void FramebufferResizeCallback(WindowPtr window, int width, int height)
-    {
-        VK::Renderer* renderer = reinterpret_cast<VK::Renderer*>(glfwGetWindowUserPointer(window));
-        renderer->mFramebufferResized = true;
-        renderer->mWindowWidth = width;
-        renderer->mWindowHeight = height;
-    }
 }
 
 /*============================================================================*\
@@ -73,27 +50,35 @@ namespace VK {
 /*!
 \brief
   Initialize the renderer
+
+\param config
+  Frames in flight and swap chain settings
 */
 /****************************************************************************/
-VK::Renderer::Renderer()
+VK::Renderer::Renderer(const RendererConfig& config) :
+    mConfig(config),
+    mPendingConfig(config)
 {
+    mMaxFramesInFlight = std::clamp(mConfig.framesInFlight, 1u, 4u);
+    mConfig.framesInFlight = mMaxFramesInFlight;
+    mPendingConfig = mConfig;
+
+    mFrameStats.Create(mConfig.frameStats);
+
+    // startup is part of the traced frames
+    if (mConfig.traceFrames > 0)
+    {
+        CpuProfiler::Start(mConfig.traceFrames);
+    }
+
     // Setup GLFW
-    InitGLFW();
+    if (!mConfig.headless)
+    {
+        InitGLFW();
+    }
 
     // Setup Vulkan
     InitVulkan();
-
-    // Camera
-    float y = -0.1f;
-    glm::vec3 position = { 0, y, 1 };
-    glm::vec3 up = { 0, 1, 0 };
-    float fov = 0.42173f;
-    float aspectRatio = float(mWindowWidth) / mWindowHeight;
-    float nearPlane = 0.1f;
-    float farPlane = 250.f;
-
-    mMatrixBufferData.proj = glm::perspective(fov, aspectRatio, nearPlane, farPlane);
-    mMatrixBufferData.view = glm::lookAt(position, glm::vec3(0.0f, y, 0.0f), up);
 }
 
 /****************************************************************************/
@@ -110,27 +95,115 @@ VK::Renderer::~Renderer()
     ShutdownVulkan();
 
     // All GLFW related clean up
-    ShutdownGLFW();
+    if (!mConfig.headless)
+    {
+        ShutdownGLFW();
+    }
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Render
+  Render a frame packet into every target, may be called from a thread
+  other than the one polling window events
+
+\param packet
+  Camera and draw list produced by the simulation
+*/
+/****************************************************************************/
+void VK::Renderer::Draw(const FramePacket& packet)
+{
+    // a frame lasts from one draw to the next, the first has nothing to
+    // be measured against
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (mDrawn)
+    {
+        VK::FrameSample sample;
+        sample.cpuMs = std::chrono::duration<float, std::milli>(now - mLastDraw).count();
+        sample.gpuMs = mMainTarget->GpuFrameTime();
+        sample.waitMs = mFrameWaitMs;
+        mFrameStats.Add(sample);
+    }
+    mLastDraw = now;
+    mDrawn = true;
+
+    mFrameScene.matrices.view = packet.view;
+    mFrameScene.matrices.proj = packet.proj;
+    mFrameScene.matrices.world = glm::mat4(1);
+
+    if (GpuCulling())
+    {
+        // every draw goes to the GPU, which culls them itself. The targets
+        // keep the objects, so only those that changed are passed on, or
+        // all of them when the scene changed size.
+        uint32_t count = uint32_t(packet.draws.size());
+        mFrameScene.changed.clear();
+        if (mFrameScene.objects.size() != count)
+        {
+            mFrameScene.objects.resize(count);
+            for (uint32_t i = 0; i < count; ++i)
+                mFrameScene.changed.push_back(i);
+        }
+        else
+        {
+            mFrameScene.changed = packet.changed;
+        }
+
+        for (uint32_t i : mFrameScene.changed)
+        {
+            VK::GpuObject& object = mFrameScene.objects[i];
+            object.world = packet.draws[i].world;
+            object.SetBounds(mMesh.LocalBounds());
+            object.indexCount = mMesh.IndexCount();
+        }
+    }
+    else
+    {
+        // the packet only holds draws that survived culling, sorted so each
+        // batch is a run of them
+        mFrameScene.batches = packet.batches;
+        mFrameScene.instances.resize(packet.draws.size());
+        for (size_t i = 0; i < packet.draws.size(); ++i)
+        {
+            mFrameScene.instances[i] = packet.draws[i].world;
+        }
+    }
 
-\param dt
-  Delta-Time
+    DrawFrame(packet.dt);
+
+    if (CpuProfiler::Frame() && mConfig.traceFrames > 0)
+    {
+        CpuProfiler::WriteTrace(mConfig.tracePath);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Process window events and close the extra windows the user closed,
+  must be called from the thread that made the windows
 */
 /****************************************************************************/
-void VK::Renderer::Draw(float dt)
+void VK::Renderer::PollEvents()
 {
-    static float mAngle = 0;
-    mAngle -= dt;
-    mMatrixBufferData.world = glm::mat4(1);
-    mMatrixBufferData.world = glm::rotate(mMatrixBufferData.world, mAngle, { 0, 1, 0 });
+    if (mConfig.headless)
+        return;
 
     glfwPollEvents();
-    DrawFrame(dt);
+    mAspectRatio = mMainTarget->AspectRatio();
+
+    // the main window closing is left to the application, the list only
+    // changes on this thread so it can be read without the lock
+    for (size_t i = mTargets.size(); i-- > 1;)
+    {
+        if (mTargets[i]->ShouldClose())
+        {
+            std::lock_guard<std::mutex> lock(mTargetMutex);
+            WaitIdle();
+            mTargets[i]->ShutDown(mInstance, mDevice, mCommandPool);
+            mTargets.erase(mTargets.begin() + i);
+        }
+    }
 }
 
 /****************************************************************************/
@@ -147,492 +220,744 @@ void VK::Renderer::WaitIdle() const
 /****************************************************************************/
 /*!
 \brief
-  Get the application window
+  Get the width / height of the main window, updated by PollEvents and
+  ResizeTarget, safe to call from any thread
+*/
+/****************************************************************************/
+float VK::Renderer::AspectRatio() const
+{
+    return mAspectRatio;
+}
 
-\return
-  Pointer to the window
+/****************************************************************************/
+/*!
+\brief
+  Request new renderer settings, they are applied at the start of the next
+  frame and only rebuild what the change requires
 
+\param config
+  The new settings
 */
 /****************************************************************************/
-WindowPtr VK::Renderer::Window() const
+void VK::Renderer::SetConfig(const RendererConfig& config)
 {
-    return mWindow;
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mPendingConfig = config;
+    mPendingConfig.framesInFlight = std::clamp(config.framesInFlight, 1u, 4u);
+
+    // creation time only
+    mPendingConfig.headless = mConfig.headless;
+    mPendingConfig.width = mConfig.width;
+    mPendingConfig.height = mConfig.height;
+    mPendingConfig.shaderCacheDirectory = mConfig.shaderCacheDirectory;
+    mPendingConfig.dynamicRendering = mConfig.dynamicRendering;
+    mPendingConfig.gpuCulling = mConfig.gpuCulling;
+    mPendingConfig.gpuObjectCapacity = mConfig.gpuObjectCapacity;
+    mPendingConfig.occlusionCulling = mConfig.occlusionCulling;
+    mPendingConfig.gpuProfiling = mConfig.gpuProfiling;
+    mPendingConfig.frameStats = mConfig.frameStats;
+    mConfigChanged = true;
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Get the vulkan device
+  Get the active renderer settings
 */
 /****************************************************************************/
-VK::Device VK::Renderer::Device() const
+const VK::RendererConfig& VK::Renderer::Config() const
 {
-    return mDevice;
+    return mConfig;
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Get the main commandpool
+  Copy every frame of the main target back to the CPU. Frames reach the
+  callback desc.slotCount frames after they were drawn, without stalling.
+
+\param desc
+  Ring size, copy layout and output format
+
+\param callback
+  Called from Draw with each completed frame, the data is only valid
+  for the duration of the call
 */
 /****************************************************************************/
-VK::CommandPool VK::Renderer::CommandPool() const
+void VK::Renderer::EnableReadback(const ReadbackDesc& desc, ReadbackCallback callback)
 {
-    return mCommandPool;
+    DisableReadback();
+
+    mReadbackDesc = desc;
+    mReadbackCallback = callback;
+    mReadbackEnabled = true;
+    InitReadback();
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Get the graphics VkQueue
+  Stop reading frames back, frames still in flight are delivered first
 */
 /****************************************************************************/
-VkQueue VK::Renderer::GraphicsQueue() const
+void VK::Renderer::DisableReadback()
 {
-    return mGraphicsQueue;
-}
+    if (!mReadbackEnabled)
+        return;
 
-/*============================================================================*\
-|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
-\*============================================================================*/
+    WaitIdle();
+    mReadback.Flush(mDevice);
+    mReadback.ShutDown(mDevice, mCommandPool);
+    mReadbackEnabled = false;
+}
 
 /****************************************************************************/
 /*!
 \brief
-  Initialize GLFW
+  Add a window or headless target drawn every frame next to the main one.
+  It shares the device, command pool and assets and is submitted and
+  presented together with the other targets. Windows must be added from
+  the thread that polls events, and only to a renderer that has a window.
+
+\return
+  Index of the target
 */
 /****************************************************************************/
-void VK::Renderer::InitGLFW()
+unsigned VK::Renderer::AddTarget(const PresentTargetDesc& desc)
 {
-    glfwSetErrorCallback(VK::GLFWErrorCallback);
-    if (!glfwInit())
+    if (!desc.headless && mConfig.headless)
     {
-        throw std::runtime_error("GLFW: glfwInit() failed! Check error callback!\n");
+        DEBUG::log.Error("Renderer::AddTarget: a headless renderer can not open windows!");
+        throw std::runtime_error("a headless renderer can not open windows!");
+    }
+
+    std::unique_ptr<VK::PresentTarget> target = std::make_unique<VK::PresentTarget>();
+    target->OpenWindow(mInstance, desc);
+
+    if (!desc.headless && !mDevice.SupportsPresent(target->GetSurface()))
+    {
+        target->ShutDown(mInstance, mDevice, mCommandPool);
+        DEBUG::log.Error("Renderer::AddTarget: the device can not present to the new window!");
+        throw std::runtime_error("the device can not present to the new window!");
     }
 
-    // create the GLFW window
-    InitWindow();
+    std::lock_guard<std::mutex> lock(mTargetMutex);
+    target->Create(mDevice, mCommandPool, mPipelineCache, mMesh, mConfig);
+    mTargets.push_back(std::move(target));
+
+    return unsigned(mTargets.size() - 1);
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Create the application window
+  Remove a target added with AddTarget, later targets move down one index.
+  The main target can not be removed.
 */
 /****************************************************************************/
-void VK::Renderer::InitWindow()
+void VK::Renderer::RemoveTarget(unsigned target)
 {
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-    mWindow = glfwCreateWindow(mWindowWidth, mWindowHeight, "Vulkan-Framework", nullptr, nullptr);
-    glfwSetWindowUserPointer(mWindow, this);
-    glfwSetFramebufferSizeCallback(mWindow, VK::FramebufferResizeCallback);
+    std::lock_guard<std::mutex> lock(mTargetMutex);
+    if (target == 0 || target >= mTargets.size())
+    {
+        DEBUG::log.Error("Renderer::RemoveTarget: invalid target!");
+        throw std::invalid_argument("invalid target!");
+    }
+
+    WaitIdle();
+    mTargets[target]->ShutDown(mInstance, mDevice, mCommandPool);
+    mTargets.erase(mTargets.begin() + target);
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Initialize Vulkan
+  Resize a headless target, it is rebuilt before it renders again. Window
+  targets follow their window instead.
 */
 /****************************************************************************/
-void VK::Renderer::InitVulkan()
+void VK::Renderer::ResizeTarget(unsigned target, int width, int height)
 {
-    if (!glfwVulkanSupported())
+    std::lock_guard<std::mutex> lock(mTargetMutex);
+    if (target >= mTargets.size() || !mTargets[target]->IsHeadless() || width <= 0 || height <= 0)
     {
-        throw std::runtime_error("GLFW: Vulkan Not Supported\n");
+        DEBUG::log.Error("Renderer::ResizeTarget: invalid target or size!");
+        throw std::invalid_argument("invalid target or size!");
     }
 
-    mInstance.Create();
-    mDebugMessenger.Create(mInstance);
-    mSurface.Create(mInstance, mWindow);
-    mDevice.Create(mInstance, mSurface, mGraphicsQueue, mPresentQueue);
-
-    mSwapChain.Create(mSurface, mDevice, mWindow);
-    mCommandPool.Create(mDevice, mSurface);
-    mCommandBuffer.Create(mDevice, mCommandPool, unsigned(mSwapChain.Images()->size()));
-    InitSyncObjects();
-    InitRenderPass();
-    InitDepthResources();
-    InitFramebuffers();
-    InitPipelines();
-
-    UpdateCommandBuffers();
+    mTargets[target]->Resize(width, height);
+    if (target == 0)
+        mAspectRatio = mMainTarget->AspectRatio();
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Create Vulkan Semaphores and Fences
+  Get the number of targets, including the main one
 */
 /****************************************************************************/
-void VK::Renderer::InitSyncObjects()
+unsigned VK::Renderer::TargetCount() const
 {
-    mImageAvailableSemaphores.resize(mMaxFramesInFlight);
-    mRenderFinishedSemaphores.resize(mMaxFramesInFlight);
-    mInFlightFences.resize(mMaxFramesInFlight);
-    mImagesInFlight.resize(mSwapChain.Images()->size());
+    return unsigned(mTargets.size());
+}
 
-    VkSemaphoreCreateInfo semaphoreInfo = {};
-    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+/****************************************************************************/
+/*!
+\brief
+  Get the main application window
 
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+\return
+  Pointer to the window
 
-    for (size_t i = 0; i < mMaxFramesInFlight; ++i)
-    {
-        mImageAvailableSemaphores[i].Create(mDevice, semaphoreInfo);
-        mRenderFinishedSemaphores[i].Create(mDevice, semaphoreInfo);
-        mInFlightFences[i].Create(mDevice, fenceInfo);
-    }
+*/
+/****************************************************************************/
+WindowPtr VK::Renderer::Window() const
+{
+    return mMainTarget->Window();
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Create all renderpass
+  Get the vulkan device
 */
 /****************************************************************************/
-void VK::Renderer::InitRenderPass()
+VK::Device VK::Renderer::Device() const
 {
-    VkAttachmentDescription depthAttachment = {};
-    depthAttachment.format = FindDepthFormat();
-    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format = mSwapChain.Format();
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference depthAttachmentRef = {};
-    depthAttachmentRef.attachment = 1;
-    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    return mDevice;
+}
 
-    VkAttachmentReference colorAttachmentRef = {};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+/****************************************************************************/
+/*!
+\brief
+  Get the main commandpool
+*/
+/****************************************************************************/
+VK::CommandPool VK::Renderer::CommandPool() const
+{
+    return mCommandPool;
+}
 
-    VkSubpassDescription subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+/****************************************************************************/
+/*!
+\brief
+  Get the pipeline cache, for pending compiles and compile times
+*/
+/****************************************************************************/
+const VK::PipelineCache& VK::Renderer::PipelineCache() const
+{
+    return mPipelineCache;
+}
 
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+/****************************************************************************/
+/*!
+\brief
+  Get a mesh's model space bounds, the simulation culls with them
+*/
+/****************************************************************************/
+const VK::Bounds& VK::Renderer::MeshBounds(uint32_t mesh) const
+{
+    UNUSED(mesh);
+    return mMesh.LocalBounds();
+}
 
-    std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };;
-    VkRenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+/****************************************************************************/
+/*!
+\brief
+  Are draws culled on the GPU, the simulation then sends every draw. Safe
+  to call from any thread.
+*/
+/****************************************************************************/
+bool VK::Renderer::GpuCulling() const
+{
+    return mGpuCulling;
+}
 
-    mRenderPass.Create(mDevice, renderPassInfo);
+/****************************************************************************/
+/*!
+\brief
+  Get what the GPU culling of the main target did in a recent frame, safe
+  to call while another thread draws
+*/
+/****************************************************************************/
+VK::GpuCullingStats VK::Renderer::CullingStats() const
+{
+    std::lock_guard<std::mutex> lock(mTargetMutex);
+    return mMainTarget->CullingStats();
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Create depth textures
+  Get the rolling GPU times of the main target's frame and passes, safe
+  to call while another thread draws
 */
 /****************************************************************************/
-void VK::Renderer::InitDepthResources()
+std::vector<VK::GpuScopeStats> VK::Renderer::GpuScopes()
 {
-    VkFormat depthFormat = FindDepthFormat();
+    std::lock_guard<std::mutex> lock(mTargetMutex);
+    return mMainTarget->GpuScopes();
+}
 
-    mDepthTexture.Create(mDevice, mSwapChain.Extent().width, mSwapChain.Extent().height,
-        depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+/****************************************************************************/
+/*!
+\brief
+  Get the frame time percentiles and hitches of the recent frames, safe
+  to call while another thread draws
+*/
+/****************************************************************************/
+VK::FrameStatsReport VK::Renderer::FrameReport() const
+{
+    return mFrameStats.Report();
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Create all pipelines
+  Write the CPU, GPU and wait time of every frame kept as CSV, safe to
+  call while another thread draws
 */
 /****************************************************************************/
-void VK::Renderer::InitPipelines()
+bool VK::Renderer::WriteFrameCsv(const std::string& path) const
 {
-    mMesh.Create(mDevice, mCommandPool, mGraphicsQueue, "../Resource/Models/StanfordBunny.obj");
-    mMatrixBuffer.Create(mDevice, unsigned(mSwapChain.Images()->size()), sizeof(MatrixBuffer), VK_SHADER_STAGE_VERTEX_BIT);
+    return mFrameStats.WriteCsv(path);
+}
 
-    mPipeline.Create(mDevice, mRenderPass, mSwapChain, mMesh, { mMatrixBuffer.Layout() },
-          "../Resource/Shaders/Simple.vert.spv", "../Resource/Shaders/Simple.frag.spv", 1, VK_CULL_MODE_BACK_BIT, true, true);
+/****************************************************************************/
+/*!
+\brief
+  Measure the next draw against nothing, so a pause in drawing is not
+  counted as a frame. Call while no thread draws.
+*/
+/****************************************************************************/
+void VK::Renderer::ResetFrameClock()
+{
+    mDrawn = false;
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Create all framebuffers
+  Write the frame stats exports when their interval has passed. Call from
+  a thread other than the one that draws, so the writes do not show up in
+  the frame times.
 */
 /****************************************************************************/
-void VK::Renderer::InitFramebuffers()
+bool VK::Renderer::ExportFrameStats()
 {
-    VkExtent2D extent = mSwapChain.Extent();
-    std::vector<VK::ImageView>* imageViews = mSwapChain.ImageViews();
-    mFrameBuffers.resize(imageViews->size());
+    return mFrameStats.ExportIfDue();
+}
 
-    for (size_t i = 0; i < imageViews->size(); ++i)
-    {
-        std::array<VkImageView, 2> attachments =
-        {
-            (*imageViews)[i].Get(), mDepthTexture.GetView()
-        };
+/****************************************************************************/
+/*!
+\brief
+  Get the graphics VkQueue
+*/
+/****************************************************************************/
+VkQueue VK::Renderer::GraphicsQueue() const
+{
+    return mGraphicsQueue;
+}
 
-        VkFramebufferCreateInfo framebufferInfo = {};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = mRenderPass.Get();
-        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = extent.width;
-        framebufferInfo.height = extent.height;
-        framebufferInfo.layers = 1;
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
 
-        mFrameBuffers[i].Create(mDevice, framebufferInfo);
+/****************************************************************************/
+/*!
+\brief
+  Initialize GLFW
+*/
+/****************************************************************************/
+void VK::Renderer::InitGLFW()
+{
+    glfwSetErrorCallback(VK::GLFWErrorCallback);
+    if (!glfwInit())
+    {
+        throw std::runtime_error("GLFW: glfwInit() failed! Check error callback!\n");
     }
 }
 
 /****************************************************************************/
 /*!
 \brief
-  fill all command buffers
+  Initialize Vulkan, the device is picked for the main target's surface
 */
 /****************************************************************************/
-void VK::Renderer::UpdateCommandBuffers()
+void VK::Renderer::InitVulkan()
 {
-    for (unsigned i = 0; i < mCommandBuffer.size(); ++i)
+    if (!mConfig.headless && !glfwVulkanSupported())
     {
-        vkResetCommandBuffer(mCommandBuffer[i], VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
-        mCommandBuffer.Begin(i, mFrameBuffers,mRenderPass, mSwapChain, 1, 1);
+        throw std::runtime_error("GLFW: Vulkan Not Supported\n");
+    }
 
-        mCommandBuffer.BindVertexBufferes(i, { mMesh.Buffer()->Get() }, { 0,0 });
-        mCommandBuffer.BindPipeline(i, mPipeline);
-        mCommandBuffer.BindDescriptorSet(i, mPipeline, { mMatrixBuffer.Set(i) });
+    mInstance.Create(mConfig.headless);
+    mDebugMessenger.Create(mInstance);
 
-        mCommandBuffer.DrawIndexed(i, 1, mMesh.IndexBuffer()->GetPointerTo(), mMesh.IndexCount());
-        mCommandBuffer.End(i);
-    }
+    PresentTargetDesc mainDesc;
+    mainDesc.headless = mConfig.headless;
+    mainDesc.width = mConfig.width;
+    mainDesc.height = mConfig.height;
+
+    std::unique_ptr<VK::PresentTarget> main = std::make_unique<VK::PresentTarget>();
+    main->OpenWindow(mInstance, mainDesc);
+    mDevice.Create(mInstance, main->GetSurface(), mGraphicsQueue, mPresentQueue, mConfig.dynamicRendering, mConfig.gpuCulling);
+    mCommandPool.Create(mDevice, main->GetSurface());
+    mPipelineCache.Create(mDevice, mConfig.shaderCacheDirectory);
+
+    // assets are loaded once and shared by every target
+    mMesh.Create(mDevice, mCommandPool, mGraphicsQueue, "../Resource/Models/StanfordBunny.obj");
+
+    InitSyncObjects();
+    main->Create(mDevice, mCommandPool, mPipelineCache, mMesh, mConfig);
+    mMainTarget = main.get();
+    mTargets.push_back(std::move(main));
+    mGpuCulling = mConfig.gpuCulling && mDevice.DrawIndirectCount();
+    mAspectRatio = mMainTarget->AspectRatio();
+
+    InitReadback();
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Recreated everything that needs to be resized upon window resize.
+  Create the per frame fences, the targets own their semaphores
 */
 /****************************************************************************/
-void VK::Renderer::RecreateSwapChain()
+void VK::Renderer::InitSyncObjects()
 {
-    WaitIdle();
-
-    ShutdownSwapChain();
+    mInFlightFences.resize(mMaxFramesInFlight);
 
-    mSwapChain.Create(mSurface, mDevice, mWindow);
-    mCommandPool.Create(mDevice, mSurface);
-    mCommandBuffer.Create(mDevice, mCommandPool, unsigned(mSwapChain.Images()->size()));
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    InitRenderPass();
-    InitDepthResources();
-    InitFramebuffers();
-    InitPipelines();
-    UpdateCommandBuffers();
+    for (size_t i = 0; i < mMaxFramesInFlight; ++i)
+    {
+        mInFlightFences[i].Create(mDevice, fenceInfo);
+    }
 }
 
 /****************************************************************************/
 /*!
 \brief
-  all GLFW related cleanup
+  Create the readback ring if it was requested
 */
 /****************************************************************************/
-void VK::Renderer::ShutdownGLFW()
+void VK::Renderer::InitReadback()
 {
-    ShutdownWindow();
-    glfwTerminate();
+    if (!mReadbackEnabled)
+        return;
+
+    VK::SwapChain& swapChain = mMainTarget->GetSwapChain();
+    if (!(swapChain.ImageUsage() & VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
+    {
+        DEBUG::log.Error("Renderer::InitReadback: swap chain images can not be used as a transfer source!");
+        throw std::runtime_error("swap chain images can not be used as a transfer source!");
+    }
+
+    mReadback.Create(mDevice, mCommandPool, swapChain.Extent(), swapChain.Format(), mReadbackDesc, mReadbackCallback);
 }
 
 /****************************************************************************/
 /*!
 \brief
-  destroy the application window
+  Recreated everything of a target that needs to be resized upon window
+  resize, the main target's readback is resized with it
 */
 /****************************************************************************/
-void VK::Renderer::ShutdownWindow()
+void VK::Renderer::RecreateTarget(PresentTarget& target)
 {
-    glfwDestroyWindow(mWindow);
+    VK_PROFILE_SCOPE("RecreateTarget");
+    WaitIdle();
+
+    bool main = &target == mMainTarget;
+    if (main)
+    {
+        // only called once the device is idle, so this never blocks
+        mReadback.Flush(mDevice);
+        mReadback.ShutDown(mDevice, mCommandPool);
+    }
+
+    target.Recreate(mDevice, mCommandPool, mPipelineCache, mMesh, mConfig);
+
+    if (main)
+    {
+        InitReadback();
+    }
 }
 
 /****************************************************************************/
 /*!
 \brief
-  all Vulkan related cleanup
+  Apply settings requested through SetConfig. Changing the frames in flight
+  only rebuilds the sync objects, present mode, image count and resolution
+  changes rebuild the swap chains.
 */
 /****************************************************************************/
-void VK::Renderer::ShutdownVulkan()
+void VK::Renderer::ApplyConfig()
 {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mConfigChanged = false;
+
+    bool syncChanged = mPendingConfig.framesInFlight != mConfig.framesInFlight;
+    bool swapChainChanged = mPendingConfig.presentModes != mConfig.presentModes ||
+                            mPendingConfig.minImageCount != mConfig.minImageCount ||
+                            mPendingConfig.dynamicResolution != mConfig.dynamicResolution ||
+                            mPendingConfig.resolution.minScale != mConfig.resolution.minScale ||
+                            mPendingConfig.resolution.maxScale != mConfig.resolution.maxScale;
+
+    // the budget is only a target, nothing has to be rebuilt
+    mConfig.resolution.budgetMs = mPendingConfig.resolution.budgetMs;
+    for (std::unique_ptr<VK::PresentTarget>& target : mTargets)
+    {
+        target->SetBudget(mConfig.resolution.budgetMs);
+    }
+
+    if (!syncChanged && !swapChainChanged)
+        return;
+
     WaitIdle();
-    ShutdownSwapChain();
+    mConfig = mPendingConfig;
+    mGpuCulling = mConfig.gpuCulling && mDevice.DrawIndirectCount();
 
-    for (size_t i = 0; i < mMaxFramesInFlight; ++i)
+    if (syncChanged)
     {
-        mRenderFinishedSemaphores[i].ShutDown(mDevice);
-        mImageAvailableSemaphores[i].ShutDown(mDevice);
-        mInFlightFences[i].ShutDown(mDevice);
+        ShutdownSyncObjects();
+        mMaxFramesInFlight = mConfig.framesInFlight;
+        mCurrentFrame = 0;
+        InitSyncObjects();
+
+        for (std::unique_ptr<VK::PresentTarget>& target : mTargets)
+        {
+            target->ShutdownSyncObjects(mDevice);
+            target->InitSyncObjects(mDevice, mMaxFramesInFlight);
+        }
     }
 
+    if (swapChainChanged)
+    {
+        for (std::unique_ptr<VK::PresentTarget>& target : mTargets)
+        {
+            RecreateTarget(*target);
+        }
+    }
+}
 
-    mDevice.ShutDown();
-    mSurface.ShutDown(mInstance);
-    mDebugMessenger.ShutDown(mInstance);
-    mInstance.ShutDown();
+/****************************************************************************/
+/*!
+\brief
+  all GLFW related cleanup
+*/
+/****************************************************************************/
+void VK::Renderer::ShutdownGLFW()
+{
+    glfwTerminate();
 }
 
 /****************************************************************************/
 /*!
 \brief
-  shutdown everything swapchain related
+  all Vulkan related cleanup
 */
 /****************************************************************************/
-void VK::Renderer::ShutdownSwapChain()
+void VK::Renderer::ShutdownVulkan()
 {
-    size_t frameBufferCount = mFrameBuffers.size();
-    for (size_t i = 0; i < frameBufferCount; ++i)
+    WaitIdle();
+
+    // only called once the device is idle, so this never blocks
+    mReadback.Flush(mDevice);
+    mReadback.ShutDown(mDevice, mCommandPool);
+
+    for (std::unique_ptr<VK::PresentTarget>& target : mTargets)
     {
-        mFrameBuffers[i].ShutDown(mDevice);
+        target->ShutDown(mInstance, mDevice, mCommandPool);
     }
+    mTargets.clear();
 
+    ShutdownSyncObjects();
     mMesh.ShutDown(mDevice);
-    mMatrixBuffer.ShutDown(mDevice);
-
-    mPipeline.ShutDown(mDevice);
-    mRenderPass.ShutDown(mDevice);
-    mDepthTexture.ShutDown(mDevice);
-    mSwapChain.ShutDown(mDevice);
-    mCommandBuffer.ShutDown(mDevice, mCommandPool);
+    mPipelineCache.ShutDown(mDevice);
     mCommandPool.ShutDown(mDevice);
-}
 
-/*============================================================================*\
-|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
-\*============================================================================*/
+    mDevice.ShutDown();
+    mDebugMessenger.ShutDown(mInstance);
+    mInstance.ShutDown();
+}
 
 /****************************************************************************/
 /*!
 \brief
-  get the desired depth format
+  destroy the per frame fences
 */
 /****************************************************************************/
-VkFormat VK::Renderer::FindDepthFormat()
+void VK::Renderer::ShutdownSyncObjects()
 {
-    return mDevice.FindSupportedFormat(
-        { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    for (size_t i = 0; i < mInFlightFences.size(); ++i)
+    {
+        mInFlightFences[i].ShutDown(mDevice);
+    }
+
+    mInFlightFences.clear();
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Render a frame
+  Render a frame into every target with one submit and one present
 */
 /****************************************************************************/
 void VK::Renderer::DrawFrame(float dt)
 {
-    // wait for active frame
-    vkWaitForFences(mDevice.Get(), 1, mInFlightFences[mCurrentFrame].GetPointerTo(), VK_TRUE, UINT64_MAX);
+    UNUSED(dt);
+    VK_PROFILE_SCOPE("DrawFrame");
 
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(mDevice.Get(), mSwapChain.Get(), UINT64_MAX, mImageAvailableSemaphores[mCurrentFrame].Get(), VK_NULL_HANDLE, &imageIndex);
+    std::lock_guard<std::mutex> lock(mTargetMutex);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    if (mConfigChanged)
     {
-       RecreateSwapChain();
-       return;
-    }
-    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
-    {
-       DEBUG::log.Error("DrawFrame: failed to acquire swap chain image!");
-       throw std::runtime_error("failed to acquire swap chain image!");
+        ApplyConfig();
     }
 
-    if (mImagesInFlight[imageIndex].Get() != VK_NULL_HANDLE)
+    // wait for active frame
     {
-        vkWaitForFences(mDevice.Get(), 1, mImagesInFlight[imageIndex].GetPointerTo(), VK_TRUE, UINT64_MAX);
+        VK_PROFILE_SCOPE("WaitForFrameFence");
+        std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+        vkWaitForFences(mDevice.Get(), 1, mInFlightFences[mCurrentFrame].GetPointerTo(), VK_TRUE, UINT64_MAX);
+        mFrameWaitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
     }
-    mImagesInFlight[imageIndex] = mInFlightFences[mCurrentFrame];
 
-    // update buffers
-    mMatrixBuffer.Update(mDevice, imageIndex, &mMatrixBufferData, sizeof(MatrixBuffer));
+    mFrameTargets.clear();
+    mWaitSemaphores.clear();
+    mWaitStages.clear();
+    mSubmitBuffers.clear();
+    mSignalSemaphores.clear();
 
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    for (std::unique_ptr<VK::PresentTarget>& target : mTargets)
+    {
+        // offscreen images are rebuilt at their new size before they are used
+        if (target->IsHeadless() && target->TakeResized())
+        {
+            RecreateTarget(*target);
+        }
 
-    VkSemaphore waitSemaphores[] = { mImageAvailableSemaphores[mCurrentFrame].Get() };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+        VkResult result = target->Acquire(mDevice, mCurrentFrame, mInFlightFences[mCurrentFrame], mFrameScene);
 
-    std::vector<VkCommandBuffer> buffers;
-    buffers = { mCommandBuffer[imageIndex] };
+        // an out of date target sits this frame out
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            RecreateTarget(*target);
+            continue;
+        }
+        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+        {
+            DEBUG::log.Error("DrawFrame: failed to acquire swap chain image!");
+            throw std::runtime_error("failed to acquire swap chain image!");
+        }
 
-    submitInfo.commandBufferCount = uint32_t(buffers.size());
-    submitInfo.pCommandBuffers = buffers.data();
+        mFrameTargets.push_back(target.get());
+        mSubmitBuffers.push_back(target->CommandBuffer());
+        mFrameWaitMs += target->WaitTime();
 
-    VkSemaphore signalSemaphores[] = { mRenderFinishedSemaphores[mCurrentFrame].Get() };
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+        if (!target->IsHeadless())
+        {
+            mWaitSemaphores.push_back(target->ImageAvailable(mCurrentFrame));
+            mWaitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        }
+    }
 
-    vkResetFences(mDevice.Get(), 1, mInFlightFences[mCurrentFrame].GetPointerTo());
+    if (mFrameTargets.empty())
+        return;
 
-    // display this frame
-    if (vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, mInFlightFences[mCurrentFrame].Get()) != VK_SUCCESS)
+    // with readback the copy signals the main target's semaphore so present waits for it
+    VK::PresentTarget* main = mMainTarget;
+    bool readback = mReadback.IsActive() && mFrameTargets[0] == main;
+    for (VK::PresentTarget* target : mFrameTargets)
     {
-        DEBUG::log.Error("DrawFrame: failed to submit draw command buffer!");
-        throw std::runtime_error("failed to submit draw command buffer!");
+        if (!target->IsHeadless() && !(readback && target == main))
+        {
+            mSignalSemaphores.push_back(target->RenderFinished(mCurrentFrame));
+        }
     }
 
-    VkPresentInfoKHR presentInfo = {};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = uint32_t(mWaitSemaphores.size());
+    submitInfo.pWaitSemaphores = mWaitSemaphores.data();
+    submitInfo.pWaitDstStageMask = mWaitStages.data();
+    submitInfo.commandBufferCount = uint32_t(mSubmitBuffers.size());
+    submitInfo.pCommandBuffers = mSubmitBuffers.data();
+    submitInfo.signalSemaphoreCount = uint32_t(mSignalSemaphores.size());
+    submitInfo.pSignalSemaphores = mSignalSemaphores.data();
 
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    vkResetFences(mDevice.Get(), 1, mInFlightFences[mCurrentFrame].GetPointerTo());
 
-    VkSwapchainKHR swapChains[] = { mSwapChain.Get() };
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
+    // display this frame
+    {
+        VK_PROFILE_SCOPE("Submit");
+        if (vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, mInFlightFences[mCurrentFrame].Get()) != VK_SUCCESS)
+        {
+            DEBUG::log.Error("DrawFrame: failed to submit draw command buffer!");
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+    }
 
-    presentInfo.pImageIndices = &imageIndex;
+    if (readback)
+    {
+        mReadback.Capture(mDevice, mGraphicsQueue, main->Image(), main->ColorFinalLayout(),
+            main->IsHeadless() ? VK_NULL_HANDLE : main->RenderFinished(mCurrentFrame));
+    }
 
-    result = vkQueuePresentKHR(mPresentQueue, &presentInfo);
+    mPresentSwapChains.clear();
+    mPresentImages.clear();
+    mPresentTargets.clear();
+    mSignalSemaphores.clear();
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || mFramebufferResized)
+    for (VK::PresentTarget* target : mFrameTargets)
     {
-        mFramebufferResized = false;
-        RecreateSwapChain();
+        // nothing to present to
+        if (target->IsHeadless())
+            continue;
+
+        mPresentSwapChains.push_back(target->GetSwapChain().Get());
+        mPresentImages.push_back(target->ImageIndex());
+        mPresentTargets.push_back(target);
+        mSignalSemaphores.push_back(target->RenderFinished(mCurrentFrame));
     }
-    else if (result != VK_SUCCESS)
+
+    if (!mPresentTargets.empty())
     {
-        DEBUG::log.Error("debugLog.txt", "DrawFrame: failed to present swap chain image!");
-        throw std::runtime_error("failed to present swap chain image!");
+        mPresentResults.assign(mPresentTargets.size(), VK_SUCCESS);
+
+        VkPresentInfoKHR presentInfo = {};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = uint32_t(mSignalSemaphores.size());
+        presentInfo.pWaitSemaphores = mSignalSemaphores.data();
+        presentInfo.swapchainCount = uint32_t(mPresentSwapChains.size());
+        presentInfo.pSwapchains = mPresentSwapChains.data();
+        presentInfo.pImageIndices = mPresentImages.data();
+        presentInfo.pResults = mPresentResults.data();
+
+        {
+            VK_PROFILE_SCOPE("Present");
+            vkQueuePresentKHR(mPresentQueue, &presentInfo);
+        }
+
+        for (size_t i = 0; i < mPresentTargets.size(); ++i)
+        {
+            VkResult result = mPresentResults[i];
+            bool resized = mPresentTargets[i]->TakeResized();
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || resized)
+            {
+                RecreateTarget(*mPresentTargets[i]);
+            }
+            else if (result != VK_SUCCESS)
+            {
+                DEBUG::log.Error("debugLog.txt", "DrawFrame: failed to present swap chain image!");
+                throw std::runtime_error("failed to present swap chain image!");
+            }
+        }
     }
 
     mCurrentFrame = (mCurrentFrame + 1) % mMaxFramesInFlight;
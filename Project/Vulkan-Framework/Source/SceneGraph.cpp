@@ -0,0 +1,388 @@
+/****************************************************************************/
+/*!
+\file
+   SceneGraph.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Transform hierarchy, local to world propagation
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "SceneGraph.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+// nodes per job, small levels are done on the calling thread
+static const uint32_t LevelGrain = 1024;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Add a node with an identity transform
+
+\param parent
+  NoNode for a root
+*/
+/****************************************************************************/
+VK::SceneNode VK::SceneGraph::Create(SceneNode parent)
+{
+    assert(parent == NoNode || parent < Size());
+
+    // placed at the end until the next update sorts it into its level
+    SceneNode node = Size();
+    mSlotOf.push_back(node);
+    mParentNode.push_back(parent);
+
+    mNodeOf.push_back(node);
+    mParent.push_back(NoNode);
+    mLevel.push_back(0);
+    mFirstChild.push_back(0);
+    mChildCount.push_back(0);
+    mLocal.push_back(glm::mat4(1));
+    mWorld.push_back(glm::mat4(1));
+    mDirty.push_back(0);
+
+    mStructureChanged = true;
+    return node;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Move a node and its children under another parent
+*/
+/****************************************************************************/
+void VK::SceneGraph::SetParent(SceneNode node, SceneNode parent)
+{
+    assert(node < Size() && (parent == NoNode || parent < Size()));
+
+    for (SceneNode ancestor = parent; ancestor != NoNode; ancestor = mParentNode[ancestor])
+    {
+        if (ancestor == node)
+        {
+            DEBUG::log.Error("SceneGraph::SetParent: node can not be parented to its own child!");
+            throw std::runtime_error("node can not be parented to its own child!");
+        }
+    }
+
+    mParentNode[node] = parent;
+    mStructureChanged = true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set a node's transform relative to its parent
+*/
+/****************************************************************************/
+void VK::SceneGraph::SetLocal(SceneNode node, const glm::mat4& local)
+{
+    assert(node < Size());
+
+    uint32_t slot = mSlotOf[node];
+    mLocal[slot] = local;
+    MarkDirty(slot);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bring the world transforms up to date. Costs the number of nodes that
+  changed, plus their descendants, unless nodes were added or moved.
+*/
+/****************************************************************************/
+void VK::SceneGraph::Update(VK::JobPool& jobs)
+{
+    mChanged.clear();
+
+    if (mStructureChanged)
+    {
+        Rebuild();
+
+        // the order changed, so every world transform is written again
+        for (uint32_t level = 0; level < LevelCount(); ++level)
+        {
+            std::vector<uint32_t>& work = mLevelWork[level];
+            work.clear();
+            for (uint32_t slot = mLevelStart[level]; slot < mLevelStart[level + 1]; ++slot)
+                work.push_back(slot);
+
+            Propagate(jobs, work);
+            work.clear();
+        }
+
+        mChanged = mNodeOf;
+        return;
+    }
+
+    if (mDirtyList.empty())
+        return;
+
+    for (uint32_t slot : mDirtyList)
+        mLevelWork[mLevel[slot]].push_back(slot);
+    mDirtyList.clear();
+
+    // a level is the nodes set directly plus the children of the last
+    // level's work, the parents are finished before the level starts
+    for (uint32_t level = 0; level < LevelCount(); ++level)
+    {
+        std::vector<uint32_t>& work = mLevelWork[level];
+
+        if (level > 0)
+        {
+            for (uint32_t parent : mLevelWork[level - 1])
+            {
+                uint32_t end = mFirstChild[parent] + mChildCount[parent];
+                for (uint32_t child = mFirstChild[parent]; child < end; ++child)
+                {
+                    if (!mDirty[child])
+                    {
+                        mDirty[child] = 1;
+                        work.push_back(child);
+                    }
+                }
+            }
+        }
+
+        Propagate(jobs, work);
+    }
+
+    for (std::vector<uint32_t>& work : mLevelWork)
+    {
+        for (uint32_t slot : work)
+        {
+            mDirty[slot] = 0;
+            mChanged.push_back(mNodeOf[slot]);
+        }
+        work.clear();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Make room for nodes ahead of time
+*/
+/****************************************************************************/
+void VK::SceneGraph::Reserve(uint32_t count)
+{
+    mSlotOf.reserve(count);
+    mParentNode.reserve(count);
+    mNodeOf.reserve(count);
+    mParent.reserve(count);
+    mLevel.reserve(count);
+    mFirstChild.reserve(count);
+    mChildCount.reserve(count);
+    mLocal.reserve(count);
+    mWorld.reserve(count);
+    mDirty.reserve(count);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Remove every node
+*/
+/****************************************************************************/
+void VK::SceneGraph::Clear()
+{
+    mSlotOf.clear();
+    mParentNode.clear();
+    mNodeOf.clear();
+    mParent.clear();
+    mLevel.clear();
+    mFirstChild.clear();
+    mChildCount.clear();
+    mLocal.clear();
+    mWorld.clear();
+    mDirty.clear();
+    mLevelStart.clear();
+    mDirtyList.clear();
+    mLevelWork.clear();
+    mChanged.clear();
+    mStructureChanged = false;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get a node's parent, NoNode for roots
+*/
+/****************************************************************************/
+VK::SceneNode VK::SceneGraph::Parent(SceneNode node) const
+{
+    return mParentNode[node];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get a node's transform relative to its parent
+*/
+/****************************************************************************/
+const glm::mat4& VK::SceneGraph::Local(SceneNode node) const
+{
+    return mLocal[mSlotOf[node]];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get a node's world transform as of the last update
+*/
+/****************************************************************************/
+const glm::mat4& VK::SceneGraph::World(SceneNode node) const
+{
+    return mWorld[mSlotOf[node]];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of nodes
+*/
+/****************************************************************************/
+uint32_t VK::SceneGraph::Size() const
+{
+    return uint32_t(mSlotOf.size());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the depth of the deepest node plus one, as of the last update
+*/
+/****************************************************************************/
+uint32_t VK::SceneGraph::LevelCount() const
+{
+    return mLevelStart.empty() ? 0 : uint32_t(mLevelStart.size() - 1);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the nodes whose world transform the last update wrote
+*/
+/****************************************************************************/
+const std::vector<VK::SceneNode>& VK::SceneGraph::Changed() const
+{
+    return mChanged;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Queue a slot for the next update, once
+*/
+/****************************************************************************/
+void VK::SceneGraph::MarkDirty(uint32_t slot)
+{
+    if (mDirty[slot])
+        return;
+
+    mDirty[slot] = 1;
+    mDirtyList.push_back(slot);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Sort the slots breadth first from the roots, which puts each level
+  together and the children of a node next to each other
+*/
+/****************************************************************************/
+void VK::SceneGraph::Rebuild()
+{
+    uint32_t count = Size();
+
+    // children of every node, grouped by parent
+    std::vector<uint32_t> childStart(count + 1, 0);
+    for (SceneNode node = 0; node < count; ++node)
+        if (mParentNode[node] != NoNode)
+            ++childStart[mParentNode[node] + 1];
+    for (uint32_t i = 0; i < count; ++i)
+        childStart[i + 1] += childStart[i];
+
+    std::vector<SceneNode> children(childStart[count]);
+    std::vector<uint32_t> cursor(childStart.begin(), childStart.end() - 1);
+    for (SceneNode node = 0; node < count; ++node)
+        if (mParentNode[node] != NoNode)
+            children[cursor[mParentNode[node]]++] = node;
+
+    std::vector<SceneNode> order;
+    order.reserve(count);
+    for (SceneNode node = 0; node < count; ++node)
+        if (mParentNode[node] == NoNode)
+            order.push_back(node);
+
+    std::vector<glm::mat4> local(count);
+    mLevelStart.assign(1, 0);
+
+    for (uint32_t slot = 0; slot < order.size(); ++slot)
+    {
+        SceneNode node = order[slot];
+        SceneNode parent = mParentNode[node];
+
+        // the old slot is still in mSlotOf until the node is reached here
+        local[slot] = mLocal[mSlotOf[node]];
+        mSlotOf[node] = slot;
+        mNodeOf[slot] = node;
+        mParent[slot] = parent == NoNode ? NoNode : mSlotOf[parent];
+        mLevel[slot] = parent == NoNode ? 0 : mLevel[mParent[slot]] + 1;
+
+        if (mLevel[slot] == mLevelStart.size())
+            mLevelStart.push_back(slot);
+
+        mFirstChild[slot] = uint32_t(order.size());
+        mChildCount[slot] = childStart[node + 1] - childStart[node];
+        order.insert(order.end(), children.begin() + childStart[node], children.begin() + childStart[node + 1]);
+    }
+    mLevelStart.push_back(count);
+
+    mLocal.swap(local);
+    std::fill(mDirty.begin(), mDirty.end(), uint8_t(0));
+    mDirtyList.clear();
+    mLevelWork.resize(LevelCount());
+    mStructureChanged = false;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write the world transforms of one level's slots
+*/
+/****************************************************************************/
+void VK::SceneGraph::Propagate(VK::JobPool& jobs, const std::vector<uint32_t>& slots)
+{
+    jobs.For(uint32_t(slots.size()), LevelGrain, [this, &slots](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            uint32_t slot = slots[i];
+            uint32_t parent = mParent[slot];
+            mWorld[slot] = parent == NoNode ? mLocal[slot] : mWorld[parent] * mLocal[slot];
+        }
+    });
+}
@@ -0,0 +1,209 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "ShaderCache.hpp"
+#include <fstream>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  read in a files data
+*/
+/****************************************************************************/
+static std::vector<uint32_t> readFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        DEBUG::log.Error("readFile: failed to open file!");
+        throw std::runtime_error("failed to open file!");
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<uint32_t> buffer((fileSize + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buffer.data()), fileSize);
+
+    file.close();
+
+    return buffer;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  the module map key of a file and its defines
+*/
+/****************************************************************************/
+static std::string ModuleKey(const std::string& path, const std::vector<VK::ShaderDefine>& defines)
+{
+    std::string key = path;
+    for (const VK::ShaderDefine& define : defines)
+        key += "\n" + define.name + "=" + define.value;
+
+    return key;
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Set up the GLSL compiler
+
+\param cacheDirectory
+  Where compiled SPIR-V is kept between runs
+*/
+/****************************************************************************/
+void VK::ShaderCache::Create(const std::string& cacheDirectory, const std::vector<std::string>& includeDirectories)
+{
+    mCompiler.Create(cacheDirectory, includeDirectories);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  cleanup, no pipeline may be compiling
+*/
+/****************************************************************************/
+void VK::ShaderCache::ShutDown(VK::Device& device)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto& module : mModules)
+        vkDestroyShaderModule(device.Get(), module.second.module, nullptr);
+    mModules.clear();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the module of a shader and what it uses, made the first time it is
+  asked for. Safe to call from the pipeline compile workers.
+*/
+/****************************************************************************/
+const VK::ShaderCache::Module& VK::ShaderCache::Get(VK::Device& device, const std::string& path, const std::vector<ShaderDefine>& defines)
+{
+    std::string key = ModuleKey(path, defines);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto found = mModules.find(key);
+        if (found != mModules.end())
+            return found->second;
+    }
+
+    // compiled without the lock, another thread may beat us to it
+    std::vector<uint32_t> code = Load(path, defines);
+    Module module;
+    module.reflection.Create(code);
+    module.module = CreateShaderModule(device, code);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto inserted = mModules.emplace(key, module);
+    if (!inserted.second)
+        vkDestroyShaderModule(device.Get(), module.module, nullptr);
+
+    return inserted.first->second;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the module of a shader
+*/
+/****************************************************************************/
+VkShaderModule VK::ShaderCache::GetModule(VK::Device& device, const std::string& path, const std::vector<ShaderDefine>& defines)
+{
+    return Get(device, path, defines).module;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the GLSL compiler
+*/
+/****************************************************************************/
+VK::ShaderCompiler& VK::ShaderCache::Compiler()
+{
+    return mCompiler;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the number of modules made so far
+*/
+/****************************************************************************/
+size_t VK::ShaderCache::ModuleCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mModules.size();
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Get the SPIR-V of a shader file
+*/
+/****************************************************************************/
+std::vector<uint32_t> VK::ShaderCache::Load(const std::string& path, const std::vector<ShaderDefine>& defines)
+{
+    bool binary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".spv") == 0;
+    if (!binary)
+        return mCompiler.Compile(path, defines);
+
+    if (!defines.empty())
+        DEBUG::log.Info("ShaderCache::Load: defines do nothing for an already compiled shader", path);
+
+    return readFile(path);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  create a shader
+*/
+/****************************************************************************/
+VkShaderModule VK::ShaderCache::CreateShaderModule(VK::Device& device, const std::vector<uint32_t>& code)
+{
+    VkShaderModuleCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size() * sizeof(uint32_t);
+    createInfo.pCode = code.data();
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device.Get(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        DEBUG::log.Error("ShaderCache::CreateShaderModule: failed to create shader module!");
+        throw std::runtime_error("failed to create shader module!");
+    }
+
+    return shaderModule;
+}
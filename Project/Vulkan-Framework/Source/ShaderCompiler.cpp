@@ -0,0 +1,486 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "ShaderCompiler.hpp"
+#include "Hash.hpp"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <cstdlib>
+
+#ifdef VK_SHADERC
+#include <shaderc/shaderc.h>
+
+// set by the build from the shaderc package, see CMakeLists.txt
+#ifndef VK_SHADERC_VERSION
+#define VK_SHADERC_VERSION "unknown"
+#endif
+#endif
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+static const uint32_t SpirvMagic = 0x07230203;
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  read a text file, empty if it can not be opened
+*/
+/****************************************************************************/
+static bool ReadText(const std::string& path, std::string& text)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    text = buffer.str();
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  read a SPIR-V file, empty if it is missing or not SPIR-V
+*/
+/****************************************************************************/
+static std::vector<uint32_t> ReadSpirv(const std::string& path)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+        return {};
+
+    size_t fileSize = size_t(file.tellg());
+    if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0)
+        return {};
+
+    std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), fileSize);
+
+    if (!file || code[0] != SpirvMagic)
+        return {};
+
+    return code;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  write a file under a temporary name and move it in place, so a reader
+  never sees half of it
+*/
+/****************************************************************************/
+static void WriteAtomic(const std::string& path, const void* data, size_t size)
+{
+    std::string temp = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return;
+        file.write(reinterpret_cast<const char*>(data), size);
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp, path, error);
+    if (error)
+        std::filesystem::remove(temp, error);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  FNV-1a of a string as 16 hex digits
+*/
+/****************************************************************************/
+static std::string HashName(const std::string& text)
+{
+    uint64_t hash = VK::HashOffset;
+    VK::HashBytes(hash, text.data(), text.size());
+
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return name;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  the name of an include in an #include line, empty if it is not one
+*/
+/****************************************************************************/
+static std::string IncludeName(const std::string& line)
+{
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+        return "";
+
+    size_t open = line.find_first_of("\"<", start + 8);
+    if (open == std::string::npos)
+        return "";
+
+    size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+    if (close == std::string::npos)
+        return "";
+
+    return line.substr(open + 1, close - open - 1);
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Pick the compiler and make the cache directory
+
+\param cacheDirectory
+  Where compiled SPIR-V is kept between runs
+
+\param includeDirectories
+  Searched for includes not found next to the including file
+*/
+/****************************************************************************/
+void VK::ShaderCompiler::Create(const std::string& cacheDirectory, const std::vector<std::string>& includeDirectories)
+{
+    mCacheDirectory = cacheDirectory;
+    mIncludeDirectories = includeDirectories;
+
+    std::error_code error;
+    std::filesystem::create_directories(mCacheDirectory, error);
+    if (error)
+        DEBUG::log.Info("ShaderCompiler::Create: failed to create the shader cache directory, every shader will be compiled!");
+
+#ifdef VK_SHADERC
+    // the library has no version query, the build passes in the version of
+    // the package it linked against
+    unsigned int version = 0;
+    unsigned int revision = 0;
+    shaderc_get_spv_version(&version, &revision);
+    mVersion = std::string("shaderc ") + VK_SHADERC_VERSION + " spirv " + std::to_string(version) + "." + std::to_string(revision);
+#else
+    mGlslc = "glslc";
+    const char* sdk = std::getenv("VULKAN_SDK");
+    if (sdk)
+    {
+        for (const char* bin : { "/Bin/glslc.exe", "/Bin/glslc", "/bin/glslc" })
+        {
+            std::string path = std::string(sdk) + bin;
+            if (std::filesystem::exists(path, error))
+            {
+                mGlslc = path;
+                break;
+            }
+        }
+    }
+
+    // glslc names its shaderc, glslang and SPIR-V target versions
+    std::string unique = "glslc-version." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::string output = (std::filesystem::path(mCacheDirectory) / unique).string();
+    std::string command = "\"" + mGlslc + "\" --version > \"" + output + "\" 2>&1";
+#ifdef _WIN32
+    command = "\"" + command + "\"";
+#endif
+    if (std::system(command.c_str()) != 0 || !ReadText(output, mVersion) || mVersion.empty())
+    {
+        // nothing new can be compiled without it, cached shaders still load
+        DEBUG::log.Info("ShaderCompiler::Create: failed to run", mGlslc, "--version!");
+        mVersion = "glslc";
+    }
+    std::filesystem::remove(output, error);
+#endif
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the SPIR-V of a GLSL file, from the disk cache when nothing that
+  goes into it changed
+
+\param path
+  GLSL file, the stage comes from the extension (.vert, .frag, .comp ...)
+
+\param defines
+  Macros for this permutation
+*/
+/****************************************************************************/
+std::vector<uint32_t> VK::ShaderCompiler::Compile(const std::string& path, const std::vector<ShaderDefine>& defines)
+{
+    std::string source = Preprocess(path, defines);
+    std::string name = HashName(mVersion + '\n' + path + '\n' + source);
+    std::string cached = (std::filesystem::path(mCacheDirectory) / (name + ".spv")).string();
+
+    std::vector<uint32_t> code = ReadSpirv(cached);
+    if (!code.empty())
+    {
+        ++mHits;
+        return code;
+    }
+
+    ++mMisses;
+    code = Invoke(path, source, name);
+    WriteAtomic(cached, code.data(), code.size() * sizeof(uint32_t));
+
+    return code;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get a shader with its includes pasted in and its defines added
+*/
+/****************************************************************************/
+std::string VK::ShaderCompiler::Preprocess(const std::string& path, const std::vector<ShaderDefine>& defines)
+{
+    std::vector<std::string> included;
+    std::string source;
+    Expand(path, included, source);
+
+    if (defines.empty())
+        return source;
+
+    // defines have to come after #version
+    size_t insert = 0;
+    size_t version = source.find("#version");
+    if (version != std::string::npos)
+    {
+        insert = source.find('\n', version);
+        insert = insert == std::string::npos ? source.size() : insert + 1;
+    }
+
+    std::string defineLines;
+    for (const ShaderDefine& define : defines)
+        defineLines += "#define " + define.name + " " + define.value + "\n";
+
+    // put the line numbers back to where they were
+    size_t line = std::count(source.begin(), source.begin() + insert, '\n') + 1;
+    defineLines += "#line " + std::to_string(line) + "\n";
+
+    source.insert(insert, defineLines);
+
+    return source;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get what the disk cache is keyed on besides the source
+*/
+/****************************************************************************/
+const std::string& VK::ShaderCompiler::Version() const
+{
+    return mVersion;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get how many shaders came out of the disk cache
+*/
+/****************************************************************************/
+size_t VK::ShaderCompiler::CacheHits() const
+{
+    return mHits;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get how many shaders had to be compiled
+*/
+/****************************************************************************/
+size_t VK::ShaderCompiler::CacheMisses() const
+{
+    return mMisses;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Append a file to the output with its includes expanded. #line keeps the
+  line numbers of compile errors right within each file.
+*/
+/****************************************************************************/
+void VK::ShaderCompiler::Expand(const std::string& path, std::vector<std::string>& included, std::string& out)
+{
+    std::string text;
+    if (!ReadText(path, text))
+    {
+        DEBUG::log.Error("ShaderCompiler::Expand: failed to open shader", path);
+        throw std::runtime_error("failed to open shader!");
+    }
+    included.push_back(std::filesystem::weakly_canonical(path).string());
+
+    std::istringstream lines(text);
+    std::string line;
+    unsigned number = 0;
+    while (std::getline(lines, line))
+    {
+        ++number;
+
+        std::string name = IncludeName(line);
+        if (name.empty())
+        {
+            out += line;
+            out += '\n';
+            continue;
+        }
+
+        std::string includePath = FindInclude(path, name);
+        if (includePath.empty())
+        {
+            DEBUG::log.Error("ShaderCompiler::Expand: failed to find include", name, "on line", number, "of", path);
+            throw std::runtime_error("failed to find shader include!");
+        }
+
+        // an include seen before becomes an empty line
+        std::string canonical = std::filesystem::weakly_canonical(includePath).string();
+        if (std::find(included.begin(), included.end(), canonical) != included.end())
+        {
+            out += '\n';
+            continue;
+        }
+
+        out += "#line 1\n";
+        Expand(includePath, included, out);
+        out += "#line " + std::to_string(number + 1) + "\n";
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Find an include next to the file including it or in an include directory
+*/
+/****************************************************************************/
+std::string VK::ShaderCompiler::FindInclude(const std::string& parent, const std::string& name) const
+{
+    std::error_code error;
+
+    std::filesystem::path local = std::filesystem::path(parent).parent_path() / name;
+    if (std::filesystem::exists(local, error))
+        return local.string();
+
+    for (const std::string& directory : mIncludeDirectories)
+    {
+        std::filesystem::path candidate = std::filesystem::path(directory) / name;
+        if (std::filesystem::exists(candidate, error))
+            return candidate.string();
+    }
+
+    return "";
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Run the compiler on an expanded source
+
+\param path
+  The original file, for the stage and error messages
+
+\param name
+  The cache name, used for the temporary files of glslc
+*/
+/****************************************************************************/
+std::vector<uint32_t> VK::ShaderCompiler::Invoke(const std::string& path, const std::string& source, const std::string& name)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+
+#ifdef VK_SHADERC
+    shaderc_shader_kind kind = shaderc_glsl_infer_from_source;
+    if (extension == ".vert") kind = shaderc_glsl_vertex_shader;
+    else if (extension == ".frag") kind = shaderc_glsl_fragment_shader;
+    else if (extension == ".comp") kind = shaderc_glsl_compute_shader;
+    else if (extension == ".geom") kind = shaderc_glsl_geometry_shader;
+    else if (extension == ".tesc") kind = shaderc_glsl_tess_control_shader;
+    else if (extension == ".tese") kind = shaderc_glsl_tess_evaluation_shader;
+
+    shaderc_compiler_t compiler = shaderc_compiler_initialize();
+    shaderc_compile_options_t options = shaderc_compile_options_initialize();
+    shaderc_compile_options_set_optimization_level(options, shaderc_optimization_level_performance);
+
+    shaderc_compilation_result_t result = shaderc_compile_into_spv(compiler, source.data(), source.size(), kind, path.c_str(), "main", options);
+
+    std::vector<uint32_t> code;
+    bool success = shaderc_result_get_compilation_status(result) == shaderc_compilation_status_success;
+    if (success)
+    {
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(shaderc_result_get_bytes(result));
+        code.assign(words, words + shaderc_result_get_length(result) / sizeof(uint32_t));
+    }
+    else
+    {
+        DEBUG::log.Error("ShaderCompiler::Invoke:", path, "\n", shaderc_result_get_error_message(result));
+    }
+
+    shaderc_result_release(result);
+    shaderc_compile_options_release(options);
+    shaderc_compiler_release(compiler);
+#else
+    // each thread gets its own files, two workers may compile the same shader
+    std::string unique = name + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::filesystem::path directory(mCacheDirectory);
+    std::string input = (directory / (unique + extension)).string();
+    std::string output = (directory / (unique + ".out")).string();
+    std::string log = (directory / (unique + ".log")).string();
+
+    {
+        std::ofstream file(input, std::ios::binary | std::ios::trunc);
+        file << source;
+    }
+
+    std::string command = "\"" + mGlslc + "\" -O -o \"" + output + "\" \"" + input + "\" 2> \"" + log + "\"";
+#ifdef _WIN32
+    // cmd strips the outer quotes
+    command = "\"" + command + "\"";
+#endif
+    bool success = std::system(command.c_str()) == 0;
+
+    std::vector<uint32_t> code = ReadSpirv(output);
+    if (!success || code.empty())
+    {
+        std::string message;
+        ReadText(log, message);
+        DEBUG::log.Error("ShaderCompiler::Invoke:", path, "\n", message);
+        success = false;
+    }
+
+    std::error_code error;
+    std::filesystem::remove(input, error);
+    std::filesystem::remove(output, error);
+    std::filesystem::remove(log, error);
+#endif
+
+    if (!success)
+    {
+        DEBUG::log.Error("ShaderCompiler::Invoke: failed to compile shader!");
+        throw std::runtime_error("failed to compile shader!");
+    }
+
+    return code;
+}
@@ -0,0 +1,689 @@
+/****************************************************************************/
+/*!
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "VULKANPCH.hpp"
+#include "ShaderReflection.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+static const uint32_t SpirvMagic = 0x07230203;
+static const uint32_t NoValue = ~0u;
+
+// the parts of the SPIR-V spec this needs
+namespace Spv
+{
+    enum Op : uint32_t
+    {
+        EntryPoint = 15,
+        ExecutionMode = 16,
+        TypeInt = 21,
+        TypeFloat = 22,
+        TypeVector = 23,
+        TypeMatrix = 24,
+        TypeImage = 25,
+        TypeSampler = 26,
+        TypeSampledImage = 27,
+        TypeArray = 28,
+        TypeRuntimeArray = 29,
+        TypeStruct = 30,
+        TypePointer = 32,
+        Constant = 43,
+        SpecConstantTrue = 48,
+        SpecConstantFalse = 49,
+        SpecConstant = 50,
+        Variable = 59,
+        Decorate = 71,
+        MemberDecorate = 72,
+        TypeAccelerationStructure = 5341
+    };
+
+    enum Decoration : uint32_t
+    {
+        SpecId = 1,
+        Block = 2,
+        BufferBlock = 3,
+        ArrayStride = 6,
+        MatrixStride = 7,
+        BuiltIn = 11,
+        Location = 30,
+        Binding = 33,
+        DescriptorSet = 34,
+        Offset = 35
+    };
+
+    enum ExecutionMode : uint32_t
+    {
+        LocalSize = 17
+    };
+
+    enum StorageClass : uint32_t
+    {
+        UniformConstant = 0,
+        Input = 1,
+        Uniform = 2,
+        PushConstant = 9,
+        StorageBuffer = 12
+    };
+
+    enum Dim : uint32_t
+    {
+        Buffer = 5,
+        SubpassData = 6
+    };
+}
+
+// everything known about one SPIR-V id
+struct SpvId
+{
+    uint32_t opcode = 0;
+    uint32_t type = 0;
+    std::vector<uint32_t> operands;
+
+    uint32_t set = NoValue;
+    uint32_t binding = NoValue;
+    uint32_t location = NoValue;
+    uint32_t arrayStride = 0;
+    bool builtIn = false;
+    bool block = false;
+    bool bufferBlock = false;
+
+    std::vector<uint32_t> memberOffsets;
+    std::vector<uint32_t> memberMatrixStrides;
+};
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  the Vulkan stage of a SPIR-V execution model
+*/
+/****************************************************************************/
+static VkShaderStageFlags StageOf(uint32_t executionModel)
+{
+    switch (executionModel)
+    {
+    case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+    case 5313: return VK_SHADER_STAGE_RAYGEN_BIT_NV;
+    case 5314: return VK_SHADER_STAGE_INTERSECTION_BIT_NV;
+    case 5315: return VK_SHADER_STAGE_ANY_HIT_BIT_NV;
+    case 5316: return VK_SHADER_STAGE_CLOSEST_HIT_BIT_NV;
+    case 5317: return VK_SHADER_STAGE_MISS_BIT_NV;
+    case 5318: return VK_SHADER_STAGE_CALLABLE_BIT_NV;
+    default: return 0;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  set a member decoration, growing the list as needed
+*/
+/****************************************************************************/
+static void SetMember(std::vector<uint32_t>& members, uint32_t member, uint32_t value)
+{
+    if (members.size() <= member)
+        members.resize(member + 1, 0);
+
+    members[member] = value;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  the length of a fixed size array. Lengths from specialization constants
+  are their default values, lengths computed from them are not known.
+*/
+/****************************************************************************/
+static uint32_t ArrayLength(const std::vector<SpvId>& ids, const SpvId& array)
+{
+    const SpvId& length = ids[array.operands[1]];
+    if (length.operands.empty())
+    {
+        DEBUG::log.Error("ShaderReflection::Create: an array length is not a constant or specialization constant!");
+        throw std::runtime_error("array length is not a constant!");
+    }
+
+    return length.operands[0];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  the size in bytes of a type as laid out in a buffer
+
+\param matrixStride
+  Stride between matrix columns, from the member using the type
+*/
+/****************************************************************************/
+static uint32_t TypeSize(const std::vector<SpvId>& ids, uint32_t id, uint32_t matrixStride = 0)
+{
+    const SpvId& type = ids[id];
+    switch (type.opcode)
+    {
+    case Spv::TypeInt:
+    case Spv::TypeFloat:
+        return type.operands[0] / 8;
+
+    case Spv::TypeVector:
+        return type.operands[1] * TypeSize(ids, type.operands[0]);
+
+    case Spv::TypeMatrix:
+        return type.operands[1] * (matrixStride ? matrixStride : TypeSize(ids, type.operands[0]));
+
+    case Spv::TypeArray:
+    {
+        uint32_t length = ArrayLength(ids, type);
+        return length * (type.arrayStride ? type.arrayStride : TypeSize(ids, type.operands[0], matrixStride));
+    }
+
+    case Spv::TypeStruct:
+    {
+        uint32_t size = 0;
+        for (size_t i = 0; i < type.operands.size(); ++i)
+        {
+            uint32_t offset = i < type.memberOffsets.size() ? type.memberOffsets[i] : 0;
+            uint32_t stride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+            size = std::max(size, offset + TypeSize(ids, type.operands[i], stride));
+        }
+        return size;
+    }
+
+    default:
+        return 0;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  the descriptor type of a resource, the arrays around it already removed
+*/
+/****************************************************************************/
+static VkDescriptorType DescriptorTypeOf(const std::vector<SpvId>& ids, uint32_t storage, uint32_t id)
+{
+    const SpvId& type = ids[id];
+
+    if (storage == Spv::StorageBuffer || type.bufferBlock)
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    if (storage == Spv::Uniform)
+        return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+    switch (type.opcode)
+    {
+    case Spv::TypeSampler:
+        return VK_DESCRIPTOR_TYPE_SAMPLER;
+
+    case Spv::TypeSampledImage:
+        return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    case Spv::TypeImage:
+    {
+        // operands: sampled type, dim, depth, arrayed, ms, sampled, format
+        uint32_t dim = type.operands[1];
+        uint32_t sampled = type.operands[5];
+
+        if (dim == Spv::Buffer)
+            return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        if (dim == Spv::SubpassData)
+            return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    }
+
+    case Spv::TypeAccelerationStructure:
+        return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_NV;
+
+    default:
+        return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  the vertex attribute format of a 32 bit scalar or vector input
+*/
+/****************************************************************************/
+static VkFormat InputFormatOf(const std::vector<SpvId>& ids, uint32_t id)
+{
+    const SpvId& type = ids[id];
+
+    uint32_t components = 1;
+    const SpvId* scalar = &type;
+    if (type.opcode == Spv::TypeVector)
+    {
+        components = type.operands[1];
+        scalar = &ids[type.operands[0]];
+    }
+
+    if (scalar->operands.empty() || scalar->operands[0] != 32 || components < 1 || components > 4)
+        return VK_FORMAT_UNDEFINED;
+
+    static const VkFormat floats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+    static const VkFormat ints[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+    static const VkFormat uints[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+    if (scalar->opcode == Spv::TypeFloat)
+        return floats[components - 1];
+    if (scalar->opcode == Spv::TypeInt)
+        return scalar->operands[1] ? ints[components - 1] : uints[components - 1];
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  the size of a vertex attribute format made by InputFormatOf
+*/
+/****************************************************************************/
+static uint32_t InputFormatSize(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R32_SFLOAT: case VK_FORMAT_R32_SINT: case VK_FORMAT_R32_UINT:
+        return 4;
+    case VK_FORMAT_R32G32_SFLOAT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_R32G32_UINT:
+        return 8;
+    case VK_FORMAT_R32G32B32_SFLOAT: case VK_FORMAT_R32G32B32_SINT: case VK_FORMAT_R32G32B32_UINT:
+        return 12;
+    default:
+        return 16;
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Reflect a SPIR-V module
+
+\param code
+  The module, as passed to vkCreateShaderModule
+*/
+/****************************************************************************/
+void VK::ShaderReflection::Create(const std::vector<uint32_t>& code)
+{
+    *this = ShaderReflection();
+
+    if (code.size() < 5 || code[0] != SpirvMagic)
+    {
+        DEBUG::log.Error("ShaderReflection::Create: not a SPIR-V module!");
+        throw std::runtime_error("not a SPIR-V module!");
+    }
+
+    // word 3 of the header is the id bound
+    std::vector<SpvId> ids(code[3]);
+    std::vector<uint32_t> variables;
+
+    for (size_t i = 5; i < code.size();)
+    {
+        uint32_t count = code[i] >> 16;
+        uint32_t opcode = code[i] & 0xFFFF;
+        if (count == 0 || i + count > code.size())
+        {
+            DEBUG::log.Error("ShaderReflection::Create: broken SPIR-V instruction!");
+            throw std::runtime_error("broken SPIR-V instruction!");
+        }
+        const uint32_t* words = &code[i];
+        i += count;
+
+        switch (opcode)
+        {
+        case Spv::EntryPoint:
+            mStages |= StageOf(words[1]);
+            break;
+
+        case Spv::ExecutionMode:
+            if (words[2] == Spv::LocalSize && count >= 6)
+            {
+                mLocalSize[0] = words[3];
+                mLocalSize[1] = words[4];
+                mLocalSize[2] = words[5];
+            }
+            break;
+
+        case Spv::Decorate:
+        {
+            SpvId& target = ids[words[1]];
+            switch (words[2])
+            {
+            case Spv::DescriptorSet: target.set = words[3]; break;
+            case Spv::Binding: target.binding = words[3]; break;
+            case Spv::Location: target.location = words[3]; break;
+            case Spv::ArrayStride: target.arrayStride = words[3]; break;
+            case Spv::BuiltIn: target.builtIn = true; break;
+            case Spv::Block: target.block = true; break;
+            case Spv::SpecId: mSpecializationIds.push_back(words[3]); break;
+            case Spv::BufferBlock: target.bufferBlock = true; break;
+            }
+            break;
+        }
+
+        case Spv::MemberDecorate:
+        {
+            SpvId& target = ids[words[1]];
+            if (words[3] == Spv::Offset)
+                SetMember(target.memberOffsets, words[2], words[4]);
+            else if (words[3] == Spv::MatrixStride)
+                SetMember(target.memberMatrixStrides, words[2], words[4]);
+            else if (words[3] == Spv::BuiltIn)
+                target.builtIn = true;
+            break;
+        }
+
+        case Spv::TypeInt:
+        case Spv::TypeFloat:
+        case Spv::TypeVector:
+        case Spv::TypeMatrix:
+        case Spv::TypeImage:
+        case Spv::TypeSampler:
+        case Spv::TypeSampledImage:
+        case Spv::TypeArray:
+        case Spv::TypeRuntimeArray:
+        case Spv::TypeStruct:
+        case Spv::TypePointer:
+        case Spv::TypeAccelerationStructure:
+            ids[words[1]].opcode = opcode;
+            ids[words[1]].operands.assign(words + 2, words + count);
+            break;
+
+        case Spv::Constant:
+        case Spv::SpecConstant:
+            ids[words[2]].opcode = opcode;
+            ids[words[2]].type = words[1];
+            ids[words[2]].operands.assign(words + 3, words + count);
+            break;
+
+        case Spv::SpecConstantTrue:
+        case Spv::SpecConstantFalse:
+            ids[words[2]].opcode = opcode;
+            ids[words[2]].type = words[1];
+            ids[words[2]].operands.assign(1, opcode == Spv::SpecConstantTrue ? 1u : 0u);
+            break;
+
+        case Spv::Variable:
+            ids[words[2]].opcode = opcode;
+            ids[words[2]].type = words[1];
+            ids[words[2]].operands.assign(words + 3, words + count);
+            variables.push_back(words[2]);
+            break;
+        }
+    }
+
+    for (uint32_t id : variables)
+    {
+        const SpvId& variable = ids[id];
+        uint32_t storage = variable.operands[0];
+
+        // variables are pointers, operands: storage class, pointee
+        uint32_t type = ids[variable.type].operands[1];
+
+        if (storage == Spv::PushConstant)
+        {
+            const SpvId& block = ids[type];
+            uint32_t offset = block.memberOffsets.empty() ? 0 : *std::min_element(block.memberOffsets.begin(), block.memberOffsets.end());
+            mPushStages = mStages;
+            mPushOffset = offset;
+            mPushSize = TypeSize(ids, type) - offset;
+            continue;
+        }
+
+        if (storage == Spv::Input)
+        {
+            if (!(mStages & VK_SHADER_STAGE_VERTEX_BIT) || variable.builtIn || ids[type].builtIn || variable.location == NoValue)
+                continue;
+
+            ReflectedInput input;
+            input.location = variable.location;
+            input.format = InputFormatOf(ids, type);
+            if (input.format == VK_FORMAT_UNDEFINED)
+            {
+                DEBUG::log.Info("ShaderReflection::Create: skipped a vertex input that is not a 32 bit scalar or vector at location", input.location);
+                continue;
+            }
+            mInputs.push_back(input);
+            continue;
+        }
+
+        if ((storage != Spv::UniformConstant && storage != Spv::Uniform && storage != Spv::StorageBuffer) ||
+            variable.set == NoValue || variable.binding == NoValue)
+            continue;
+
+        // arrays of resources are one binding with a count
+        uint32_t count = 1;
+        while (ids[type].opcode == Spv::TypeArray || ids[type].opcode == Spv::TypeRuntimeArray)
+        {
+            if (ids[type].opcode == Spv::TypeArray)
+                count *= ArrayLength(ids, ids[type]);
+            type = ids[type].operands[0];
+        }
+
+        ReflectedBinding binding;
+        binding.set = variable.set;
+        binding.binding.binding = variable.binding;
+        binding.binding.descriptorType = DescriptorTypeOf(ids, storage, type);
+        binding.binding.descriptorCount = count;
+        binding.binding.stageFlags = mStages;
+
+        if (binding.binding.descriptorType == VK_DESCRIPTOR_TYPE_MAX_ENUM)
+        {
+            DEBUG::log.Error("ShaderReflection::Create: unknown resource type at set", binding.set, "binding", variable.binding);
+            throw std::runtime_error("unknown resource type!");
+        }
+        mBindings.push_back(binding);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Add the use of another stage. Bindings both stages use must agree on
+  the type, push constants become one range over what either stage pushes.
+*/
+/****************************************************************************/
+void VK::ShaderReflection::Merge(const ShaderReflection& other)
+{
+    mStages |= other.mStages;
+
+    for (const ReflectedBinding& binding : other.mBindings)
+    {
+        auto same = std::find_if(mBindings.begin(), mBindings.end(), [&binding](const ReflectedBinding& mine)
+            { return mine.set == binding.set && mine.binding.binding == binding.binding.binding; });
+
+        if (same == mBindings.end())
+        {
+            mBindings.push_back(binding);
+            continue;
+        }
+
+        if (same->binding.descriptorType != binding.binding.descriptorType)
+        {
+            DEBUG::log.Error("ShaderReflection::Merge: stages use set", binding.set, "binding", binding.binding.binding, "as different types!");
+            throw std::runtime_error("stages disagree on a descriptor type!");
+        }
+        same->binding.stageFlags |= binding.binding.stageFlags;
+        same->binding.descriptorCount = std::max(same->binding.descriptorCount, binding.binding.descriptorCount);
+    }
+
+    if (other.mPushSize > 0)
+    {
+        uint32_t end = mPushSize > 0 ? std::max(mPushOffset + mPushSize, other.mPushOffset + other.mPushSize) : other.mPushOffset + other.mPushSize;
+        mPushOffset = mPushSize > 0 ? std::min(mPushOffset, other.mPushOffset) : other.mPushOffset;
+        mPushSize = end - mPushOffset;
+        mPushStages |= other.mPushStages;
+    }
+
+    mInputs.insert(mInputs.end(), other.mInputs.begin(), other.mInputs.end());
+
+    if (other.mStages & VK_SHADER_STAGE_COMPUTE_BIT)
+        std::copy(other.mLocalSize, other.mLocalSize + 3, mLocalSize);
+
+    for (uint32_t id : other.mSpecializationIds)
+    {
+        if (std::find(mSpecializationIds.begin(), mSpecializationIds.end(), id) == mSpecializationIds.end())
+            mSpecializationIds.push_back(id);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the bindings of every set up to the highest one used, sets in
+  between that are not used are empty
+*/
+/****************************************************************************/
+std::vector<std::vector<VkDescriptorSetLayoutBinding>> VK::ShaderReflection::SetLayouts() const
+{
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+    for (const ReflectedBinding& binding : mBindings)
+    {
+        if (sets.size() <= binding.set)
+            sets.resize(binding.set + 1);
+        sets[binding.set].push_back(binding.binding);
+    }
+
+    // sorted, so equal use gives equal layouts
+    for (std::vector<VkDescriptorSetLayoutBinding>& set : sets)
+    {
+        std::sort(set.begin(), set.end(), [](const VkDescriptorSetLayoutBinding& lhs, const VkDescriptorSetLayoutBinding& rhs)
+            { return lhs.binding < rhs.binding; });
+    }
+
+    return sets;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the push constant range, every stage that pushes has to be named
+  when pushing
+*/
+/****************************************************************************/
+std::vector<VkPushConstantRange> VK::ShaderReflection::PushConstants() const
+{
+    if (mPushSize == 0)
+        return {};
+
+    VkPushConstantRange range = {};
+    range.stageFlags = mPushStages;
+    range.offset = mPushOffset;
+    range.size = mPushSize;
+    return { range };
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get a vertex input for the vertex shader inputs, interleaved in one
+  buffer in location order without padding
+*/
+/****************************************************************************/
+void VK::ShaderReflection::VertexInput(std::vector<VkVertexInputBindingDescription>& bindings,
+    std::vector<VkVertexInputAttributeDescription>& attributes) const
+{
+    bindings.clear();
+    attributes.clear();
+    if (mInputs.empty())
+        return;
+
+    std::vector<ReflectedInput> inputs = mInputs;
+    std::sort(inputs.begin(), inputs.end(), [](const ReflectedInput& lhs, const ReflectedInput& rhs)
+        { return lhs.location < rhs.location; });
+
+    uint32_t offset = 0;
+    for (const ReflectedInput& input : inputs)
+    {
+        VkVertexInputAttributeDescription attribute = {};
+        attribute.location = input.location;
+        attribute.binding = 0;
+        attribute.format = input.format;
+        attribute.offset = offset;
+        attributes.push_back(attribute);
+
+        offset += InputFormatSize(input.format);
+    }
+
+    VkVertexInputBindingDescription binding = {};
+    binding.binding = 0;
+    binding.stride = offset;
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    bindings.push_back(binding);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the stages reflected so far
+*/
+/****************************************************************************/
+VkShaderStageFlags VK::ShaderReflection::Stages() const
+{
+    return mStages;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get every descriptor used
+*/
+/****************************************************************************/
+const std::vector<VK::ReflectedBinding>& VK::ShaderReflection::Bindings() const
+{
+    return mBindings;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the vertex shader inputs
+*/
+/****************************************************************************/
+const std::vector<VK::ReflectedInput>& VK::ShaderReflection::Inputs() const
+{
+    return mInputs;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the ids of the specialization constants the stages declare
+*/
+/****************************************************************************/
+const std::vector<uint32_t>& VK::ShaderReflection::SpecializationIds() const
+{
+    return mSpecializationIds;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the compute workgroup size as x, y, z
+*/
+/****************************************************************************/
+const uint32_t* VK::ShaderReflection::LocalSize() const
+{
+    return mLocalSize;
+}
@@ -31,25 +31,29 @@
 /*!
 \brief
   create a new swap chain
+
+  If a swap chain already exists it is handed to the driver as the old
+  swap chain so images can be recycled, then retired once the new one exists.
+
+\param presentModes
+  Present modes in order of preference, FIFO is used if none are available
+
+\param minImageCount
+  Requested minimum number of images, 0 uses the surface minimum + 1
 */
 /****************************************************************************/
-void VK::SwapChain::Create(VK::Surface& surface, VK::Device& device, GLFWwindow* window)
+void VK::SwapChain::Create(VK::Surface& surface, VK::Device& device, GLFWwindow* window,
+    const std::vector<VkPresentModeKHR>& presentModes, uint32_t minImageCount)
 {
-    if (mSwapChain != VK_NULL_HANDLE)
-        ShutDown(device);
-
     // make swap chain
     SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(surface, device);
 
     VkSurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapChainSupport.presentModes);
+    VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapChainSupport.presentModes, presentModes);
     VkExtent2D extent = ChooseSwapExtent(swapChainSupport.capabilities, window);
+    uint32_t imageCount = ChooseImageCount(swapChainSupport.capabilities, minImageCount);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
-    {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
-    }
+    VkSwapchainKHR oldSwapChain = mSwapChain;
 
     VkSwapchainCreateInfoKHR createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -60,7 +64,10 @@ void VK::SwapChain::Create(VK::Surface& surface, VK::Device& device, GLFWwindow*
     createInfo.imageColorSpace = surfaceFormat.colorSpace;
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
-    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // transfer source lets frames be read back and transfer destination lets
+    // them be upscaled into when the surface allows it
+    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+        (swapChainSupport.capabilities.supportedUsageFlags & (VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
 
     VK::Device::QueueFamilyIndices indices = device.GetQueueFamilies(surface);
     uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
@@ -80,13 +87,19 @@ void VK::SwapChain::Create(VK::Surface& surface, VK::Device& device, GLFWwindow*
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
+    createInfo.oldSwapchain = oldSwapChain;
 
-    if (vkCreateSwapchainKHR(device.Get(), &createInfo, nullptr, &mSwapChain) != VK_SUCCESS)
+    VkSwapchainKHR newSwapChain = VK_NULL_HANDLE;
+    if (vkCreateSwapchainKHR(device.Get(), &createInfo, nullptr, &newSwapChain) != VK_SUCCESS)
     {
         DEBUG::log.Error("SwapChain::Create: failed to create swap chain!");
         throw std::runtime_error("failed to create swap chain!");
     }
 
+    // retire the old swap chain
+    ShutDown(device);
+    mSwapChain = newSwapChain;
+
     // create swap chain images
     vkGetSwapchainImagesKHR(device.Get(), mSwapChain, &imageCount, nullptr);
     mImages.resize(imageCount);
@@ -94,6 +107,8 @@ void VK::SwapChain::Create(VK::Surface& surface, VK::Device& device, GLFWwindow*
 
     mImageFormat = surfaceFormat.format;
     mExtent = extent;
+    mPresentMode = presentMode;
+    mImageUsage = createInfo.imageUsage;
 
     mImageViews.resize(mImages.size());
 
@@ -118,6 +133,44 @@ void VK::SwapChain::Create(VK::Surface& surface, VK::Device& device, GLFWwindow*
     }
 }
 
+/****************************************************************************/
+/*!
+\brief
+  create a ring of offscreen color images that stand in for the swap chain
+  when there is no window or surface
+
+\param extent
+  Size of every image
+
+\param imageCount
+  Number of images in the ring
+*/
+/****************************************************************************/
+void VK::SwapChain::CreateHeadless(VK::Device& device, VkExtent2D extent, uint32_t imageCount)
+{
+    ShutDown(device);
+
+    mImageFormat = device.FindSupportedFormat({ VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM },
+        VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT);
+    mExtent = extent;
+    mPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    mImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    mOffscreenImages.resize(std::max(imageCount, 1u));
+    mImages.resize(mOffscreenImages.size());
+    mImageViews.resize(mOffscreenImages.size());
+
+    for (size_t i = 0; i < mOffscreenImages.size(); ++i)
+    {
+        mOffscreenImages[i].Create(device, extent.width, extent.height, mImageFormat, VK_IMAGE_TILING_OPTIMAL,
+            mImageUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+        // the views are owned by the images, these are only handles
+        mImages[i] = mOffscreenImages[i].Get();
+        *mImageViews[i].GetPointerTo() = mOffscreenImages[i].GetView();
+    }
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -126,10 +179,22 @@ void VK::SwapChain::Create(VK::Surface& surface, VK::Device& device, GLFWwindow*
 /****************************************************************************/
 void VK::SwapChain::ShutDown(VK::Device& device)
 {
+    if (!mOffscreenImages.empty())
+    {
+        for (auto& image : mOffscreenImages)
+        {
+            image.ShutDown(device);
+        }
+
+        mOffscreenImages.clear();
+        mImageViews.clear();
+        mImages.clear();
+    }
+
     if (mSwapChain == VK_NULL_HANDLE)
         return;
 
-    for (auto imageView : mImageViews)
+    for (auto& imageView : mImageViews)
     {
         imageView.ShutDown(device);
     }
@@ -149,6 +214,17 @@ VkSwapchainKHR VK::SwapChain::Get() const
     return mSwapChain;
 }
 
+/****************************************************************************/
+/*!
+\brief
+  is this an offscreen image ring rather than a real swap chain
+*/
+/****************************************************************************/
+bool VK::SwapChain::IsHeadless() const
+{
+    return !mOffscreenImages.empty();
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -182,6 +258,28 @@ VkExtent2D VK::SwapChain::Extent() const
     return mExtent;
 }
 
+/****************************************************************************/
+/*!
+\brief
+  get the present mode the swap chain was created with
+*/
+/****************************************************************************/
+VkPresentModeKHR VK::SwapChain::PresentMode() const
+{
+    return mPresentMode;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  get the usage the images were created with
+*/
+/****************************************************************************/
+VkImageUsageFlags VK::SwapChain::ImageUsage() const
+{
+    return mImageUsage;
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -266,19 +364,45 @@ VkSurfaceFormatKHR VK::SwapChain::ChooseSwapSurfaceFormat(const std::vector<VkSu
   choose the present mode for the swap chain
 */
 /****************************************************************************/
-VkPresentModeKHR VK::SwapChain::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+VkPresentModeKHR VK::SwapChain::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, const std::vector<VkPresentModeKHR>& preferredPresentModes)
 {
-    for (const auto& availablePresentMode : availablePresentModes)
+    for (const auto& preferredPresentMode : preferredPresentModes)
     {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+        for (const auto& availablePresentMode : availablePresentModes)
         {
-            return availablePresentMode;
+            if (availablePresentMode == preferredPresentMode)
+            {
+                return availablePresentMode;
+            }
         }
     }
 
+    // FIFO is the only mode the spec guarantees
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+/****************************************************************************/
+/*!
+\brief
+  choose how many images the swap chain should have
+*/
+/****************************************************************************/
+uint32_t VK::SwapChain::ChooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities, uint32_t minImageCount)
+{
+    uint32_t imageCount = capabilities.minImageCount + 1;
+    if (minImageCount > 0)
+    {
+        imageCount = std::max(minImageCount, capabilities.minImageCount);
+    }
+
+    if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount)
+    {
+        imageCount = capabilities.maxImageCount;
+    }
+
+    return imageCount;
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -103,6 +103,17 @@ VkDescriptorSetLayout* VK::UBO::GetPointerToLayout()
     return mSets.GetPointerToLayout();
 }
 
+/****************************************************************************/
+/*!
+\brief
+  get the bindings of the descriptor layout
+*/
+/****************************************************************************/
+const std::vector<VkDescriptorSetLayoutBinding>& VK::UBO::Bindings() const
+{
+    return mSets.Bindings();
+}
+
 /****************************************************************************/
 /*!
 \brief